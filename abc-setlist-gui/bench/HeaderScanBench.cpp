@@ -0,0 +1,192 @@
+// Header scan benchmark
+//
+// Compares AbcHeaderScanner against the regex/istringstream extraction it
+// replaced on a synthetic ABC corpus, and checks both produce identical
+// title lines and instrument lists before reporting timings.
+
+#include "AbcHeaderScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct LegacyTitle {
+    std::string text;
+    std::string instrument;
+};
+
+// Previous SetlistManager::extractTitleLines, kept as the reference behaviour
+std::vector<LegacyTitle> legacyTitleLines(const std::string& content) {
+    std::vector<LegacyTitle> titleLines;
+    std::istringstream stream(content);
+    std::string line;
+
+    std::regex titleRegex(R"(^T:\s*(.+))");
+    std::regex instrumentRegex(R"(\[(.*?)\])");
+
+    while (std::getline(stream, line)) {
+        std::smatch match;
+        if (std::regex_search(line, match, titleRegex)) {
+            LegacyTitle title;
+            title.text = match[1].str();
+
+            std::smatch instMatch;
+            if (std::regex_search(title.text, instMatch, instrumentRegex)) {
+                std::string potential = instMatch[1].str();
+                if (!potential.empty() && potential.find(':') == std::string::npos) {
+                    title.instrument = potential;
+                }
+            }
+            titleLines.push_back(title);
+        }
+    }
+    return titleLines;
+}
+
+// Previous SetlistManager::extractInstruments, kept as the reference behaviour
+std::vector<std::string> legacyInstruments(const std::string& content) {
+    std::vector<std::string> instruments;
+    std::istringstream stream(content);
+    std::string line;
+
+    std::regex titleRegex(R"(^T:\s*(.+))");
+    std::regex instrumentRegex(R"(\[(.*?)\]|\((.*?)\))");
+
+    while (std::getline(stream, line)) {
+        std::smatch match;
+        if (std::regex_search(line, match, titleRegex)) {
+            std::string title = match[1].str();
+            std::sregex_iterator iter(title.begin(), title.end(), instrumentRegex);
+            std::sregex_iterator end;
+
+            for (; iter != end; ++iter) {
+                std::string potential = (*iter)[1].str();
+                if (potential.empty()) {
+                    potential = (*iter)[2].str();
+                }
+                if (!potential.empty() && potential.find(':') == std::string::npos) {
+                    if (std::find(instruments.begin(), instruments.end(), potential) == instruments.end()) {
+                        instruments.push_back(potential);
+                    }
+                }
+            }
+        }
+
+        std::regex partNameRegex(R"(^%%part-name\s+(.+))");
+        if (std::regex_search(line, match, partNameRegex)) {
+            std::string partName = match[1].str();
+            if (std::find(instruments.begin(), instruments.end(), partName) == instruments.end()) {
+                instruments.push_back(partName);
+            }
+        }
+    }
+    return instruments;
+}
+
+// Synthetic tune with a mix of the header shapes seen in real files,
+// including the awkward ones (CRLF, blank titles, unclosed brackets)
+std::string makeTune(std::mt19937& rng, int index) {
+    static const char* kInstruments[] = {"Fiddle", "Guitar", "Mandolin", "Banjo", "Whistle", "Bass"};
+    static const char* kEndings[] = {"\n", "\r\n"};
+
+    const char* eol = kEndings[rng() % 2];
+    int parts = 1 + static_cast<int>(rng() % 6);
+
+    std::string tune = "X:" + std::to_string(index) + eol;
+    for (int p = 0; p < parts; ++p) {
+        const char* instrument = kInstruments[rng() % 6];
+        switch (rng() % 7) {
+        case 0: tune += "T:Tune " + std::to_string(index) + " [" + instrument + "] (3:" + std::to_string(10 + p) + ")" + eol; break;
+        case 1: tune += "T: Tune " + std::to_string(index) + " (" + instrument + ")" + eol; break;
+        case 2: tune += "T:  " + std::string(eol); break;
+        case 3: tune += "T:Reel [4:22] [" + std::string(instrument) + eol; break;
+        case 4: tune += "%%part-name " + std::string(instrument) + eol; break;
+        case 5: tune += "T:" + std::string(eol) + "%%part-name" + eol; break;
+        default: tune += "T:\t[]" + std::string(instrument) + "(" + eol; break;
+        }
+    }
+    tune += "M:4/4" + std::string(eol) + "L:1/8" + eol + "K:D" + eol;
+    for (int bar = 0; bar < 32; ++bar) {
+        tune += "|:d2fd Adfd|c2ec Acec|d2fd Adfd|edcB A4:|";
+        tune += eol;
+    }
+    return tune;
+}
+
+bool sameResults(const std::string& content, const setlistgui::AbcHeaderScan& scan) {
+    auto titles = legacyTitleLines(content);
+    auto instruments = legacyInstruments(content);
+
+    if (titles.size() != scan.titles.size() || instruments.size() != scan.instruments.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < titles.size(); ++i) {
+        if (titles[i].text != scan.titles[i].text || titles[i].instrument != scan.titles[i].instrument) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < instruments.size(); ++i) {
+        if (instruments[i] != scan.instruments[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Fn>
+double timeMs(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int tuneCount = (argc > 1) ? std::atoi(argv[1]) : 500;
+
+    std::mt19937 rng(12345);
+    std::vector<std::string> corpus;
+    size_t corpusBytes = 0;
+    for (int i = 0; i < tuneCount; ++i) {
+        corpus.push_back(makeTune(rng, i + 1));
+        corpusBytes += corpus.back().size();
+    }
+
+    setlistgui::AbcHeaderScan scan;
+    for (const auto& tune : corpus) {
+        setlistgui::AbcHeaderScanner::scan(tune, scan);
+        if (!sameResults(tune, scan)) {
+            std::fprintf(stderr, "Mismatch between scanner and regex extraction:\n%s\n", tune.c_str());
+            return 1;
+        }
+    }
+
+    size_t sink = 0;
+    double legacyMs = timeMs([&] {
+        for (const auto& tune : corpus) {
+            sink += legacyTitleLines(tune).size();
+            sink += legacyInstruments(tune).size();
+        }
+    });
+    double scannerMs = timeMs([&] {
+        for (const auto& tune : corpus) {
+            setlistgui::AbcHeaderScanner::scan(tune, scan);
+            sink += scan.titles.size() + scan.instruments.size();
+        }
+    });
+
+    double megabytes = static_cast<double>(corpusBytes) / (1024.0 * 1024.0);
+    std::printf("corpus: %d tunes, %.2f MB\n", tuneCount, megabytes);
+    std::printf("regex extraction: %9.2f ms  (%8.1f files/s)\n", legacyMs, tuneCount * 1000.0 / legacyMs);
+    std::printf("header scanner:   %9.2f ms  (%8.1f files/s)\n", scannerMs, tuneCount * 1000.0 / scannerMs);
+    std::printf("speedup: %.1fx  (checksum %zu)\n", legacyMs / scannerMs, sink);
+    return 0;
+}
@@ -0,0 +1,690 @@
+// Setlist benchmark suite
+//
+// Generates a synthetic ABC corpus (single tunes, multi-part tunes with many
+// T: lines, large tunebooks) in a temporary folder and times the hot paths
+// on it: header scan, import (per file, batch and from a warm metadata
+// cache), reorder, total duration, export (folder, sync and archive) and
+// session save/load. For each operation it reports throughput, latency
+// percentiles and peak memory, as a table or as JSON (--json) that can be
+// diffed between releases.
+
+#include "AbcHeaderScanner.h"
+#include "MappedFile.h"
+#include "MetadataCache.h"
+#include "SessionFile.h"
+#include "SetlistManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSchemaVersion = 1;
+
+struct BenchOptions {
+    int filesPerKind = 200;
+    int tunebookCount = 4;
+    int tunesPerBook = 400;
+    int iterations = 5;
+    int reorders = 100000;
+    unsigned seed = 12345;
+    std::string jsonPath;  // Empty: print a table; "-": JSON on stdout
+    std::string corpusDir;
+    bool keepCorpus = false;
+};
+
+// ---------------------------------------------------------------------------
+// Peak memory
+
+#ifdef __linux__
+// VmHWM / VmRSS from /proc/self/status, in bytes
+size_t procStatusBytes(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t fieldLength = std::char_traits<char>::length(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, fieldLength, field) == 0) {
+            return std::strtoull(line.c_str() + fieldLength + 1, nullptr, 10) * 1024;
+        }
+    }
+    return 0;
+}
+#endif
+
+// Reset the process's peak resident set so the next reading covers only
+// the operation that follows. Returns false where the OS can't do that, in
+// which case peaks are process-wide high-water marks.
+bool resetPeakMemory() {
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+#else
+    return false;
+#endif
+}
+
+size_t peakMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+    return procStatusBytes("VmHWM:");
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(usage.ru_maxrss);  // Bytes on macOS
+#endif
+}
+
+size_t currentMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#elif defined(__linux__)
+    return procStatusBytes("VmRSS:");
+#else
+    return peakMemoryBytes();
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Corpus
+
+enum class CorpusKind { Single, MultiPart, Tunebook };
+
+const char* kindName(CorpusKind kind) {
+    switch (kind) {
+    case CorpusKind::Single: return "single";
+    case CorpusKind::MultiPart: return "multipart";
+    case CorpusKind::Tunebook: return "tunebook";
+    }
+    return "";
+}
+
+struct CorpusFile {
+    std::string path;
+    CorpusKind kind;
+    size_t bytes = 0;
+};
+
+const char* kInstruments[] = {"Fiddle", "Guitar", "Mandolin", "Banjo", "Whistle",
+                              "Bass", "Drums", "Lute", "Flute", "Harp"};
+
+std::string duration(std::mt19937& rng) {
+    int seconds = 90 + static_cast<int>(rng() % 300);
+    char text[16];
+    std::snprintf(text, sizeof(text), "(%d:%02d)", seconds / 60, seconds % 60);
+    return text;
+}
+
+void appendBars(std::mt19937& rng, int bars, std::string& out) {
+    static const char* kBars[] = {"|:d2fd Adfd|c2ec Acec|", "|B2dB AFDF|GABc d2cB|",
+                                  "|e2ae faef|gfed cdeg|", "|A3B cBAG|FGAB c4:|"};
+    for (int bar = 0; bar < bars; ++bar) {
+        out += kBars[rng() % 4];
+        out += '\n';
+    }
+}
+
+// One tune, one T: line
+std::string makeSingleTune(std::mt19937& rng, int index) {
+    std::string tune = "X:1\n";
+    tune += "T:Tune " + std::to_string(index) + " [" + kInstruments[rng() % 10] + "] " + duration(rng) + "\n";
+    tune += "M:4/4\nL:1/8\nQ:1/4=120\nK:D\n";
+    appendBars(rng, 16 + static_cast<int>(rng() % 48), tune);
+    return tune;
+}
+
+// One X: section per instrument part, each with its own T: line and part name
+std::string makeMultiPartTune(std::mt19937& rng, int index) {
+    int parts = 8 + static_cast<int>(rng() % 33);
+    std::string tune;
+    for (int part = 0; part < parts; ++part) {
+        const char* instrument = kInstruments[part % 10];
+        tune += "X:" + std::to_string(part + 1) + "\n";
+        tune += "T:Song " + std::to_string(index) + " - part " + std::to_string(part + 1) + " [" + instrument + "] " + duration(rng) + "\n";
+        tune += "%%part-name " + std::string(instrument) + " " + std::to_string(part / 10 + 1) + "\n";
+        tune += "M:4/4\nL:1/8\nK:G\n";
+        appendBars(rng, 8 + static_cast<int>(rng() % 24), tune);
+        tune += "\n";
+    }
+    return tune;
+}
+
+// Many independent tunes in one file
+std::string makeTunebook(std::mt19937& rng, int index, int tunes) {
+    std::string book = "%abc-2.1\n% Tunebook " + std::to_string(index) + "\n\n";
+    for (int t = 0; t < tunes; ++t) {
+        book += "X:" + std::to_string(t + 1) + "\n";
+        book += "T:Book " + std::to_string(index) + " tune " + std::to_string(t + 1) + " " + duration(rng) + "\n";
+        book += "R:reel\nM:4/4\nL:1/8\nK:D\n";
+        appendBars(rng, 16 + static_cast<int>(rng() % 16), book);
+        book += "\n";
+    }
+    return book;
+}
+
+bool writeCorpus(const BenchOptions& options, std::vector<CorpusFile>& corpus, std::string& error) {
+    std::mt19937 rng(options.seed);
+    auto add = [&](CorpusKind kind, const std::string& name, const std::string& content) {
+        CorpusFile file;
+        file.path = (fs::path(options.corpusDir) / kindName(kind) / name).string();
+        file.kind = kind;
+        file.bytes = content.size();
+        corpus.push_back(file);
+        std::ofstream out(file.path, std::ios::binary);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!out) {
+            error = "Cannot write " + file.path;
+            return false;
+        }
+        return true;
+    };
+
+    for (CorpusKind kind : {CorpusKind::Single, CorpusKind::MultiPart, CorpusKind::Tunebook}) {
+        std::error_code ec;
+        fs::create_directories(fs::path(options.corpusDir) / kindName(kind), ec);
+        if (ec) {
+            error = "Cannot create " + options.corpusDir + ": " + ec.message();
+            return false;
+        }
+    }
+
+    for (int i = 0; i < options.filesPerKind; ++i) {
+        if (!add(CorpusKind::Single, "single_" + std::to_string(i) + ".abc", makeSingleTune(rng, i)) ||
+            !add(CorpusKind::MultiPart, "multipart_" + std::to_string(i) + ".abc", makeMultiPartTune(rng, i))) {
+            return false;
+        }
+    }
+    for (int i = 0; i < options.tunebookCount; ++i) {
+        if (!add(CorpusKind::Tunebook, "tunebook_" + std::to_string(i) + ".abc",
+                 makeTunebook(rng, i, options.tunesPerBook))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Measurements
+
+struct OperationResult {
+    std::string name;
+    std::string corpus;       // Which part of the corpus it ran on
+    size_t files = 0;         // Files processed per iteration (0 if not file-based)
+    size_t bytes = 0;         // Bytes processed per iteration
+    int iterations = 0;
+    double seconds = 0.0;     // Total timed seconds across iterations
+    std::vector<double> latenciesUs;
+    size_t peakMemoryBytes = 0;
+    size_t memoryGrowthBytes = 0;  // Peak above the resident size at the start
+    bool peakIsolated = false;     // Peak was reset before the operation
+};
+
+double percentile(std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+// Runs one operation, recording peak memory around the whole of it.
+// body(result) appends latency samples and sets files/bytes.
+template <typename Fn>
+OperationResult measure(const std::string& name, const std::string& corpus, int iterations, Fn&& body) {
+    OperationResult result;
+    result.name = name;
+    result.corpus = corpus;
+    result.iterations = iterations;
+    result.peakIsolated = resetPeakMemory();
+    size_t startMemory = currentMemoryBytes();
+
+    body(result);
+
+    result.peakMemoryBytes = peakMemoryBytes();
+    result.memoryGrowthBytes = result.peakMemoryBytes > startMemory ? result.peakMemoryBytes - startMemory : 0;
+    for (double latency : result.latenciesUs) {
+        result.seconds += latency / 1e6;
+    }
+    std::sort(result.latenciesUs.begin(), result.latenciesUs.end());
+    return result;
+}
+
+template <typename Fn>
+double timeUs(Fn&& fn) {
+    auto start = Clock::now();
+    fn();
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+std::vector<const CorpusFile*> filesOf(const std::vector<CorpusFile>& corpus, const char* kind) {
+    std::vector<const CorpusFile*> files;
+    for (const auto& file : corpus) {
+        if (std::string(kind) == "all" || std::string(kind) == kindName(file.kind)) {
+            files.push_back(&file);
+        }
+    }
+    return files;
+}
+
+size_t totalBytes(const std::vector<const CorpusFile*>& files) {
+    size_t bytes = 0;
+    for (const auto* file : files) {
+        bytes += file->bytes;
+    }
+    return bytes;
+}
+
+std::vector<std::string> pathsOf(const std::vector<const CorpusFile*>& files) {
+    std::vector<std::string> paths;
+    for (const auto* file : files) {
+        paths.push_back(file->path);
+    }
+    return paths;
+}
+
+// Keeps the optimizer from discarding results
+volatile size_t g_sink = 0;
+
+std::vector<OperationResult> runBenchmarks(const BenchOptions& options, const std::vector<CorpusFile>& corpus) {
+    std::vector<OperationResult> results;
+    const char* kinds[] = {"single", "multipart", "tunebook"};
+
+    // Header scan over content already in memory
+    for (const char* kind : kinds) {
+        auto files = filesOf(corpus, kind);
+        std::vector<std::string> contents;
+        for (const auto* file : files) {
+            setlistgui::MappedFile mapped;
+            std::string error;
+            mapped.open(file->path, error);
+            contents.push_back(mapped.takeContents());
+        }
+        results.push_back(measure("scan", kind, options.iterations, [&](OperationResult& r) {
+            r.files = files.size();
+            r.bytes = totalBytes(files);
+            setlistgui::AbcHeaderScan scan;
+            for (int it = 0; it < options.iterations; ++it) {
+                for (const auto& content : contents) {
+                    r.latenciesUs.push_back(timeUs([&] { setlistgui::AbcHeaderScanner::scan(content, scan); }));
+                    g_sink = g_sink + scan.titles.size();
+                }
+            }
+        }));
+    }
+
+    // Import one file at a time (read, scan, parse, append)
+    for (const char* kind : kinds) {
+        auto files = filesOf(corpus, kind);
+        results.push_back(measure("import", kind, options.iterations, [&](OperationResult& r) {
+            r.files = files.size();
+            r.bytes = totalBytes(files);
+            for (int it = 0; it < options.iterations; ++it) {
+                setlistgui::SetlistManager manager;
+                for (const auto* file : files) {
+                    r.latenciesUs.push_back(timeUs([&] { manager.addSongFromFile(file->path); }));
+                }
+                g_sink = g_sink + manager.songCount();
+            }
+        }));
+    }
+
+    // Whole-corpus parallel import, cold and from a warm metadata cache
+    auto all = filesOf(corpus, "all");
+    auto allPaths = pathsOf(all);
+    results.push_back(measure("import-batch", "all", options.iterations, [&](OperationResult& r) {
+        r.files = all.size();
+        r.bytes = totalBytes(all);
+        for (int it = 0; it < options.iterations; ++it) {
+            setlistgui::SetlistManager manager;
+            r.latenciesUs.push_back(timeUs([&] { manager.addSongsFromFiles(allPaths); }));
+            g_sink = g_sink + manager.songCount();
+        }
+    }));
+
+    // Tunebooks split into one song per tune, read in chunks
+    auto books = filesOf(corpus, "tunebook");
+    auto bookPaths = pathsOf(books);
+    results.push_back(measure("import-split", "tunebook", options.iterations, [&](OperationResult& r) {
+        r.files = books.size();
+        r.bytes = totalBytes(books);
+        for (int it = 0; it < options.iterations; ++it) {
+            setlistgui::SetlistManager manager;
+            manager.setSplitTunebooks(true);
+            r.latenciesUs.push_back(timeUs([&] { manager.addSongsFromFiles(bookPaths); }));
+            g_sink = g_sink + manager.songCount();
+        }
+    }));
+
+    auto cache = std::make_shared<setlistgui::MetadataCache>((fs::path(options.corpusDir) / "bench.cache").string());
+    {
+        setlistgui::SetlistManager warmup;
+        warmup.setMetadataCache(cache);
+        warmup.addSongsFromFiles(allPaths);
+    }
+    results.push_back(measure("import-cached", "all", options.iterations, [&](OperationResult& r) {
+        r.files = all.size();
+        r.bytes = totalBytes(all);
+        for (int it = 0; it < options.iterations; ++it) {
+            setlistgui::SetlistManager manager;
+            manager.setMetadataCache(cache);
+            r.latenciesUs.push_back(timeUs([&] { manager.addSongsFromFiles(allPaths); }));
+            g_sink = g_sink + manager.songCount();
+        }
+    }));
+
+    // Operations on a loaded setlist
+    setlistgui::SetlistManager manager;
+    manager.addSongsFromFiles(allPaths);
+    size_t songs = manager.songCount();
+
+    results.push_back(measure("reorder", "all", 1, [&](OperationResult& r) {
+        std::mt19937 rng(options.seed);
+        for (int i = 0; i < options.reorders && songs > 1; ++i) {
+            size_t from = rng() % songs;
+            size_t to = rng() % songs;
+            r.latenciesUs.push_back(timeUs([&] { manager.reorderSong(from, to); }));
+        }
+    }));
+
+    results.push_back(measure("total-duration", "all", 1, [&](OperationResult& r) {
+        for (int i = 0; i < options.reorders; ++i) {
+            int padding = i % 30;
+            // Defined in another translation unit, so the call isn't elided
+            r.latenciesUs.push_back(timeUs([&] { manager.getTotalDuration(padding, 10); }));
+        }
+        g_sink = g_sink + manager.getTotalDuration(5, 10).toString().size();
+    }));
+
+    results.push_back(measure("export", "all", options.iterations, [&](OperationResult& r) {
+        r.files = all.size();
+        r.bytes = totalBytes(all);
+        for (int it = 0; it < options.iterations; ++it) {
+            std::string folder = (fs::path(options.corpusDir) / ("export_" + std::to_string(it))).string();
+            setlistgui::ExportReport report;
+            r.latenciesUs.push_back(timeUs([&] { report = manager.exportToFolder(folder, true); }));
+            if (!report.success) {
+                std::fprintf(stderr, "export failed: %s\n", report.error.c_str());
+            }
+            std::error_code ec;
+            fs::remove_all(folder, ec);
+        }
+    }));
+
+    // Re-sync after moving one song: only the renumbered files are touched
+    {
+        std::string folder = (fs::path(options.corpusDir) / "export_sync").string();
+        manager.exportToFolder(folder, true, true);
+        results.push_back(measure("export-sync", "reorder-1", options.iterations, [&](OperationResult& r) {
+            r.files = all.size();
+            for (int it = 0; it < options.iterations; ++it) {
+                manager.reorderSong(manager.songCount() / 2, manager.songCount() / 2 + 2);
+                setlistgui::ExportReport report;
+                r.latenciesUs.push_back(timeUs([&] { report = manager.exportToFolder(folder, true, true); }));
+                if (!report.success) {
+                    std::fprintf(stderr, "sync export failed: %s\n", report.error.c_str());
+                }
+                r.bytes = report.totalBytes;  // Per iteration, as elsewhere
+            }
+        }));
+        std::error_code ec;
+        fs::remove_all(folder, ec);
+    }
+
+    // The same export streamed into one archive (zip deflates each entry)
+    for (const char* extension : {"zip", "tar"}) {
+        std::string path = (fs::path(options.corpusDir) / (std::string("export.") + extension)).string();
+        results.push_back(measure("export-archive", extension, options.iterations, [&](OperationResult& r) {
+            r.files = all.size();
+            r.bytes = totalBytes(all);
+            for (int it = 0; it < options.iterations; ++it) {
+                setlistgui::ExportReport report;
+                r.latenciesUs.push_back(timeUs([&] { report = manager.exportToArchive(path, true); }));
+                if (!report.success) {
+                    std::fprintf(stderr, "archive export failed: %s\n", report.error.c_str());
+                }
+            }
+        }));
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+
+    // Save the setlist as a session and open it again (without the source
+    // check, which runs in the background)
+    {
+        std::string path = (fs::path(options.corpusDir) / "bench.abcs").string();
+        setlistgui::SessionSettings settings;
+        results.push_back(measure("session-save", "all", options.iterations, [&](OperationResult& r) {
+            r.files = songs;
+            for (int it = 0; it < options.iterations; ++it) {
+                std::string error;
+                r.latenciesUs.push_back(timeUs([&] { manager.saveSession(path, settings, false, error); }));
+                if (!error.empty()) {
+                    std::fprintf(stderr, "session save failed: %s\n", error.c_str());
+                }
+            }
+            std::error_code ec;
+            r.bytes = static_cast<size_t>(fs::file_size(path, ec));
+        }));
+        results.push_back(measure("session-load", "all", options.iterations, [&](OperationResult& r) {
+            r.files = songs;
+            std::error_code ec;
+            r.bytes = static_cast<size_t>(fs::file_size(path, ec));
+            for (int it = 0; it < options.iterations; ++it) {
+                setlistgui::SetlistManager restored;
+                std::string error;
+                r.latenciesUs.push_back(timeUs([&] { restored.loadSession(path, settings, error); }));
+                if (!error.empty()) {
+                    std::fprintf(stderr, "session load failed: %s\n", error.c_str());
+                }
+                g_sink = g_sink + restored.songCount();
+            }
+        }));
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+
+    return results;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+
+double filesPerSecond(const OperationResult& r) {
+    return r.seconds > 0.0 ? static_cast<double>(r.files) * r.iterations / r.seconds : 0.0;
+}
+
+double operationsPerSecond(const OperationResult& r) {
+    return r.seconds > 0.0 ? static_cast<double>(r.latenciesUs.size()) / r.seconds : 0.0;
+}
+
+double megabytesPerSecond(const OperationResult& r) {
+    return r.seconds > 0.0 ? static_cast<double>(r.bytes) * r.iterations / (1024.0 * 1024.0) / r.seconds : 0.0;
+}
+
+void printTable(const std::vector<OperationResult>& results, const std::vector<CorpusFile>& corpus) {
+    size_t bytes = 0;
+    for (const auto& file : corpus) {
+        bytes += file.bytes;
+    }
+    std::printf("corpus: %zu files, %.2f MB\n\n", corpus.size(), static_cast<double>(bytes) / (1024.0 * 1024.0));
+    std::printf("%-15s %-10s %11s %10s %9s %10s %10s %10s %10s %10s\n",
+                "operation", "corpus", "ops/s", "files/s", "MB/s", "p50 us", "p90 us", "p99 us", "max us", "peak MB");
+    for (auto r : results) {
+        std::printf("%-15s %-10s %11.0f %10.0f %9.1f %10.2f %10.2f %10.2f %10.2f %10.1f\n",
+                    r.name.c_str(), r.corpus.c_str(), operationsPerSecond(r), filesPerSecond(r), megabytesPerSecond(r),
+                    percentile(r.latenciesUs, 0.50), percentile(r.latenciesUs, 0.90),
+                    percentile(r.latenciesUs, 0.99), r.latenciesUs.empty() ? 0.0 : r.latenciesUs.back(),
+                    static_cast<double>(r.peakMemoryBytes) / (1024.0 * 1024.0));
+    }
+}
+
+bool writeJson(const std::string& path, const BenchOptions& options,
+               const std::vector<OperationResult>& results, const std::vector<CorpusFile>& corpus) {
+    FILE* out = path == "-" ? stdout : std::fopen(path.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+
+    size_t kindFiles[3] = {0, 0, 0};
+    size_t kindBytes[3] = {0, 0, 0};
+    for (const auto& file : corpus) {
+        kindFiles[static_cast<int>(file.kind)]++;
+        kindBytes[static_cast<int>(file.kind)] += file.bytes;
+    }
+
+    std::fprintf(out, "{\n  \"benchmark\": \"setlist-bench\",\n  \"schema\": %d,\n", kSchemaVersion);
+    std::fprintf(out, "  \"seed\": %u,\n  \"hardwareThreads\": %u,\n", options.seed, std::thread::hardware_concurrency());
+    std::fprintf(out, "  \"corpus\": {");
+    for (int k = 0; k < 3; ++k) {
+        std::fprintf(out, "%s\"%s\": {\"files\": %zu, \"bytes\": %zu}", k ? ", " : "",
+                     kindName(static_cast<CorpusKind>(k)), kindFiles[k], kindBytes[k]);
+    }
+    std::fprintf(out, "},\n  \"operations\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        OperationResult r = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"corpus\": \"%s\", \"iterations\": %d, \"samples\": %zu, "
+                          "\"files\": %zu, \"bytes\": %zu, \"seconds\": %.6f, \"opsPerSecond\": %.1f, "
+                          "\"filesPerSecond\": %.1f, \"mbPerSecond\": %.3f, "
+                          "\"latencyUs\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+                          "\"peakMemoryBytes\": %zu, \"memoryGrowthBytes\": %zu, \"peakIsolated\": %s}%s\n",
+                     r.name.c_str(), r.corpus.c_str(), r.iterations, r.latenciesUs.size(),
+                     r.files, r.bytes, r.seconds, operationsPerSecond(r), filesPerSecond(r), megabytesPerSecond(r),
+                     r.latenciesUs.empty() ? 0.0 : r.seconds * 1e6 / static_cast<double>(r.latenciesUs.size()),
+                     percentile(r.latenciesUs, 0.50), percentile(r.latenciesUs, 0.90),
+                     percentile(r.latenciesUs, 0.99), r.latenciesUs.empty() ? 0.0 : r.latenciesUs.back(),
+                     r.peakMemoryBytes, r.memoryGrowthBytes, r.peakIsolated ? "true" : "false",
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return true;
+}
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "Usage: setlist-bench [options]\n"
+                 "\n"
+                 "  --files <n>        single and multi-part files each (default 200)\n"
+                 "  --tunebooks <n>    tunebook files (default 4)\n"
+                 "  --book-tunes <n>   tunes per tunebook (default 400)\n"
+                 "  --iterations <n>   repetitions of each file-based operation (default 5)\n"
+                 "  --reorders <n>     reorder / total-duration calls (default 100000)\n"
+                 "  --seed <n>         corpus random seed (default 12345)\n"
+                 "  --dir <folder>     where to generate the corpus (default: temp folder)\n"
+                 "  --keep             leave the corpus on disk afterwards\n"
+                 "  --json <file|->    write JSON results instead of a table\n");
+}
+
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--files" && hasValue) {
+            options.filesPerKind = std::atoi(argv[++i]);
+        } else if (arg == "--tunebooks" && hasValue) {
+            options.tunebookCount = std::atoi(argv[++i]);
+        } else if (arg == "--book-tunes" && hasValue) {
+            options.tunesPerBook = std::atoi(argv[++i]);
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reorders" && hasValue) {
+            options.reorders = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--dir" && hasValue) {
+            options.corpusDir = argv[++i];
+        } else if (arg == "--keep") {
+            options.keepCorpus = true;
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    bool ownsCorpusDir = options.corpusDir.empty();
+    if (ownsCorpusDir) {
+        std::error_code ec;
+        auto stamp = Clock::now().time_since_epoch().count();
+        options.corpusDir = (fs::temp_directory_path(ec) / ("setlist-bench-" + std::to_string(stamp))).string();
+    }
+
+    std::vector<CorpusFile> corpus;
+    std::string error;
+    if (!writeCorpus(options, corpus, error)) {
+        std::fprintf(stderr, "Cannot generate corpus: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<OperationResult> results = runBenchmarks(options, corpus);
+
+    bool ok = true;
+    if (options.jsonPath.empty()) {
+        printTable(results, corpus);
+    } else {
+        ok = writeJson(options.jsonPath, options, results, corpus);
+    }
+
+    if (!options.keepCorpus) {
+        std::error_code ec;
+        if (ownsCorpusDir) {
+            fs::remove_all(options.corpusDir, ec);
+        } else {
+            for (const char* kind : {"single", "multipart", "tunebook"}) {
+                fs::remove_all(fs::path(options.corpusDir) / kind, ec);
+            }
+            fs::remove(fs::path(options.corpusDir) / "bench.cache", ec);
+        }
+    }
+    return ok ? 0 : 1;
+}
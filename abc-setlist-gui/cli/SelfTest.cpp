@@ -0,0 +1,627 @@
+#include "SelfTest.h"
+#include "ArchiveWriter.h"
+#include "Deflate.h"
+#include "SessionFile.h"
+#include "SetlistManager.h"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+// File name -> content
+using FileSet = std::map<std::string, std::string>;
+
+class Checks {
+public:
+    void expect(bool ok, const std::string& what, const std::string& detail = std::string()) {
+        ++count_;
+        if (!ok) {
+            ++failed_;
+        }
+        std::printf("  %s  %s%s%s\n", ok ? "ok  " : "FAIL", what.c_str(), detail.empty() ? "" : ": ",
+                    detail.c_str());
+    }
+
+    size_t count() const { return count_; }
+    size_t failed() const { return failed_; }
+
+private:
+    size_t count_ = 0;
+    size_t failed_ = 0;
+};
+
+bool readWholeFile(const fs::path& path, std::string& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    data = bytes.str();
+    return true;
+}
+
+bool writeWholeFile(const fs::path& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+// Regular files in a folder, leaving out hidden ones (the sync manifest)
+FileSet readFolder(const fs::path& folder) {
+    FileSet files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(folder, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && !name.empty() && name[0] != '.') {
+            readWholeFile(entry.path(), files[name]);
+        }
+    }
+    return files;
+}
+
+// Empty if the sets hold the same files, else the first difference
+std::string compareFiles(const FileSet& expected, const FileSet& actual) {
+    for (const auto& [name, content] : expected) {
+        auto it = actual.find(name);
+        if (it == actual.end()) {
+            return "missing " + name;
+        }
+        if (it->second != content) {
+            return name + " differs";
+        }
+    }
+    for (const auto& file : actual) {
+        if (!expected.count(file.first)) {
+            return "unexpected " + file.first;
+        }
+    }
+    return std::string();
+}
+
+std::uint32_t get16(std::string_view data, size_t at) {
+    return static_cast<std::uint8_t>(data[at]) | (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[at + 1])) << 8);
+}
+
+std::uint32_t get32(std::string_view data, size_t at) {
+    return get16(data, at) | (get16(data, at + 2) << 16);
+}
+
+// Inflate for the block types the app writes (stored and fixed Huffman),
+// written from RFC 1951 independently of Deflate.cpp
+class Inflater {
+public:
+    explicit Inflater(std::string_view data) : data_(data) {}
+
+    bool run(std::string& out, std::string& error) {
+        static constexpr std::array<std::uint16_t, 29> lengthBase = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr std::array<std::uint8_t, 29> lengthExtra = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr std::array<std::uint16_t, 30> distanceBase = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr std::array<std::uint8_t, 30> distanceExtra = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        bool final = false;
+        while (!final) {
+            final = bits(1) == 1;
+            std::uint32_t type = bits(2);
+            if (type == 0) {
+                bit_ = (bit_ + 7) / 8 * 8;
+                size_t at = bit_ / 8;
+                if (at + 4 > data_.size() || (get16(data_, at) ^ 0xFFFF) != get16(data_, at + 2)) {
+                    error = "bad stored block";
+                    return false;
+                }
+                size_t length = get16(data_, at);
+                if (at + 4 + length > data_.size()) {
+                    error = "stored block past the end";
+                    return false;
+                }
+                out.append(data_.substr(at + 4, length));
+                bit_ = (at + 4 + length) * 8;
+                continue;
+            }
+            if (type != 1) {
+                error = "unexpected block type " + std::to_string(type);
+                return false;
+            }
+            for (;;) {
+                int symbol = literalSymbol();
+                if (symbol < 0 || overrun_) {
+                    error = "bad literal/length code";
+                    return false;
+                }
+                if (symbol < 256) {
+                    out.push_back(static_cast<char>(symbol));
+                    continue;
+                }
+                if (symbol == 256) {
+                    break;
+                }
+                size_t code = static_cast<size_t>(symbol - 257);
+                if (code >= lengthBase.size()) {
+                    error = "bad length code";
+                    return false;
+                }
+                size_t length = lengthBase[code] + bits(lengthExtra[code]);
+                std::uint32_t distanceCode = 0;
+                for (int i = 0; i < 5; ++i) {
+                    distanceCode = (distanceCode << 1) | bits(1);
+                }
+                if (distanceCode >= distanceBase.size()) {
+                    error = "bad distance code";
+                    return false;
+                }
+                size_t distance = distanceBase[distanceCode] + bits(distanceExtra[distanceCode]);
+                if (distance > out.size() || distance > 32768) {
+                    error = "distance past the start";
+                    return false;
+                }
+                for (size_t i = 0; i < length; ++i) {
+                    out.push_back(out[out.size() - distance]);
+                }
+            }
+        }
+        if (overrun_) {
+            error = "stream ends early";
+            return false;
+        }
+        if ((bit_ + 7) / 8 != data_.size()) {
+            error = "bytes after the final block";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // count bits, least significant first
+    std::uint32_t bits(int count) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (bit_ / 8 >= data_.size()) {
+                overrun_ = true;
+                return 0;
+            }
+            value |= static_cast<std::uint32_t>((static_cast<std::uint8_t>(data_[bit_ / 8]) >> (bit_ % 8)) & 1) << i;
+            ++bit_;
+        }
+        return value;
+    }
+
+    // The fixed literal/length code, read a bit at a time (codes are
+    // stored most significant bit first)
+    int literalSymbol() {
+        std::uint32_t code = 0;
+        for (int length = 1; length <= 9; ++length) {
+            code = (code << 1) | bits(1);
+            if (length == 7 && code <= 23) {
+                return static_cast<int>(256 + code);
+            }
+            if (length == 8 && code >= 0x30 && code <= 0xBF) {
+                return static_cast<int>(code - 0x30);
+            }
+            if (length == 8 && code >= 0xC0 && code <= 0xC7) {
+                return static_cast<int>(280 + code - 0xC0);
+            }
+            if (length == 9 && code >= 0x190) {
+                return static_cast<int>(144 + code - 0x190);
+            }
+        }
+        return -1;
+    }
+
+    std::string_view data_;
+    size_t bit_ = 0;
+    bool overrun_ = false;
+};
+
+// Read a zip through its central directory, checking every local header,
+// size and CRC against it
+bool readZip(const std::string& data, FileSet& files, std::string& error) {
+    if (data.size() < 22 || get32(data, data.size() - 22) != 0x06054B50) {
+        error = "no end of central directory record";
+        return false;
+    }
+    size_t end = data.size() - 22;
+    size_t entries = get16(data, end + 10);
+    size_t at = get32(data, end + 16);
+    if (get16(data, end + 8) != entries || at + get32(data, end + 12) != end) {
+        error = "bad end of central directory record";
+        return false;
+    }
+    for (size_t n = 0; n < entries; ++n) {
+        if (at + 46 > end || get32(data, at) != 0x02014B50) {
+            error = "bad central directory record";
+            return false;
+        }
+        std::uint32_t method = get16(data, at + 10);
+        std::uint32_t crc = get32(data, at + 16);
+        size_t packedSize = get32(data, at + 20);
+        size_t size = get32(data, at + 24);
+        size_t nameLength = get16(data, at + 28);
+        size_t skip = get16(data, at + 30) + get16(data, at + 32);
+        size_t local = get32(data, at + 42);
+        std::string name = data.substr(at + 46, nameLength);
+        size_t record = at;
+        at += 46 + nameLength + skip;
+
+        // The local header repeats the record's fields from version to
+        // extra field length
+        if (local + 30 > data.size() || get32(data, local) != 0x04034B50 ||
+            data.compare(local + 4, 26, data, record + 6, 26) != 0 ||
+            data.compare(local + 30, nameLength, name) != 0) {
+            error = name + ": local header doesn't match the central directory";
+            return false;
+        }
+        size_t start = local + 30 + nameLength + get16(data, local + 28);
+        if (start + packedSize > data.size()) {
+            error = name + ": data past the end";
+            return false;
+        }
+        std::string_view packed(data.data() + start, packedSize);
+        std::string content;
+        if (method == 0) {
+            content.assign(packed);
+        } else if (method != 8 || !Inflater(packed).run(content, error)) {
+            error = name + ": " + (method != 8 ? "unknown method" : error);
+            return false;
+        }
+        if (content.size() != size || crc32(content) != crc) {
+            error = name + ": size or CRC mismatch";
+            return false;
+        }
+        files[name] = std::move(content);
+    }
+    return true;
+}
+
+std::uint64_t octal(std::string_view field) {
+    std::uint64_t value = 0;
+    for (char c : field) {
+        if (c < '0' || c > '7') {
+            break;
+        }
+        value = value * 8 + static_cast<std::uint64_t>(c - '0');
+    }
+    return value;
+}
+
+// Read a ustar archive (with pax path records), checking header checksums
+// and the two zero blocks at the end
+bool readTar(const std::string& data, FileSet& files, std::string& error) {
+    constexpr size_t kBlock = 512;
+    std::string paxPath;
+    for (size_t at = 0; at + kBlock <= data.size();) {
+        std::string_view header(data.data() + at, kBlock);
+        if (header.find_first_not_of('\0') == std::string_view::npos) {
+            if (at + 2 * kBlock != data.size() || data.find_first_not_of('\0', at) != std::string::npos) {
+                error = "bad end of archive";
+                return false;
+            }
+            return true;
+        }
+        std::uint64_t checksum = 0;
+        for (size_t i = 0; i < kBlock; ++i) {
+            checksum += (i >= 148 && i < 156) ? ' ' : static_cast<std::uint8_t>(header[i]);
+        }
+        if (octal(header.substr(148, 8)) != checksum || header.substr(257, 6) != std::string_view("ustar\0", 6) ||
+            header.substr(263, 2) != "00") {
+            error = "bad header at " + std::to_string(at);
+            return false;
+        }
+        std::string name(header.substr(0, 100));
+        name.resize(name.find('\0') == std::string::npos ? name.size() : name.find('\0'));
+        size_t size = static_cast<size_t>(octal(header.substr(124, 12)));
+        char type = header[156];
+        at += kBlock;
+        if (at + size > data.size()) {
+            error = name + ": data past the end";
+            return false;
+        }
+        std::string content = data.substr(at, size);
+        at += (size + kBlock - 1) / kBlock * kBlock;
+
+        if (type == 'x') {
+            // "<length> path=<name>\n", where length counts the whole record
+            size_t space = content.find(' ');
+            if (space == std::string::npos || std::strtoul(content.c_str(), nullptr, 10) != content.size() ||
+                content.compare(space + 1, 5, "path=") != 0 || content.back() != '\n') {
+                error = "bad pax record";
+                return false;
+            }
+            paxPath = content.substr(space + 6, content.size() - space - 7);
+            continue;
+        }
+        if (type != '0') {
+            error = name + ": unexpected entry type";
+            return false;
+        }
+        if (!paxPath.empty()) {
+            name = std::move(paxPath);
+            paxPath.clear();
+        }
+        files[name] = std::move(content);
+    }
+    error = "archive ends without end blocks";
+    return false;
+}
+
+// A tune with two T: lines and bars varied by number and bar
+std::string makeTune(int number, int bars, const char* newline) {
+    static const char* const kPhrases[] = {"|:d2fd Adfd|", "c2ec Acec|", "B2dB GBdB|", "A2FA DAFA:|",
+                                           "|f2af gfed|", "e2ce dcBA|", "Bcde fgaf|", "e2d2 d4|]"};
+    std::string n = std::to_string(number);
+    std::string tune = "X:" + n + newline + "T:Tune " + n + " [Fiddle]" + newline + "T:Second part " + n +
+                       " [Guitar]" + newline + "M:4/4" + newline + "L:1/8" + newline + "Q:1/4=120" + newline +
+                       "K:D" + newline;
+    for (int bar = 0; bar < bars; ++bar) {
+        tune += kPhrases[(bar * 7 + number) % 8];
+        tune += kPhrases[(bar * 3 + number / 2) % 8];
+        if (bar % 4 == 3) {
+            tune += " % " + std::to_string(bar * 31 + number);
+        }
+        tune += newline;
+    }
+    return tune + newline;
+}
+
+// Source files for the setlist: CRLF and LF tunes, one big enough to slide
+// the deflate window, one whose numbered name needs a pax record, and a
+// tunebook that repeats an X: number
+std::vector<std::string> writeCorpus(const fs::path& sources) {
+    fs::create_directories(sources);
+    std::vector<std::string> files;
+    for (int i = 1; i <= 8; ++i) {
+        fs::path path = sources / ("song" + std::to_string(i) + ".abc");
+        writeWholeFile(path, makeTune(i, 6 + 5 * i, i % 2 ? "\r\n" : "\n"));
+        files.push_back(path.string());
+    }
+    fs::path big = sources / "big.abc";
+    writeWholeFile(big, makeTune(40, 2500, "\n"));
+    files.push_back(big.string());
+    fs::path longName = sources / (std::string(110, 'l') + ".abc");
+    writeWholeFile(longName, makeTune(41, 12, "\r\n"));
+    files.push_back(longName.string());
+    return files;
+}
+
+void checkDeflate(Checks& checks) {
+    checks.expect(crc32("123456789") == 0xCBF43926u && crc32("") == 0, "crc32 check values");
+
+    std::mt19937 random(12345);
+    std::string noise(100000, '\0');
+    for (char& c : noise) {
+        c = static_cast<char>(random() & 0xFF);
+    }
+    std::string text;
+    for (int i = 0; text.size() < 300000; ++i) {
+        text += makeTune(i, 8 + i % 11, "\r\n");
+    }
+    const std::vector<std::pair<const char*, std::string>> inputs = {
+        {"empty", ""},         {"one byte", "a"}, {"long run", std::string(70000, 'a')},
+        {"random", noise},     {"ABC text", text}, {"all byte values", [] {
+             std::string all;
+             for (int round = 0; round < 3; ++round) {
+                 for (int c = 0; c < 256; ++c) {
+                     all.push_back(static_cast<char>(c));
+                 }
+             }
+             return all;
+         }()}};
+    for (const auto& [what, input] : inputs) {
+        std::string packed = deflateRaw(input);
+        std::string unpacked;
+        std::string error;
+        bool ok = Inflater(packed).run(unpacked, error);
+        if (ok && unpacked != input) {
+            error = "content differs";
+            ok = false;
+        }
+        checks.expect(ok, std::string("deflate round trip, ") + what, error);
+    }
+    checks.expect(deflateRaw(text).size() < text.size() / 2, "deflate shrinks ABC text");
+}
+
+void checkArchives(Checks& checks, const SetlistManager& manager, const fs::path& work) {
+    auto folder = manager.exportToFolder((work / "folder").string(), true);
+    checks.expect(folder.success, "folder export", folder.error);
+    FileSet expected = readFolder(work / "folder");
+
+    for (ArchiveFormat format : {ArchiveFormat::Zip, ArchiveFormat::Tar}) {
+        std::string name = format == ArchiveFormat::Zip ? "set.zip" : "set.tar";
+        std::string path = (work / name).string();
+        auto report = manager.exportToArchive(path, true);
+        checks.expect(report.success && report.written == expected.size(), "write " + name, report.error);
+
+        std::string data;
+        std::string error;
+        FileSet files;
+        bool read = readWholeFile(path, data) &&
+                    (format == ArchiveFormat::Zip ? readZip(data, files, error) : readTar(data, files, error));
+        if (read) {
+            error = compareFiles(expected, files);
+        }
+        checks.expect(read && error.empty(), "read back " + name, error);
+
+        std::string again;
+        auto repeat = manager.exportToArchive(path, true);
+        checks.expect(repeat.success && readWholeFile(path, again) && again == data,
+                      "rewrite " + name + " byte for byte");
+    }
+}
+
+void checkSessions(Checks& checks, SetlistManager& original, const fs::path& work) {
+    SessionSettings settings;
+    settings.paddingSeconds = 7;
+    settings.introSeconds = 3;
+    settings.addNumbering = false;
+    settings.syncExport = true;
+    settings.exportFolder = (work / "gig").string();
+    FileSet expected = readFolder(work / "folder");
+
+    for (bool embed : {false, true}) {
+        std::string kind = embed ? "embedded session" : "session";
+        std::string path = (work / (embed ? "embedded.abcs" : "plain.abcs")).string();
+        std::string error;
+        bool saved = original.saveSession(path, settings, embed, error);
+        checks.expect(saved, "save " + kind, error);
+
+        SetlistManager loaded;
+        SessionSettings restored;
+        bool ok = loaded.loadSession(path, restored, error);
+        if (ok) {
+            ok = restored.paddingSeconds == settings.paddingSeconds &&
+                 restored.introSeconds == settings.introSeconds && restored.addNumbering == settings.addNumbering &&
+                 restored.syncExport == settings.syncExport && restored.exportFolder == settings.exportFolder &&
+                 restored.splitTunebooks == original.splitTunebooks() &&
+                 loaded.songCount() == original.songCount();
+            error = ok ? "" : "settings or song count differ";
+        }
+        for (size_t i = 0; ok && i < original.songCount(); ++i) {
+            const SongCard& a = original.getSong(original.getOrder()[i]);
+            const SongCard& b = loaded.getSong(loaded.getOrder()[i]);
+            const SongDetails& da = original.getDetails(original.getOrder()[i]);
+            const SongDetails& db = loaded.getDetails(loaded.getOrder()[i]);
+            ok = a.title == b.title && a.filename == b.filename && a.titleEdited == b.titleEdited &&
+                 a.durationSeconds == b.durationSeconds && da.titleLines.size() == db.titleLines.size();
+            for (size_t line = 0; ok && line < da.titleLines.size(); ++line) {
+                ok = da.titleLineText(line) == db.titleLineText(line);
+            }
+            if (!ok) {
+                error = "song " + std::to_string(i + 1) + " differs";
+            }
+        }
+        checks.expect(ok, "load " + kind, error);
+
+        // An embedded session must export without its source files
+        fs::path sources = work / "src";
+        fs::path moved = work / "src-away";
+        if (embed) {
+            fs::rename(sources, moved);
+        }
+        std::string folder = (work / (embed ? "from-embedded" : "from-session")).string();
+        auto report = loaded.exportToFolder(folder, true);
+        error = report.success ? compareFiles(expected, readFolder(folder)) : report.error;
+        checks.expect(report.success && error.empty(),
+                      "export from " + kind + (embed ? " without its sources" : ""), error);
+        if (embed) {
+            fs::rename(moved, sources);
+        }
+    }
+}
+
+// Sync the setlist into a folder and compare it with a fresh export of the
+// same order; a hand-made file in the folder must survive every sync
+void checkSync(Checks& checks, SetlistManager& manager, const fs::path& work) {
+    fs::path synced = work / "synced";
+    fs::create_directories(synced);
+    writeWholeFile(synced / "notes.txt", "bring capo\n");
+    int round = 0;
+
+    auto syncAndCompare = [&](const std::string& what, size_t written, size_t renamed, size_t removed) {
+        auto report = manager.exportToFolder(synced.string(), true, true);
+        fs::path fresh = work / ("fresh" + std::to_string(round++));
+        auto plain = manager.exportToFolder(fresh.string(), true);
+        std::string error = report.success && plain.success ? "" : report.error + plain.error;
+        if (error.empty() && (report.written != written || report.renamed != renamed || report.removed != removed)) {
+            char counts[96];
+            std::snprintf(counts, sizeof(counts), "%zu written, %zu renamed, %zu removed", report.written,
+                          report.renamed, report.removed);
+            error = counts;
+        }
+        if (error.empty()) {
+            FileSet files = readFolder(synced);
+            bool notesKept = files.erase("notes.txt") == 1;
+            error = notesKept ? compareFiles(readFolder(fresh), files) : "notes.txt removed";
+        }
+        checks.expect(error.empty(), "sync: " + what, error);
+    };
+
+    size_t count = manager.songCount();
+    syncAndCompare("first sync", count, 0, 0);
+    syncAndCompare("nothing changed", 0, 0, 0);
+
+    manager.moveSong(manager.getOrder()[0], 1);
+    syncAndCompare("swap two songs", 0, 2, 0);
+
+    manager.moveSong(manager.getOrder()[count - 1], 0);
+    syncAndCompare("rotate every song", 0, count, 0);
+
+    manager.updateSongTitle(manager.getOrder()[2], "Retitled in the self-test");
+    syncAndCompare("retitle one song", 1, 0, 0);
+
+    manager.removeSong(manager.getOrder()[0]);
+    syncAndCompare("remove the first song", 0, count - 1, 1);
+
+    // The removed song and the old title are written again; the retitled
+    // file, now at a name nothing wants, is removed
+    manager.undo();
+    manager.undo();
+    syncAndCompare("undo the remove and the retitle", 2, count - 2, 1);
+}
+
+} // namespace
+
+bool runSelfTest(const std::string& folder) {
+    fs::path work = folder;
+    if (work.empty()) {
+        work = fs::temp_directory_path() / ("setlist-self-test-" + std::to_string(std::random_device()()));
+    }
+    std::error_code ec;
+    fs::remove_all(work, ec);
+    fs::create_directories(work, ec);
+    if (ec) {
+        std::fprintf(stderr, "Cannot create %s: %s\n", work.string().c_str(), ec.message().c_str());
+        return false;
+    }
+
+    Checks checks;
+    std::printf("deflate / crc32\n");
+    checkDeflate(checks);
+
+    SetlistManager manager;
+    manager.addSongsFromFiles(writeCorpus(work / "src"));
+    std::string book = makeTune(1, 5, "\n") + makeTune(2, 6, "\n") + makeTune(2, 7, "\n") + makeTune(3, 8, "\n");
+    writeWholeFile(work / "src" / "book.abc", book);
+    manager.setSplitTunebooks(true);
+    manager.addSongsFromFiles({(work / "src" / "book.abc").string()});
+    manager.updateSongTitle(manager.getOrder()[1], "Edited title");
+    manager.updateTitleLine(manager.getOrder()[2], 1, "Edited part [Banjo]");
+    checks.expect(manager.songCount() == 14, "load the generated setlist",
+                  std::to_string(manager.songCount()) + " songs");
+
+    std::printf("archives\n");
+    checkArchives(checks, manager, work);
+    std::printf("sessions\n");
+    checkSessions(checks, manager, work);
+    std::printf("sync export\n");
+    checkSync(checks, manager, work);
+
+    std::printf("self-test: %zu checks, %zu failed\n", checks.count(), checks.failed());
+    if (checks.failed() == 0) {
+        fs::remove_all(work, ec);
+    } else {
+        std::printf("files kept in %s\n", work.string().c_str());
+    }
+    return checks.failed() == 0;
+}
+
+} // namespace setlistgui
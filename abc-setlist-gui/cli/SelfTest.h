@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+namespace setlistgui {
+
+// Round-trip checks of the files the app writes in its own formats (run by
+// setlist-cli --self-test). Generates a setlist under folder (a fresh
+// temporary folder if empty), writes zip and tar archives, session files
+// and sync exports of it, reads each back with an independent reader and
+// compares it with a plain folder export. Prints one line per check and
+// returns false if any failed; the folder is removed unless a check failed.
+bool runSelfTest(const std::string& folder);
+
+} // namespace setlistgui
@@ -0,0 +1,231 @@
+// Headless setlist builder
+//
+// Runs import, duration computation and export for one or more setlist
+// manifests (see SetlistManifest.h) without any GUI or GL dependency. All
+// manifests are handled in one process and share one metadata cache, so a
+// tune used by several setlists is parsed once.
+//
+// --self-test writes and reads back archives, sessions and sync exports of
+// a generated setlist instead (see SelfTest.h).
+
+#include "MetadataCache.h"
+#include "SelfTest.h"
+#include "SetlistManager.h"
+#include "SetlistManifest.h"
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CliOptions {
+    std::vector<std::string> manifests;
+    std::string cachePath;  // Empty: in-memory cache for this run only
+    bool dryRun = false;
+    bool printCues = false;
+    bool splitTunebooks = false;
+    bool selfTest = false;
+};
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "Usage: setlist-cli [options] <manifest>... [@list]\n"
+                 "       setlist-cli --self-test\n"
+                 "\n"
+                 "  <manifest>       setlist manifest file\n"
+                 "  @list            file with one manifest path per line\n"
+                 "  --dry-run        import and compute durations, don't export\n"
+                 "  --cues           print each song's start and end time\n"
+                 "  --cache <file>   keep parsed metadata in <file> between runs\n"
+                 "  --tunebooks      add one song per X: tune of each file\n"
+                 "  --self-test      check archive, session and sync export round trips\n"
+                 "\n"
+                 "Exit status: 0 if every manifest succeeded, 1 otherwise.\n");
+}
+
+bool parseArguments(int argc, char** argv, CliOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dry-run") {
+            options.dryRun = true;
+        } else if (arg == "--cues") {
+            options.printCues = true;
+        } else if (arg == "--tunebooks") {
+            options.splitTunebooks = true;
+        } else if (arg == "--self-test") {
+            options.selfTest = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cachePath = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg[0] == '@') {
+            std::ifstream list(arg.substr(1));
+            if (!list) {
+                std::fprintf(stderr, "Cannot open manifest list: %s\n", arg.c_str() + 1);
+                return false;
+            }
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (!line.empty() && line[0] != '#') {
+                    options.manifests.push_back(line);
+                }
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        } else {
+            options.manifests.push_back(arg);
+        }
+    }
+    return options.selfTest || !options.manifests.empty();
+}
+
+// Whether a song's file came from a manifest entry: the entry itself, or a
+// file somewhere under it when the entry is a folder
+bool isFromEntry(const std::string& songPath, const std::string& entryPath) {
+    if (songPath.compare(0, entryPath.size(), entryPath) != 0) {
+        return false;
+    }
+    if (songPath.size() == entryPath.size()) {
+        return true;
+    }
+    auto isSeparator = [](char c) { return c == '/' || c == '\\'; };
+    return !entryPath.empty() && (isSeparator(entryPath.back()) || isSeparator(songPath[entryPath.size()]));
+}
+
+// Import, time and (optionally) export one manifest; prints a summary
+bool runManifest(const std::string& manifestPath, const CliOptions& options,
+                 const std::shared_ptr<setlistgui::MetadataCache>& cache) {
+    setlistgui::SetlistManifest manifest;
+    std::string error;
+    if (!setlistgui::readManifest(manifestPath, manifest, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+
+    setlistgui::SetlistManager manager;
+    manager.setMetadataCache(cache);
+    manager.setSplitTunebooks(options.splitTunebooks);
+
+    std::vector<std::string> paths;
+    paths.reserve(manifest.songs.size());
+    for (const auto& song : manifest.songs) {
+        paths.push_back(song.path);
+    }
+    auto report = manager.addSongsFromFiles(paths);
+    for (const auto& failure : report.failures) {
+        std::fprintf(stderr, "%s: %s: %s\n", manifestPath.c_str(), failure.path.c_str(), failure.reason.c_str());
+    }
+    for (const auto& duplicate : report.duplicates) {
+        std::fprintf(stderr, "%s: %s: duplicate of %s, skipped\n", manifestPath.c_str(), duplicate.path.c_str(),
+                     duplicate.duplicateOf.c_str());
+    }
+
+    // Loaded songs keep manifest order with failed entries left out, so
+    // walk both lists together to apply title overrides. A folder or a split
+    // tunebook gives a run of songs; an override only applies to an entry
+    // that gave exactly one.
+    const auto& order = manager.getOrder();
+    size_t next = 0;
+    for (const auto& song : manifest.songs) {
+        size_t first = next;
+        for (; next < order.size(); ++next) {
+            const auto& source = *manager.getDetails(order[next]).source;
+            if (!isFromEntry(source.originalFilePath, song.path)) {
+                break;
+            }
+            if (next > first && source.originalFilePath == song.path) {
+                // Another tune of the same book continues the run; anything
+                // else is the next entry using the same file
+                const auto& previous = *manager.getDetails(order[next - 1]).source;
+                if (!source.bookTune || !previous.bookTune || source.bookIndex <= previous.bookIndex) {
+                    break;
+                }
+            }
+        }
+        if (next - first == 1 && !song.title.empty()) {
+            manager.updateSongTitle(order[first], song.title);
+        }
+    }
+
+    auto total = manager.getTotalDuration(manifest.paddingSeconds, manifest.introSeconds);
+    std::printf("%s: %zu songs, total %s\n", manifestPath.c_str(), manager.songCount(), total.toString().c_str());
+
+    if (options.printCues) {
+        for (size_t position = 0; position < order.size(); ++position) {
+            auto cue = manager.getCue(position, manifest.paddingSeconds, manifest.introSeconds);
+            showtimecalc::domain::Duration start(cue.startSeconds);
+            showtimecalc::domain::Duration end(cue.endSeconds);
+            std::printf("  %2zu  %8s - %-8s  %s\n", position + 1, start.toString().c_str(), end.toString().c_str(),
+                        manager.getSong(order[position]).title.c_str());
+        }
+    }
+
+    bool success = report.failures.empty();
+    if (!options.dryRun && !manifest.outputFolder.empty()) {
+        auto exportReport = manager.exportToFolder(manifest.outputFolder, manifest.addNumbering, manifest.sync);
+        if (exportReport.success && manifest.sync) {
+            std::printf("  synced %zu files to %s: %zu written, %zu renamed, %zu unchanged, %zu removed (%.0f ms)\n",
+                        exportReport.files.size(), manifest.outputFolder.c_str(), exportReport.written,
+                        exportReport.renamed, exportReport.kept, exportReport.removed, exportReport.elapsedMs);
+        } else if (exportReport.success) {
+            std::printf("  exported %zu files (%.1f KB in %.0f ms) to %s\n", exportReport.written,
+                        exportReport.totalBytes / 1024.0, exportReport.elapsedMs, manifest.outputFolder.c_str());
+        } else {
+            std::fprintf(stderr, "%s: export failed: %s\n", manifestPath.c_str(), exportReport.error.c_str());
+            success = false;
+        }
+    }
+    if (!options.dryRun && !manifest.archivePath.empty()) {
+        auto archiveReport = manager.exportToArchive(manifest.archivePath, manifest.addNumbering);
+        if (archiveReport.success) {
+            std::printf("  archived %zu files (%.1f KB in %.0f ms) to %s\n", archiveReport.written,
+                        archiveReport.totalBytes / 1024.0, archiveReport.elapsedMs, manifest.archivePath.c_str());
+        } else {
+            std::fprintf(stderr, "%s: archive export failed: %s\n", manifestPath.c_str(),
+                         archiveReport.error.c_str());
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (options.selfTest) {
+        return setlistgui::runSelfTest(std::string()) ? 0 : 1;
+    }
+
+    auto cache = std::make_shared<setlistgui::MetadataCache>(options.cachePath);
+    if (!options.cachePath.empty()) {
+        cache->load();
+    }
+
+    size_t failed = 0;
+    for (const auto& manifestPath : options.manifests) {
+        if (!runManifest(manifestPath, options, cache)) {
+            ++failed;
+        }
+    }
+
+    if (!options.cachePath.empty()) {
+        cache->save();
+    }
+
+    auto stats = cache->stats();
+    std::printf("%zu manifest(s), %zu failed; metadata cache %zu hits, %zu misses\n",
+                options.manifests.size(), failed, stats.hits, stats.misses);
+    return failed == 0 ? 0 : 1;
+}
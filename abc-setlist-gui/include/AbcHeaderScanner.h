@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace setlistgui {
+
+// A T: line found by the scanner (views point into the scanned content)
+struct ScannedTitle {
+    std::string_view text;       // T: line content after "T:" and leading whitespace
+    std::string_view instrument; // First [bracketed] name, empty if none
+    size_t lineOffset;           // Byte offset of the "T:" in the content
+    size_t lineLength;           // Bytes up to the line ending ("\n" or "\r\n" excluded)
+};
+
+// Header fields collected from one ABC file
+struct AbcHeaderScan {
+    std::vector<ScannedTitle> titles;          // All T: lines in file order
+    std::vector<std::string_view> instruments; // Unique tags and %%part-name values, first-seen order
+    std::vector<std::string_view> composers;   // Unique C: values, first-seen order
+    std::vector<std::string_view> keys;        // Unique K: values, first-seen order
+
+    void clear() {
+        titles.clear();
+        instruments.clear();
+        composers.clear();
+        keys.clear();
+    }
+};
+
+// Single-pass scanner for the ABC header fields used by the setlist.
+// Walks the content once without regex or per-line allocations and gives
+// the same results as the line-by-line regex extraction it replaces.
+class AbcHeaderScanner {
+public:
+    // Scan content into result (previous contents are discarded)
+    static void scan(std::string_view content, AbcHeaderScan& result);
+
+    // First [..] tag of a title, empty if missing or a time signature
+    static std::string_view bracketInstrument(std::string_view title);
+};
+
+} // namespace setlistgui
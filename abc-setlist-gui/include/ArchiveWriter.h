@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace setlistgui {
+
+enum class ArchiveFormat : std::uint8_t {
+    Zip,  // Each entry deflated on its own (or stored when that is smaller)
+    Tar   // POSIX ustar, uncompressed
+};
+
+// Format named by a path's extension (.zip or .tar, any case); false if neither
+bool archiveFormatFor(const std::string& path, ArchiveFormat& format);
+
+// One file of an archive, ready to write. For zip, data is either the
+// content itself or its raw deflate stream.
+struct ArchiveEntry {
+    std::string name;
+    std::string data;
+    bool deflated = false;
+    std::uint64_t size = 0;   // Uncompressed size
+    std::uint32_t crc = 0;    // crc32 of the uncompressed content (zip only)
+};
+
+// Streams entries into a zip or tar archive in the order given; nothing is
+// buffered beyond the entry being written (zip keeps one small central
+// directory record per entry until finish). The output is reproducible:
+// timestamps, owners and permissions are fixed (1980-01-01 / mtime 0,
+// root, 0644), so the same entries always give the same bytes.
+class ArchiveWriter {
+public:
+    ArchiveWriter(std::ostream& out, ArchiveFormat format);
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // Fill error and return false on a write failure, or an entry zip or
+    // tar can't represent
+    bool add(const ArchiveEntry& entry, std::string& error);
+
+    // Write the zip central directory / tar end blocks
+    bool finish(std::string& error);
+
+    // Bytes written so far
+    std::uint64_t size() const { return offset_; }
+
+private:
+    bool write(std::string_view bytes, std::string& error);
+    bool addZip(const ArchiveEntry& entry, std::string& error);
+    bool addTar(const ArchiveEntry& entry, std::string& error);
+
+    std::ostream& out_;
+    ArchiveFormat format_;
+    std::uint64_t offset_ = 0;
+    std::uint64_t entries_ = 0;
+    std::string centralDirectory_;  // Zip: one record per entry written
+};
+
+} // namespace setlistgui
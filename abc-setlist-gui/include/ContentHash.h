@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace setlistgui {
+
+// Fast non-cryptographic 64-bit hash of file content, used to notice
+// changed files and duplicates. Processes 8 bytes per step.
+std::uint64_t contentHash(std::string_view data);
+
+} // namespace setlistgui
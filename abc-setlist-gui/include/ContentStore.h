@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace setlistgui {
+
+// Song content read back from the source files on demand. Songs keep only
+// a file identity (path, size, mtime, content hash) and their header data;
+// export fetches the bytes here. Every fetch is checked against the size
+// and hash recorded at import, so a file that changed without a reload is
+// caught rather than exported. Recently fetched contents stay in a small
+// LRU bounded by bytes. Thread-safe: export workers fetch concurrently.
+class ContentStore {
+public:
+    static constexpr size_t kDefaultBudgetBytes = 8 * 1024 * 1024;
+
+    struct Stats {
+        size_t entries = 0;
+        size_t residentBytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    explicit ContentStore(size_t budgetBytes = kDefaultBudgetBytes);
+
+    // The size bytes at offset in path (a tune of a tunebook), or with
+    // wholeFile the entire file, which must then be exactly size bytes.
+    // Fills error and returns false if the file can't be read or its bytes
+    // no longer hash to hash.
+    bool fetch(const std::string& path, std::uint64_t offset, std::uint64_t size, bool wholeFile,
+               std::uint64_t hash, std::shared_ptr<const std::string>& content, std::string& error);
+
+    void setBudget(size_t budgetBytes);
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const std::string> content;
+    };
+
+    // Drop least recently used contents until the budget is met
+    void trim();
+
+    mutable std::mutex mutex_;
+    size_t budgetBytes_;
+    size_t residentBytes_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    std::list<Entry> lru_;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+};
+
+} // namespace setlistgui
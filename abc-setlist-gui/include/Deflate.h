@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace setlistgui {
+
+// Raw DEFLATE (RFC 1951) of data as a single block with the fixed Huffman
+// codes, after a greedy LZ77 pass over a 32 KB window (hash chains, bounded
+// search). ABC text shrinks to roughly a third. Deterministic: the same
+// input always gives the same bytes.
+std::string deflateRaw(std::string_view data);
+
+// CRC-32 (the zip/gzip polynomial) of data
+std::uint32_t crc32(std::string_view data);
+
+} // namespace setlistgui
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace setlistgui {
+
+// Song durations in setlist order with prefix sums (a Fenwick tree), so
+// the total is O(1), the start time of any position is O(log n) and a
+// single duration change is O(log n) instead of re-summing the setlist.
+class DurationIndex {
+public:
+    // Replace all values (O(n) build)
+    void assign(const std::vector<int>& values);
+
+    // Append one value (O(log n))
+    void push_back(int value);
+
+    // Change the value at position (O(log n))
+    void set(size_t position, int value);
+
+    void clear();
+
+    size_t size() const { return values_.size(); }
+    int valueAt(size_t position) const { return values_[position]; }
+
+    // Sum of the first count values (O(log n))
+    long long prefixSum(size_t count) const;
+
+    // Sum of all values (O(1))
+    long long total() const { return total_; }
+
+private:
+    std::vector<int> values_;
+    std::vector<long long> tree_;  // tree_[i - 1] covers values (i - lowbit(i), i]
+    long long total_ = 0;
+};
+
+} // namespace setlistgui
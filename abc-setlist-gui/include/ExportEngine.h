@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ArchiveWriter.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace setlistgui {
+
+// One file to produce in the export folder
+struct ExportItem {
+    std::string filename;                // Name in the destination folder
+    std::string sourcePath;              // Copied as-is when render is empty
+
+    // Produces the content to write (run on a worker); fills error and
+    // returns false if it can't
+    std::function<bool(std::string& content, std::string& error)> render;
+
+    // A copied file must still be sourceSize bytes hashing to sourceHash
+    bool verifySource = false;
+    std::uint64_t sourceSize = 0;
+    std::uint64_t sourceHash = 0;
+
+    // Size and hash of what the item produces, when known without producing
+    // it; a sync export renders (or hashes the source of) the others
+    bool outputKnown = false;
+    std::uint64_t outputSize = 0;
+    std::uint64_t outputHash = 0;
+};
+
+// What a sync export did with one file
+enum class ExportAction : std::uint8_t {
+    Written,  // Produced and published
+    Renamed,  // Same content was already in the folder under another name
+    Kept      // Already in place
+};
+
+// Outcome for one exported file
+struct ExportFileResult {
+    std::string filename;
+    bool success = false;
+    std::string error;
+    ExportAction action = ExportAction::Written;
+    std::string renamedFrom;  // For Renamed
+    std::uintmax_t bytesWritten = 0;
+    double elapsedMs = 0.0;
+};
+
+// Outcome of a whole export
+struct ExportReport {
+    bool success = false;                 // Every file published
+    std::string error;                    // First failure, if any
+    std::vector<ExportFileResult> files;  // In setlist order
+    std::uintmax_t totalBytes = 0;
+    double elapsedMs = 0.0;
+
+    // File counts by action; removed counts orphans of an earlier sync
+    size_t written = 0;
+    size_t renamed = 0;
+    size_t kept = 0;
+    size_t removed = 0;
+};
+
+// Writes a set of files into a folder so that a failure never leaves a
+// half-written export behind. Files are produced in parallel into a staging
+// directory beside the target (same filesystem), flushed, and only then
+// renamed into place. If any file fails, nothing is published and the
+// staging directory is removed.
+//
+// sync() does the same but only for files that differ from what an earlier
+// sync left in the folder, as recorded in a manifest kept there (name,
+// size, mtime and hash of each file). A file already holding the right
+// content is kept, one holding it under another name (a renumbered song)
+// is renamed, the rest are written; files the last sync wrote that are no
+// longer wanted are removed. Files the manifest doesn't list are never
+// removed, but one already at a wanted name is hashed and kept if it matches.
+//
+// archive() streams the same files into one zip or tar file instead, with
+// no staging folder: entries are produced (and for zip deflated) in parallel
+// a window at a time, then written in setlist order, so memory stays bounded
+// whatever the set's size. The archive is written under a temporary name
+// and renamed over the destination once complete, so a failed export
+// leaves any earlier archive untouched.
+//
+// All three reject items sharing a file name (ignoring ASCII case) before
+// touching anything, rather than letting one song overwrite another.
+class ExportEngine {
+public:
+    static constexpr const char* kSyncManifestName = ".setlist-sync";
+
+    static ExportReport run(const std::string& folderPath, const std::vector<ExportItem>& items);
+    static ExportReport sync(const std::string& folderPath, const std::vector<ExportItem>& items);
+    static ExportReport archive(const std::string& archivePath, ArchiveFormat format,
+                                const std::vector<ExportItem>& items);
+};
+
+} // namespace setlistgui
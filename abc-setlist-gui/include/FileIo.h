@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace setlistgui {
+
+// Identity of a file version: size plus modification time in platform
+// ticks (only meant for equality checks)
+struct FileStamp {
+    std::uint64_t size = 0;
+    std::int64_t modifiedTime = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && modifiedTime == other.modifiedTime;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+// Read the current stamp of a file; false if it can't be stat'ed
+bool statFileStamp(const std::string& path, FileStamp& stamp);
+
+// Write data to path with a single write and flush it to stable storage
+bool writeFileDurable(const std::string& path, std::string_view data, std::string& error);
+
+// Copy src to dst with the cheapest kernel path available: a reflink clone,
+// then copy_file_range, then a buffered copy. dst is flushed before returning.
+bool copyFileFast(const std::string& src, const std::string& dst, std::uintmax_t& bytesCopied, std::string& error);
+
+// Flush directory entry changes such as renames (no-op where unsupported)
+void syncDirectory(const std::string& path);
+
+// A temporary name beside path, unique to this call, for a file that is
+// written and then renamed over path (so two processes saving the same file
+// never write into one temporary file)
+std::string uniqueTempPath(const std::string& path);
+
+} // namespace setlistgui
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FileIo.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace setlistgui {
+
+// Watches a set of files for changes made outside the application, such as
+// an editor saving a tune. On Linux it uses inotify on each file's folder,
+// so editors that save by writing a new file and renaming it over the old
+// one are still seen; elsewhere (or if inotify is unavailable) it polls the
+// files' size and mtime. Files whose folder can't be watched (missing, or
+// past the inotify watch limit) and files in a folder whose watch dies
+// (folder deleted, moved or replaced) are polled alongside. A burst of
+// events for one file (rapid saves) is coalesced: the file is reported
+// once it has been quiet for settleTime.
+class FileWatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FileWatcher(std::chrono::milliseconds settleTime = std::chrono::milliseconds(300),
+                         std::chrono::milliseconds pollInterval = std::chrono::milliseconds(1000));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Replace the watched set (paths are compared as given)
+    void setPaths(const std::vector<std::string>& paths);
+
+    // Files whose changes have settled since the last call
+    std::vector<std::string> takeChanged();
+
+    // Called on the watcher thread when takeChanged has something new
+    // (e.g. to wake a sleeping UI loop)
+    void setOnChange(std::function<void()> onChange);
+
+    // False when falling back to polling
+    bool usesNotifications() const { return notifyFd_ >= 0; }
+
+private:
+    void run();
+    void readNotifications();
+    void pollStamps();
+    void dropFolderWatch(int wd, bool removeWatch, Clock::time_point now);
+    void markChanged(const std::string& path, Clock::time_point now);
+
+    std::chrono::milliseconds settleTime_;
+    std::chrono::milliseconds pollInterval_;
+
+    std::mutex mutex_;
+    std::unordered_set<std::string> paths_;
+    std::unordered_set<std::string> polled_;                       // Polled despite inotify
+    std::unordered_map<std::string, FileStamp> stamps_;            // Polling: last seen stamp
+    std::unordered_map<std::string, Clock::time_point> pending_;   // Changed, waiting to settle
+    std::vector<std::string> changed_;                             // Settled, not taken yet
+    std::function<void()> onChange_;
+
+    // inotify: one watch per folder, and the watched file names in it
+    struct WatchedFolder {
+        std::string folder;
+        std::unordered_map<std::string, std::string> files;  // File name -> watched path
+    };
+    int notifyFd_ = -1;
+    std::unordered_map<int, WatchedFolder> folders_;           // By watch descriptor
+    std::unordered_map<std::string, int> folderWatches_;       // Folder -> watch descriptor
+
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+} // namespace setlistgui
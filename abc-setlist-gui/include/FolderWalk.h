@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace setlistgui {
+
+// True for ".abc" in any letter case
+bool hasAbcExtension(const std::string& path);
+
+// Called for each .abc file found under roots[root]; may be called from
+// several walker threads at once
+using FolderWalkCallback = std::function<void(size_t root, const std::string& path)>;
+
+// Walk every root folder recursively, several directories at a time, and
+// report the .abc files as they are found (in no particular order: sort by
+// path for a stable result). Symlinked folders are followed unless they lead
+// back into a folder already on the path from the root, so links can't loop.
+// Unreadable folders are skipped. Stops early once cancel is set.
+void walkAbcFiles(const std::vector<std::string>& roots, const FolderWalkCallback& onFile,
+                  const std::atomic<bool>& cancel);
+
+} // namespace setlistgui
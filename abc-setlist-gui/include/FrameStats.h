@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace setlistgui {
+
+// CPU time used by this process so far, in seconds (all threads)
+double processCpuSeconds();
+
+// Rendering activity for the debug overlay: frames rendered over the last
+// minute and the process's CPU usage, sampled about once a second.
+class FrameStats {
+public:
+    // Call once per loop iteration with the current time in seconds;
+    // rendered says whether a frame was drawn in this iteration
+    void update(double now, bool rendered);
+
+    // Frames drawn during the last 60 seconds
+    size_t framesPerMinute() const { return framesPerMinute_; }
+
+    // CPU usage over the last sample, in percent of one core
+    double cpuPercent() const { return cpuPercent_; }
+
+private:
+    std::array<size_t, 60> buckets_{};  // Frames per second, ring indexed by second
+    long long currentSecond_ = -1;
+    size_t framesPerMinute_ = 0;
+
+    double sampleTime_ = -1.0;
+    double sampleCpu_ = 0.0;
+    double cpuPercent_ = 0.0;
+};
+
+} // namespace setlistgui
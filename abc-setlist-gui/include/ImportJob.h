@@ -0,0 +1,127 @@
+#pragma once
+
+#include "SetlistManager.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace setlistgui {
+
+// Content already in the setlist when an import starts
+struct KnownContent {
+    std::unordered_set<std::uint64_t> hashes;              // Content hashes of every song
+    std::unordered_map<std::string, std::pair<FileStamp, std::uint64_t>> files;  // Whole-file songs: path -> stamp, hash
+};
+
+class ImportJob;
+
+// Duplicate checks for one file of an import, handed to the loader so it
+// can stop as early as possible: before reading a file the setlist already
+// has at the same stamp, or before parsing content it already has.
+class DuplicateCheck {
+public:
+    // A song in the setlist was read from path at this size and mtime;
+    // hash receives its content hash
+    bool isKnownFile(const std::string& path, const FileStamp& stamp, std::uint64_t& hash) const;
+
+    // Claim content for this file: false if the setlist has it, or an
+    // earlier file of the batch (in import order) has claimed it
+    bool claim(std::uint64_t hash);
+
+    // Record content left out as a duplicate (what: the file, or the file
+    // and tune for a tunebook)
+    void skip(std::string what, std::uint64_t hash);
+
+private:
+    friend class ImportJob;
+
+    ImportJob* job_ = nullptr;
+    size_t position_ = 0;             // With path_, this file's place in import order
+    const std::string* path_ = nullptr;
+    std::vector<ImportDuplicate>* skipped_ = nullptr;
+};
+
+// Reads and parses a batch of files on background workers.
+// Created by SetlistManager::startImport; once isDone() the loaded songs are
+// merged back, in the original order, by SetlistManager::finishImport on
+// the thread that owns the setlist.
+//
+// With expandFolders, any folder in the batch is walked recursively and its
+// .abc files are handed to the workers as soon as they are found, so loading
+// overlaps the walk. Each folder's files end up sorted by path, in the
+// folder's place in the batch.
+//
+// Given the content already in the setlist, the job also drops duplicates:
+// files whose content hash matches a song in the setlist or an earlier file
+// of the batch are reported instead of parsed and added.
+class ImportJob {
+public:
+    // Loads one file into songs (one song, or one per tune of a tunebook),
+    // or fills error and returns false. Duplicates go through duplicates.
+    using Loader = std::function<bool(const std::string& path, DuplicateCheck& duplicates,
+                                      std::vector<LoadedSong>& songs, std::string& error)>;
+
+    ImportJob(std::vector<std::string> paths, Loader loader, bool expandFolders = false,
+              std::shared_ptr<const KnownContent> known = nullptr);
+    ~ImportJob();
+
+    ImportJob(const ImportJob&) = delete;
+    ImportJob& operator=(const ImportJob&) = delete;
+
+    // Progress (safe to call from any thread)
+    size_t total() const { return total_.load(); }  // Grows while folders are walked
+    size_t completed() const { return completed_.load(); }
+    float progress() const;
+    bool isDone() const { return done_.load(); }
+    bool isWalking() const { return walking_.load(); }
+
+    // Ask the workers to stop; files not yet started are skipped
+    void cancel() { cancelRequested_ = true; }
+    bool isCancelled() const { return cancelRequested_.load(); }
+
+    // Block until all workers have finished
+    void wait();
+
+private:
+    friend class SetlistManager;
+    friend class DuplicateCheck;
+
+    struct Result {
+        bool attempted = false;
+        bool loaded = false;
+        std::vector<LoadedSong> songs;
+        std::vector<ImportDuplicate> duplicates;  // Left out without parsing
+        std::string error;
+    };
+
+    // Import order of a file: its place in the batch, then (for files found
+    // in a folder) its path
+    using OrderKey = std::pair<size_t, std::string>;
+
+    void run();
+    void runExpanded();
+    void load(const std::string& path, size_t position, Result& result);
+
+    std::vector<std::string> paths_;  // With expandFolders: the batch, then the files found
+    std::vector<Result> results_;
+    Loader loader_;
+    bool expandFolders_;
+    std::shared_ptr<const KnownContent> known_;  // Null: no duplicate checks (reloads)
+    std::mutex claimsMutex_;
+    std::unordered_map<std::uint64_t, OrderKey> claims_;  // Content hash -> earliest file claiming it
+    std::atomic<size_t> total_{0};
+    std::atomic<size_t> completed_{0};
+    std::atomic<bool> walking_{false};
+    std::atomic<bool> cancelRequested_{false};
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+
+} // namespace setlistgui
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace setlistgui {
+
+using InstrumentId = std::uint32_t;
+
+// Interned instrument names. Songs store small ids instead of their own
+// copies of "Fiddle", "Guitar", ..., so comparing or filtering instruments
+// is an integer compare. Owned by the setlist (not thread-safe).
+class InstrumentPool {
+public:
+    static constexpr InstrumentId kNone = 0;  // The empty name
+
+    InstrumentPool();
+
+    // Id for name, adding it on first use
+    InstrumentId intern(std::string_view name);
+
+    // Id for name if it is already in the pool
+    bool find(std::string_view name, InstrumentId& id) const;
+
+    const std::string& name(InstrumentId id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::deque<std::string> names_;  // deque keeps the map's keys valid as it grows
+    std::unordered_map<std::string_view, InstrumentId> ids_;
+};
+
+} // namespace setlistgui
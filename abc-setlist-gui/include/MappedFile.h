@@ -0,0 +1,64 @@
+#pragma once
+
+#include "FileIo.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace setlistgui {
+
+// How open() gets the bytes of a large file
+enum class MapMode : std::uint8_t {
+    Read,  // Always read into an owned buffer
+    Map    // Memory-map files of kMapThreshold bytes or more
+};
+
+// Read-only view of a file's bytes. By default the file is read into an
+// owned buffer. With MapMode::Map, files of kMapThreshold bytes or more are
+// memory-mapped instead, which is cheaper for big files; smaller ones are
+// still read.
+//
+// Only map files that are replaced by rename and never rewritten in place,
+// i.e. the app's own session, cache and staged export files. If another
+// process truncates a mapped file (editors that save in place do: nano, or
+// vim with backupcopy), touching the lost pages raises SIGBUS and kills the
+// app; on Windows an open view makes the editor's save fail. ABC sources
+// and export folders are edited by hand, so they are always read.
+class MappedFile {
+public:
+    static constexpr size_t kMapThreshold = 64 * 1024;
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Open and read (or map) path; fills error and returns false on failure
+    bool open(const std::string& path, std::string& error, MapMode mode = MapMode::Read);
+
+    // Unmap / release the file
+    void close();
+
+    // The file's bytes (valid until close or takeContents)
+    std::string_view view() const { return view_; }
+    bool isMapped() const { return mapping_ != nullptr; }
+
+    // Size and modification time observed when the file was opened
+    // (still valid after takeContents)
+    const FileStamp& stamp() const { return stamp_; }
+
+    // Hand the bytes over as a string: the read buffer is moved out for
+    // small files, mapped files are copied once. The file is closed.
+    std::string takeContents();
+
+private:
+    std::string buffer_;       // Owned bytes for small files
+    void* mapping_ = nullptr;  // Start of the mapping for large files
+    size_t mappedSize_ = 0;
+    std::string_view view_;
+    FileStamp stamp_;
+};
+
+} // namespace setlistgui
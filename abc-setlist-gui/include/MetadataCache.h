@@ -0,0 +1,90 @@
+#pragma once
+
+#include "FileIo.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace setlistgui {
+
+// One T: line as stored in the cache (its text is read back from the file)
+struct CachedTitleLine {
+    std::string instrument;
+    std::uint64_t lineOffset = 0;
+    std::uint64_t lineLength = 0;
+    std::uint64_t textOffset = 0;
+    std::uint64_t textLength = 0;
+};
+
+// Everything import derives from a file's content
+struct SongMetadata {
+    std::string title;
+    int durationSeconds = 0;
+    std::vector<CachedTitleLine> titleLines;
+    std::vector<std::string> instruments;
+    std::string key;
+    std::uint64_t contentHash = 0;
+};
+
+// On-disk cache of parsed song metadata, keyed by canonical path and
+// validated against file size + mtime (and optionally a content hash), so
+// re-importing a known library only parses files that changed.
+// Thread-safe: import workers look up and store concurrently.
+class MetadataCache {
+public:
+    struct Stats {
+        size_t entries = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    explicit MetadataCache(std::string cacheFilePath);
+
+    // Per-user cache file location
+    static std::string defaultPath();
+
+    // Load from / save to the cache file (a missing or corrupt file loads as empty)
+    bool load();
+    bool save();
+
+    // Find metadata for a file; content is only hashed and compared when
+    // verifyContent is on
+    bool lookup(const std::string& canonicalPath, const FileStamp& stamp,
+                std::string_view content, SongMetadata& metadata);
+    void store(const std::string& canonicalPath, const FileStamp& stamp, SongMetadata metadata);
+
+    // Also require a matching content hash on lookup
+    void setVerifyContent(bool verify);
+    bool verifyContent() const;
+
+    // Drop one file, or everything
+    void invalidate(const std::string& canonicalPath);
+    void clear();
+
+    // Remove entries whose files are gone or have changed; returns how many
+    size_t compact();
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        FileStamp stamp;
+        SongMetadata metadata;
+    };
+
+    std::string cacheFilePath_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    bool verifyContent_ = false;
+    std::uint64_t revision_ = 0;       // Bumped by every change to entries_
+    std::uint64_t savedRevision_ = 0;  // The revision the cache file holds
+    std::mutex saveMutex_;             // One save at a time
+};
+
+} // namespace setlistgui
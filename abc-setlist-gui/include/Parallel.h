@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace setlistgui {
+
+// Number of worker threads to use for a batch of jobs (sized to the hardware)
+size_t workerCount(size_t jobs);
+
+// Run body(i) for every i in [0, count) across workerCount(count) threads.
+// Indices are handed out one at a time so a slow file doesn't hold up a
+// whole slice of the batch. Returns once every call has finished; the first
+// exception thrown by body is rethrown on the calling thread.
+void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+} // namespace setlistgui
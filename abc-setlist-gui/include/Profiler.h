@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace setlistgui {
+
+// What a timed scope belongs to: a phase of the GUI main loop or a setlist
+// operation (import, export, reorder, ...)
+enum class ProfileCategory : std::uint8_t { Frame, Operation };
+
+// One completed scope
+struct ProfileEvent {
+    const char* name = "";  // String literal given to ProfileScope
+    ProfileCategory category = ProfileCategory::Operation;
+    std::uint32_t threadId = 0;
+    std::int64_t startUs = 0;  // Microseconds since the process started profiling
+    std::int64_t durationUs = 0;
+};
+
+// Process-wide collector for ProfileScope probes. While disabled a probe
+// costs one relaxed atomic load; while enabled completed scopes go into a
+// small ring for the debug overlay, and also into a trace buffer while a
+// trace is being recorded. Thread-safe: import and export workers record
+// from their own threads.
+class Profiler {
+public:
+    static constexpr size_t kRecentEvents = 512;
+    static constexpr size_t kFrameHistory = 240;
+    static constexpr size_t kMaxTraceEvents = 1000000;  // About 40 MB
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Monotonic microseconds since profiling started
+    static std::int64_t nowUs();
+
+    static void record(const char* name, ProfileCategory category, std::int64_t startUs, std::int64_t endUs);
+
+    // Name the calling thread in traces ("main", ...)
+    static void setThreadName(const std::string& name);
+
+    // Frame time graph (milliseconds per rendered frame, oldest first)
+    static void recordFrame(float milliseconds);
+    static std::vector<float> frameTimes();
+
+    // Slowest operations among the recent events, slowest first
+    static std::vector<ProfileEvent> slowestRecent(size_t count);
+
+    // Record every event until stopTrace writes them as Chrome trace-event
+    // JSON (opens in Perfetto or chrome://tracing)
+    static void startTrace();
+    static bool isTracing();
+    static size_t traceEventCount();
+    static bool stopTrace(const std::string& path, std::string& error);
+
+    // Default trace file: the temp folder, named after the current time
+    static std::string defaultTracePath();
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Times the enclosing scope. name must be a string literal (it's kept by
+// pointer until the trace is written).
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name, ProfileCategory category = ProfileCategory::Operation)
+        : name_(name), category_(category), active_(Profiler::enabled()) {
+        if (active_) {
+            startUs_ = Profiler::nowUs();
+        }
+    }
+    ~ProfileScope() { stop(); }
+
+    // End the scope early (for phases that don't match a C++ block)
+    void stop() {
+        if (active_) {
+            Profiler::record(name_, category_, startUs_, Profiler::nowUs());
+            active_ = false;
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    ProfileCategory category_;
+    bool active_;
+    std::int64_t startUs_ = 0;
+};
+
+} // namespace setlistgui
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "FileIo.h"
+#include "SetlistManager.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace setlistgui {
+
+// Everything about a session besides its songs
+struct SessionSettings {
+    int paddingSeconds = 5;
+    int introSeconds = 10;
+    bool addNumbering = true;
+    bool syncExport = false;
+    bool splitTunebooks = false;  // The setlist's tunebook mode (filled and applied by the manager)
+    std::string exportFolder;
+};
+
+// One song as written to a session: its card and details (title edits
+// included), and its content when the session embeds it
+struct SessionSong {
+    const SongCard* card = nullptr;
+    const SongDetails* details = nullptr;
+    std::shared_ptr<const std::string> content;
+};
+
+// Session files hold a whole setlist so it can be restored without reading
+// or parsing any source file. The layout is compact and fixed-width: a
+// header, one fixed-size record per song in setlist order, fixed-size
+// title line records, instrument references, and a string table that every
+// record points into (paths, titles and instrument names are stored once).
+// Each song's content may follow as an embedded block, so the session still
+// exports when its source files are gone. The file is memory-mapped to
+// load; a version or checksum mismatch rejects it.
+//
+// Write songs to path (through a temporary file renamed over it). With
+// embedded content, contentOffsets receives the offset of each song's block.
+bool writeSessionFile(const std::string& path, const SessionSettings& settings,
+                      const std::vector<SessionSong>& songs, const InstrumentPool& instruments,
+                      std::vector<std::uint64_t>& contentOffsets, std::string& error);
+
+// Read a session written by writeSessionFile. Songs are ready to append
+// (instruments are names); embedded content is referenced, not read.
+bool readSessionFile(const std::string& path, SessionSettings& settings, std::vector<LoadedSong>& songs,
+                     std::string& error);
+
+// A source file to check, with the content each song took from it
+struct SourceCheck {
+    struct Range {
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        std::uint64_t hash = 0;
+        bool wholeFile = true;
+    };
+    std::string path;
+    FileStamp stamp;  // Recorded when the songs were loaded
+    std::vector<Range> ranges;
+};
+
+// What a source check found
+struct SourceStatus {
+    enum class Result : std::uint8_t {
+        Unchanged,  // Size and mtime match
+        Touched,    // Stamp differs but every song's bytes still hash the same
+        Changed,    // Some song's bytes differ
+        Missing     // The file can't be read
+    };
+    std::string path;
+    FileStamp recorded;
+    FileStamp current;
+    Result result = Result::Unchanged;
+};
+
+// Checks source files against what the songs recorded, on a background
+// thread (files in parallel). A file whose stamp still matches is trusted
+// without reading it; otherwise its songs' bytes are hashed again.
+class SourceCheckJob {
+public:
+    explicit SourceCheckJob(std::vector<SourceCheck> checks);
+    ~SourceCheckJob();
+
+    SourceCheckJob(const SourceCheckJob&) = delete;
+    SourceCheckJob& operator=(const SourceCheckJob&) = delete;
+
+    size_t total() const { return checks_.size(); }
+    size_t completed() const { return completed_.load(); }
+    bool isDone() const { return done_.load(); }
+    void cancel() { cancelRequested_ = true; }
+
+    // One status per file (once isDone); files skipped by cancel are
+    // reported Unchanged
+    const std::vector<SourceStatus>& results() const { return results_; }
+
+private:
+    void run();
+
+    std::vector<SourceCheck> checks_;
+    std::vector<SourceStatus> results_;
+    std::atomic<size_t> completed_{0};
+    std::atomic<bool> cancelRequested_{false};
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+
+// Session saved on exit and restored on start, beside the metadata cache
+std::string defaultSessionPath();
+
+} // namespace setlistgui
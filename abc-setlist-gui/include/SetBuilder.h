@@ -0,0 +1,132 @@
+#pragma once
+
+#include "InstrumentPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace setlistgui {
+
+// A song the set builder may use (ids are the setlist's SongIds)
+struct SetCandidate {
+    std::uint32_t id = 0;
+    int durationSeconds = 0;
+    std::vector<InstrumentId> instruments;
+    std::string key;  // K: value as written ("D", "Ador", "E minor", ...)
+};
+
+// What to build. The show length is counted like getTotalDuration: intro,
+// every song, and padding between songs.
+struct SetBuilderOptions {
+    int targetSeconds = 45 * 60;
+    int toleranceSeconds = 0;       // Allowed distance from the target
+    int paddingSeconds = 5;
+    int introSeconds = 10;
+    std::vector<std::uint32_t> openers;  // Play first, in this order
+    std::vector<std::uint32_t> closers;  // Play last, in this order
+    int instrumentChangeWeight = 1;  // Cost per instrument picked up or put down between neighbours
+    int keyRepeatWeight = 3;         // Cost per pair of neighbours in the same key
+    std::chrono::milliseconds timeBudget{3000};
+    size_t threads = 0;              // 0: one per hardware thread
+    std::uint64_t seed = 0;          // 0: random
+};
+
+// A candidate set, in play order
+struct SetSolution {
+    std::vector<std::uint32_t> order;
+    int totalSeconds = 0;        // Show length, intro and padding included
+    int lengthError = 0;         // totalSeconds - target
+    int instrumentChanges = 0;
+    int keyRepeats = 0;
+    std::int64_t cost = 0;       // Lower is better
+    double foundAfterMs = 0.0;
+};
+
+// Builds a set of the target length from a pool of songs on background
+// threads. Each thread runs a simulated-annealing local search over which
+// songs to use and in what order (insert, remove, swap in a song of about
+// the missing length, swap, move, reverse a run), sharing the best set
+// found; a thread that stalls restarts from it. Missing the length by more
+// than the tolerance always costs more than any instrument changes or key
+// repeats, so a set that fits is preferred whenever one is found.
+//
+// The search stops when the time budget runs out, on cancel(), or when it
+// finds a set that fits with no instrument changes or key repeats. Every
+// improvement is queued for takeImprovements() as it is found.
+class SetBuilderJob {
+public:
+    SetBuilderJob(std::vector<SetCandidate> candidates, SetBuilderOptions options);
+    ~SetBuilderJob();
+
+    SetBuilderJob(const SetBuilderJob&) = delete;
+    SetBuilderJob& operator=(const SetBuilderJob&) = delete;
+
+    bool isDone() const { return done_.load(); }
+    void cancel() { cancelRequested_ = true; }
+
+    // Time searched so far, and moves tried by all threads
+    double elapsedMs() const;
+    std::uint64_t movesTried() const { return moves_.load(); }
+    const SetBuilderOptions& options() const { return options_; }
+
+    // Sets found since the last call, each better than the one before
+    std::vector<SetSolution> takeImprovements();
+
+    // Best set so far; false until the first one is found
+    bool best(SetSolution& solution) const;
+
+    // Called on a search thread after each improvement (e.g. to wake a
+    // sleeping UI loop)
+    void setOnImprovement(std::function<void()> onImprovement);
+
+private:
+    struct Score {
+        std::int64_t cost = 0;
+        int totalSeconds = 0;
+        int instrumentChanges = 0;
+        int keyRepeats = 0;
+    };
+
+    void run();
+    void search(size_t worker);
+    Score evaluate(const std::vector<std::uint32_t>& middle) const;
+    int transitionChanges(std::uint32_t from, std::uint32_t to) const;
+    void offer(const std::vector<std::uint32_t>& middle, const Score& score);
+
+    std::vector<SetCandidate> candidates_;
+    SetBuilderOptions options_;
+
+    // Pool indices: pinned songs, the free pool, and the free pool sorted
+    // by duration (for moves that look for a song of a given length)
+    std::vector<std::uint32_t> openers_;
+    std::vector<std::uint32_t> closers_;
+    std::vector<std::uint32_t> free_;
+    std::vector<std::uint32_t> byDuration_;
+    std::vector<int> keys_;                        // Normalized key per pool index (-1 if none)
+    std::vector<std::vector<InstrumentId>> instruments_;  // Sorted, without kNone
+    std::vector<std::uint16_t> changes_;           // Pairwise instrument changes (small pools only)
+
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<std::int64_t> bestCost_;
+    std::atomic<std::uint64_t> moves_{0};
+    std::atomic<bool> cancelRequested_{false};
+    std::atomic<bool> solved_{false};
+    std::atomic<bool> done_{false};
+    std::atomic<double> elapsedMs_{0.0};
+
+    mutable std::mutex mutex_;
+    bool haveBest_ = false;
+    std::vector<std::uint32_t> bestMiddle_;
+    SetSolution best_;
+    std::vector<SetSolution> improvements_;
+    std::function<void()> onImprovement_;
+
+    std::thread thread_;
+};
+
+} // namespace setlistgui
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "SetlistManager.h"
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace setlistgui {
+
+// One song as recorded in history. Immutable once recorded, so snapshots
+// share it for as long as the song is left unchanged; its source is
+// shared with the live setlist through SongDetails::source.
+struct SongState {
+    SongId id;
+    SongCard card;
+    SongDetails details;
+};
+
+using RecordedSongs = std::vector<std::shared_ptr<const SongState>>;
+
+// The whole setlist at one point in time. The song list is itself shared
+// between snapshots taken while no song changed (e.g. a run of moves).
+struct SetlistSnapshot {
+    std::shared_ptr<const RecordedSongs> songs;  // Storage order
+    std::vector<SongId> order;                   // Setlist order
+    bool splitTunebooks = false;                 // Tunebook mode (sessions replace it)
+    size_t bytes = 0;  // Approximate memory this snapshot added to the history
+};
+
+// Undo/redo stacks of setlist snapshots, bounded by memory rather than by
+// step count: the oldest undo steps are dropped once the snapshots'
+// combined size passes the budget.
+class SetlistHistory {
+public:
+    static constexpr size_t kDefaultBudgetBytes = 32 * 1024 * 1024;
+
+    explicit SetlistHistory(size_t budgetBytes = kDefaultBudgetBytes);
+
+    // Record the state before an edit; clears the redo stack
+    void push(SetlistSnapshot before);
+
+    bool canUndo() const { return !undo_.empty(); }
+    bool canRedo() const { return !redo_.empty(); }
+
+    // Step back/forward: current goes on the opposite stack and the state
+    // to restore is returned through restored
+    bool undo(SetlistSnapshot current, SetlistSnapshot& restored);
+    bool redo(SetlistSnapshot current, SetlistSnapshot& restored);
+
+    void setBudget(size_t budgetBytes);
+    size_t budget() const { return budgetBytes_; }
+    size_t bytes() const { return bytes_; }
+    size_t undoSteps() const { return undo_.size(); }
+    size_t redoSteps() const { return redo_.size(); }
+
+    void clear();
+
+private:
+    // Drop the oldest undo steps until the history fits the budget
+    void trim();
+
+    std::deque<SetlistSnapshot> undo_;  // Oldest first
+    std::vector<SetlistSnapshot> redo_; // Most recently undone last
+    size_t bytes_ = 0;
+    size_t budgetBytes_;
+};
+
+} // namespace setlistgui
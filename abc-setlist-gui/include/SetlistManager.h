@@ -1,76 +1,405 @@
 #pragma once
 
+#include "AbcHeaderScanner.h"
+#include "DurationIndex.h"
+#include "ExportEngine.h"
+#include "FileIo.h"
+#include "InstrumentPool.h"
+#include "MetadataCache.h"
+#include "SetBuilder.h"
 #include "domain/AbcSong.h"
 #include "domain/Duration.h"
 #include "services/AbcParser.h"
-#include "infrastructure/FileAbcRepository.h"
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace setlistgui {
 
+// One T: line of a song. textOffset/textLength locate the original text in
+// the song's content, so export can splice an edit in without reparsing.
 struct TitleLine {
-    std::string fullTitle;         // Complete T: line content
-    std::string originalFullTitle; // Original full title for comparison
-    std::string instrument;        // Extracted instrument name (for display)
+    std::string fullTitle;         // Edited T: line content (set only while titleEdited)
+    InstrumentId instrument;       // Instrument in this line's brackets (kNone if none)
     bool titleEdited;              // Track if full title was edited
+    size_t lineOffset;             // Byte offset of this T: line in the song's content
+    size_t lineLength;             // Length of the line, excluding its line ending
+    size_t textOffset;             // Byte offset of the title text (after "T:" and spaces)
+    size_t textLength;             // Length of the original title text
 };
 
+// Stable identity of a song in the setlist; unlike its position it does
+// not change when songs are moved or removed
+using SongId = std::uint32_t;
+constexpr SongId kInvalidSongId = UINT32_MAX;
+
+// Whether a song still matches its source file on disk
+enum class SourceState : std::uint8_t {
+    Current,       // As imported (or last reloaded)
+    Reloaded,      // The file changed on disk and the song was reloaded
+    ReloadFailed   // The file changed but is gone or no longer valid ABC; the last good header data is kept
+};
+
+// Render-facing song data, read every frame. Kept small and contiguous;
+// everything else lives in SongDetails.
 struct SongCard {
+    std::string title;             // First title (for main display)
     std::string filename;
+    std::vector<InstrumentId> instruments; // All instruments (for display), ids into the pool
+    int durationSeconds;
+    std::uint16_t partCount;       // Number of T: lines
+    bool titleEdited;              // Track if main title was edited
+    SourceState sourceState = SourceState::Current;
+};
+
+// What a song was imported from. Immutable once loaded, so it is shared
+// (not copied) between the setlist and its undo history; a reload from
+// disk swaps in a new SongSource. The content itself is not kept: only
+// enough to find it again and check it is unchanged (see ContentStore).
+struct SongSource {
     std::string originalFilePath;  // Full path to original file
-    std::string originalContent;   // Original ABC file content
-    std::string title;             // First title (for main display)
     std::string originalTitle;     // Original title for comparison
+    std::vector<std::string> titleTexts; // Original text of each T: line
+    std::string key;               // First K: value (empty if none)
+    FileStamp stamp;               // Size and mtime of the file the content was read from
+    std::uint64_t contentSize = 0; // The song's bytes: the whole file, or its tune of a tunebook
+    std::uint64_t contentHash = 0; // contentHash() of those bytes
+
+    // A tune split out of a tunebook: its content is the tune's bytes only,
+    // at bookOffset in the file; these say which tune of the file it is
+    bool bookTune = false;
+    std::uint32_t bookIndex = 0;   // Position of the tune in the book
+    std::uint64_t bookOffset = 0;  // Byte offset of the tune in the file
+    std::string bookReference;     // X: value, used to find the tune again on reload
+
+    // A copy of the content embedded in a session file (empty path if
+    // none), used when the source file can no longer supply it
+    std::string embeddedPath;
+    std::uint64_t embeddedOffset = 0;
+};
+
+// Cold song data, only touched on edit and export
+struct SongDetails {
+    std::shared_ptr<const SongSource> source;
     std::vector<TitleLine> titleLines; // All T: lines with instruments
-    int durationSeconds;
-    std::vector<std::string> instruments; // All instruments (for display)
-    int order;  // For reordering
-    bool titleEdited;              // Track if main title was edited
+
+    // Original text of a T: line, as imported
+    std::string_view originalTitleLine(size_t index) const;
+
+    // Current text of a T: line, with any edit applied
+    std::string_view titleLineText(size_t index) const;
+};
+
+// A song read by an import worker. Instruments are still names here; they
+// are interned when the song is merged into the setlist.
+struct LoadedSong {
+    SongCard card;                          // card.instruments is filled on merge
+    SongDetails details;                    // titleLines[i].instrument and source are filled on merge
+    SongSource source;
+    std::vector<std::string> instruments;   // Display list
+    std::vector<std::string> partInstruments; // Instrument of each T: line
 };
 
+// When a song plays, in seconds from the start of the show (intro and
+// padding between songs included)
+struct SongCue {
+    int startSeconds = 0;
+    int endSeconds = 0;
+};
+
+// A file that could not be added during a batch import
+struct ImportFailure {
+    std::string path;
+    std::string reason;
+};
+
+// A file (or tunebook tune) left out of an import because a song with the
+// same content is already in the setlist or earlier in the batch
+struct ImportDuplicate {
+    std::string path;           // The file, with " X:<n>" for a tunebook tune
+    std::string duplicateOf;    // Source of the song it matches (empty if that song is gone)
+    std::uint64_t hash = 0;
+};
+
+// Summary of reloading changed source files
+struct ReloadReport {
+    size_t reloaded = 0;                 // Songs whose content was replaced
+    std::vector<ImportFailure> failures; // Changed files that could not be read or parsed
+};
+
+// Summary of a batch import
+struct ImportReport {
+    size_t requested = 0;  // Files handed to the import (or found in its folders)
+    size_t added = 0;      // Songs appended to the setlist
+    size_t skipped = 0;    // Files not attempted because of cancel
+    bool cancelled = false;
+    std::vector<ImportFailure> failures;
+    std::vector<ImportDuplicate> duplicates;  // Not added: same content as another song
+};
+
+class ImportJob;
+class ContentStore;
+class DuplicateCheck;
+struct KnownContent;
+class SetlistHistory;
+class SourceCheckJob;
+struct SessionSettings;
+struct SetlistSnapshot;
+struct SongState;
+
 class SetlistManager {
 public:
     SetlistManager();
+    ~SetlistManager();
 
-    // Add song from file path
+    // Add song from file path (false if it can't be loaded, or the setlist
+    // already has a song with the same content)
     bool addSongFromFile(const std::string& filepath);
 
-    // Remove song at index
-    void removeSong(size_t index);
+    // Add songs from several files, reading and parsing them in parallel.
+    // Songs are appended in the order given; failures are reported per file.
+    // A folder adds every .abc file under it, sorted by path. Content the
+    // setlist (or an earlier file) already has is reported as a duplicate.
+    ImportReport addSongsFromFiles(const std::vector<std::string>& filepaths);
+
+    // Start a background import of files and/or folders; poll the job and
+    // call finishImport when done
+    std::unique_ptr<ImportJob> startImport(std::vector<std::string> filepaths) const;
+
+    // Tunebook mode: imports split each file into one song per X: tune,
+    // read in chunks so the whole book is never in memory. Off by default,
+    // since a multi-part song also has one X: section per part. Export
+    // writes each tune to its own file. Sessions save the mode with the
+    // setlist, so undo steps record it too and undo/redo restore it.
+    void setSplitTunebooks(bool split) { splitTunebooks_ = split; }
+    bool splitTunebooks() const { return splitTunebooks_; }
+
+    // Merge a finished (or cancelled) import job into the setlist
+    ImportReport finishImport(ImportJob& job);
+
+    // Reload source files that changed on disk, on background workers (the
+    // same job as an import); finishReload swaps the new content into every
+    // song using one of the files. Title edits are kept, and a reload is not
+    // an undo step.
+    std::unique_ptr<ImportJob> startReload(std::vector<std::string> filepaths) const;
+    ReloadReport finishReload(ImportJob& job);
+
+    // Source files of the songs in the setlist (each once)
+    std::vector<std::string> getSourcePaths() const;
+
+    // Source files whose size or mtime no longer match the loaded content
+    // (after an undo brings back an older copy, for example)
+    std::vector<std::string> findStaleSources() const;
+
+    // Bumped whenever the set of source files may have changed
+    std::uint64_t getSourceRevision() const { return sourceRevision_; }
+
+    // Use a metadata cache so unchanged files skip scanning and parsing
+    // on import (nullptr to disable)
+    void setMetadataCache(std::shared_ptr<MetadataCache> cache) { cache_ = std::move(cache); }
+    MetadataCache* getMetadataCache() const { return cache_.get(); }
+
+    // Remove song by id
+    void removeSong(SongId id);
+
+    // Move a song to a new position in the setlist
+    void moveSong(SongId id, size_t newPosition);
 
     // Reorder songs (move from oldIndex to newIndex)
     void reorderSong(size_t oldIndex, size_t newIndex);
 
+    // Search the setlist's songs for a set of a target length on background
+    // threads (see SetBuilderJob); the setlist itself is not touched
+    std::unique_ptr<SetBuilderJob> startSetBuilder(SetBuilderOptions options) const;
+
+    // Make order the setlist: listed songs in that order, all others
+    // removed. One undo step, so the full pool comes back with undo.
+    void applySetOrder(const std::vector<SongId>& order);
+
     // Update song title
-    void updateSongTitle(size_t index, const std::string& newTitle);
+    void updateSongTitle(SongId id, const std::string& newTitle);
 
     // Update full title line for specific part
-    void updateTitleLine(size_t songIndex, size_t titleLineIndex, const std::string& newFullTitle);
+    void updateTitleLine(SongId id, size_t titleLineIndex, const std::string& newFullTitle);
+
+    // Song ids in setlist order; a song's position here is its order
+    const std::vector<SongId>& getOrder() const { return order_; }
+    size_t songCount() const { return order_.size(); }
+
+    // Whether id refers to a song currently in the setlist
+    bool contains(SongId id) const { return id < slots_.size() && slots_[id] != kNoSlot; }
+
+    // Position of a song in the setlist, or false if it is not in it
+    bool positionOf(SongId id, size_t& position) const;
+
+    // Card (hot) and details (cold: title lines, content, paths) of a song
+    const SongCard& getSong(SongId id) const { return songs_[slots_[id]]; }
+    const SongDetails& getDetails(SongId id) const { return details_[slots_[id]]; }
 
-    // Get all songs
-    const std::vector<SongCard>& getSongs() const { return songs_; }
+    // Names for the instrument ids on cards and title lines
+    const InstrumentPool& getInstruments() const { return instruments_; }
 
-    // Calculate total duration with padding and intro
+    // Calculate total duration with padding and intro (O(1))
     showtimecalc::domain::Duration getTotalDuration(int paddingSeconds, int introSeconds) const;
 
-    // Export setlist - copy files to folder with edits applied
-    bool exportToFolder(const std::string& folderPath, bool addNumbering = true) const;
+    // Start and end time of the song at a position (O(log n)); padding and
+    // intro are applied on the fly, so changing them costs nothing
+    SongCue getCue(size_t position, int paddingSeconds, int introSeconds) const;
+
+    // Export setlist - copy files to folder with edits applied.
+    // Files are written in parallel and published only if all succeed.
+    // With sync, only files that differ from the folder's last sync are
+    // written (moved songs are renamed, dropped ones removed).
+    ExportReport exportToFolder(const std::string& folderPath, bool addNumbering = true, bool sync = false) const;
+
+    // Export the same files into one archive, zip or tar by the path's
+    // extension (see ExportEngine::archive)
+    ExportReport exportToArchive(const std::string& archivePath, bool addNumbering = true) const;
 
     // Clear all songs
-    void clear() { songs_.clear(); }
+    void clear();
+
+    // Save the setlist (order, cards, title edits and where each song came
+    // from) with settings to a session file. With embedContent every song's
+    // bytes are stored too, so the session still exports when its source
+    // files are gone.
+    bool saveSession(const std::string& path, const SessionSettings& settings, bool embedContent,
+                     std::string& error);
+
+    // Replace the setlist with a saved session (one undo step). Songs come
+    // straight from the file's records, so no source file is read or
+    // parsed; check them afterwards with startSourceCheck.
+    bool loadSession(const std::string& path, SessionSettings& settings, std::string& error);
+
+    // Check every source file against what its songs recorded, in the
+    // background. finishSourceCheck adopts the new stamp of files that were
+    // only touched and returns the files that changed or are gone (pass
+    // them to startReload).
+    std::unique_ptr<SourceCheckJob> startSourceCheck() const;
+    std::vector<std::string> finishSourceCheck(SourceCheckJob& job);
+
+    // Undo/redo of adds, removes, moves, title edits and clear. Snapshots
+    // share unchanged songs, so the history costs little per step.
+    bool canUndo() const;
+    bool canRedo() const;
+    bool undo();
+    bool redo();
+
+    // History size and memory budget (oldest steps are dropped past it)
+    const SetlistHistory& getHistory() const { return *history_; }
+
+    // Where export reads song content back from (bounded LRU)
+    ContentStore& getContentStore() const { return *contents_; }
+    void setHistoryBudget(size_t budgetBytes);
 
 private:
-    std::vector<SongCard> songs_;
+    static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+
+    // Songs are stored densely in slots (in no particular order) and the
+    // setlist order is a separate list of ids, so moving a song shifts
+    // 4-byte ids instead of copying cards and content
+    std::vector<SongCard> songs_;      // Hot data, walked every frame
+    std::vector<SongDetails> details_; // Cold data, same slot as songs_
+    std::vector<SongId> slotIds_;      // Id of the song in each slot
+    std::vector<std::uint32_t> slots_; // Slot of each id ever issued (kNoSlot once removed)
+    std::vector<SongId> order_;
+    DurationIndex durations_;          // Durations in setlist order, kept in step with order_
+    std::unique_ptr<SetlistHistory> history_;
+    std::unique_ptr<ContentStore> contents_;
+    std::vector<std::shared_ptr<const SongState>> recorded_; // Last recorded state of each slot (null once changed)
+    std::shared_ptr<const std::vector<std::shared_ptr<const SongState>>> recordedSongs_; // Null once any slot changed
+    InstrumentPool instruments_;
     std::shared_ptr<showtimecalc::services::AbcParser> parser_;
-    std::shared_ptr<showtimecalc::infrastructure::FileAbcRepository> repository_;
+    std::shared_ptr<MetadataCache> cache_;
+    std::uint64_t sourceRevision_ = 0;
+    bool splitTunebooks_ = false;
+
+    // Content hash -> a song with that content, for O(1) duplicate checks.
+    // Appends keep it current; any other source change (remove, reload,
+    // undo) leaves it behind sourceRevision_ and it is rebuilt on next use.
+    std::unordered_map<std::uint64_t, SongId> songsByHash_;
+    std::uint64_t hashIndexRevision_ = 0;
+
+    // Read and parse one file into a card (touches no setlist state, so it
+    // is safe to run on import workers); cache and duplicates may be null.
+    // A duplicate returns true with nothing in songs.
+    static bool loadSongCard(const showtimecalc::services::AbcParser& parser, MetadataCache* cache,
+                             DuplicateCheck* duplicates, const std::string& filepath,
+                             std::vector<LoadedSong>& songs, std::string& error);
+
+    // Read a tunebook into one song per valid tune (cards are named after
+    // the book and the tune's X: value); the metadata cache is not used
+    static bool loadTunebook(const showtimecalc::services::AbcParser& parser, DuplicateCheck* duplicates,
+                             const std::string& filepath, std::vector<LoadedSong>& songs, std::string& error);
+
+    // The hash index, rebuilt first if out of date
+    const std::unordered_map<std::uint64_t, SongId>& hashIndex();
+    std::shared_ptr<const KnownContent> knownContent() const;
+
+    // Scan and parse content (whose contentHash is hash) into song, whose
+    // filename must be set
+    static bool parseSongContent(const showtimecalc::services::AbcParser& parser, std::string content,
+                                 std::uint64_t hash, LoadedSong& song, std::string& error);
+
+    // Start an ImportJob loading filepaths, splitting those in tunebooks
+    // (or all of them, with splitAll) into their tunes. known enables
+    // duplicate checks against it.
+    std::unique_ptr<ImportJob> startLoading(std::vector<std::string> filepaths, bool expandFolders, bool splitAll,
+                                            std::unordered_set<std::string> tunebooks,
+                                            std::shared_ptr<const KnownContent> known) const;
+
+    // Intern a loaded song's instruments and append it to the end of the setlist
+    void appendSong(LoadedSong song);
+
+    // Drop a song's storage, moving the last slot into its place (order_ and
+    // durations are left to the caller)
+    void eraseSlot(std::uint32_t slot);
+
+    // Swap reloaded content into a song, keeping the user's title edits
+    void applyReload(std::uint32_t slot, const LoadedSong& loaded, const std::shared_ptr<const SongSource>& source,
+                     const std::vector<InstrumentId>& partInstruments);
+
+    // Rebuild a card's instrument list from its title lines after an edit
+    void refreshInstruments(size_t slot);
+
+    // Record the current state as an undo step before an edit. retainedBytes
+    // is content the step keeps alive on its own (removed songs).
+    void recordUndoStep(size_t retainedBytes = 0);
+
+    // Record an undo step that keeps every song alive, then empty the setlist
+    void recordAndClear();
+
+    // Recompute durations_ from order_ (O(n), after removes and restores)
+    void rebuildDurations();
+
+    // Snapshot the setlist, reusing the recorded state of unchanged songs
+    SetlistSnapshot captureSnapshot();
+    void restoreSnapshot(const SetlistSnapshot& snapshot);
+
+    // One export item per song, in setlist order; render callbacks refer to
+    // the setlist, so it must not change until the export is done
+    std::vector<ExportItem> makeExportItems(bool addNumbering) const;
+
+    // Content of an edited song with its T: line changes applied
+    static std::string renderEditedContent(const SongCard& card, const SongDetails& details, const std::string& content);
+
+    // Read a song's content back from its source file (verified against the
+    // size and hash recorded at import)
+    bool fetchContent(const SongSource& source, std::shared_ptr<const std::string>& content, std::string& error) const;
+
+    // Build the instrument display list from a header scan
+    static std::vector<std::string> makeInstruments(const AbcHeaderScan& scan);
 
-    // Extract instruments from ABC file content
-    std::vector<std::string> extractInstruments(const std::string& content);
+    // Fill a loaded song's title lines and part instruments from a header scan
+    static void makeTitleLines(const AbcHeaderScan& scan, std::string_view content, LoadedSong& song);
 
-    // Extract all title lines with instruments
-    std::vector<TitleLine> extractTitleLines(const std::string& content);
+    // Convert between a freshly parsed song and its cache entry
+    static SongMetadata makeMetadata(const LoadedSong& song);
+    static void applyMetadata(const SongMetadata& metadata, LoadedSong& song);
 };
 
 } // namespace setlistgui
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace setlistgui {
+
+// One song entry of a manifest
+struct ManifestSong {
+    std::string path;   // Resolved against the manifest's folder
+    std::string title;  // Replacement main title, empty to keep the file's
+};
+
+// A setlist described in a text file, for headless runs:
+//
+//   # comment
+//   output = exported/friday     (optional; no export without it)
+//   padding = 5                  (seconds between songs)
+//   intro = 10                   (seconds before the first song)
+//   numbering = true             (01_, 02_ prefixes on export)
+//   sync = true                  (only rewrite files changed since the last sync)
+//   archive = friday.zip         (optional; also export into a .zip or .tar)
+//   song = tunes/reel.abc
+//   title = Reel (Encore)        (overrides the title of the song above)
+//
+// Relative paths are resolved against the manifest's folder.
+struct SetlistManifest {
+    std::string path;
+    std::string outputFolder;
+    std::string archivePath;
+    int paddingSeconds = 5;
+    int introSeconds = 10;
+    bool addNumbering = true;
+    bool sync = false;
+    std::vector<ManifestSong> songs;
+};
+
+// Parse a manifest file; fills error (with the line number) and returns
+// false on failure
+bool readManifest(const std::string& path, SetlistManifest& manifest, std::string& error);
+
+} // namespace setlistgui
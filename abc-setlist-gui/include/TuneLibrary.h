@@ -0,0 +1,138 @@
+#pragma once
+
+#include "FileIo.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace setlistgui {
+
+// One .abc file in the tune library, described by the same header data the
+// setlist extracts on import (plus composer and key)
+struct LibraryTune {
+    std::string path;
+    std::string filename;
+    std::string title;                     // First T: line, or the file name
+    std::vector<std::string> instruments;  // Bracketed tags and %%part-name values
+    std::vector<std::string> composers;    // C: values
+    std::vector<std::string> keys;         // K: values
+    FileStamp stamp;
+};
+
+// Read and scan one file into a library entry
+bool scanLibraryTune(const std::string& path, LibraryTune& tune, std::string& error);
+
+// Result of a library search
+struct LibrarySearchResult {
+    std::vector<std::uint32_t> ids;  // Matching tunes (at most the requested limit), in library order
+    size_t matched = 0;              // All matches, including those past the limit
+};
+
+// In-memory search index over the library. Every tune's header fields are
+// lowercased into one text, and a trigram inverted index (split into shards
+// so it can be built in parallel) narrows a query down to the few tunes
+// whose text is then checked. Terms are matched as substrings, all terms
+// must match, and a term can be limited to one field with an ABC-style
+// prefix: "t:" title, "i:" instrument/part, "c:" composer, "k:" key.
+//
+// Updates are incremental: a changed tune is appended under a new id and
+// its old entry tombstoned, so posting lists stay sorted without rewriting
+// them; the index compacts itself once half its entries are dead.
+// Not thread-safe: build it on a worker, then use it from one thread.
+class TuneIndex {
+public:
+    static constexpr size_t kShards = 16;
+
+    // Replace the contents (parallel build)
+    void assign(std::vector<LibraryTune> tunes);
+
+    // Add a tune, replacing any tune with the same path
+    void update(LibraryTune tune);
+
+    // Drop the tune at path; false if it isn't indexed
+    bool remove(const std::string& path);
+
+    bool contains(const std::string& path) const { return byPath_.count(path) != 0; }
+    size_t size() const { return byPath_.size(); }
+    const LibraryTune& tune(std::uint32_t id) const { return entries_[id].tune; }
+
+    // Tunes matching every term of query, up to limit (an empty query matches everything)
+    LibrarySearchResult search(std::string_view query, size_t limit) const;
+
+    // Copies of the live tunes, in library order (for rescans)
+    std::vector<LibraryTune> tunes() const;
+
+private:
+    enum Field : std::uint8_t { kTitle, kInstruments, kComposers, kKeys, kFilename, kFieldCount };
+
+    struct Entry {
+        LibraryTune tune;
+        std::string text;                        // Lowercased fields, separated by '\n'
+        std::array<std::uint32_t, kFieldCount> fieldEnd{};  // End of each field in text
+        bool alive = true;
+    };
+
+    using Postings = std::unordered_map<std::uint32_t, std::vector<std::uint32_t>>;
+
+    static void fillText(Entry& entry);
+    static void collectTrigrams(std::string_view text, std::vector<std::uint32_t>& trigrams);
+    static size_t shardOf(std::uint32_t trigram);
+    void index(std::uint32_t id, const std::vector<std::uint32_t>& trigrams);
+
+    std::vector<Entry> entries_;                          // By id; dead entries stay until compaction
+    std::unordered_map<std::string, std::uint32_t> byPath_;
+    std::array<Postings, kShards> shards_;                // Trigram -> ascending ids
+    size_t dead_ = 0;
+};
+
+// Builds a TuneIndex from library folders on a background thread: the
+// folders are walked for .abc files, new or changed files are scanned in
+// parallel (tunes from a previous index are reused while their size and
+// mtime match) and the index is built. Poll isDone() and take the index.
+class LibraryScanJob {
+public:
+    LibraryScanJob(std::vector<std::string> folders, std::vector<LibraryTune> known);
+    ~LibraryScanJob();
+
+    LibraryScanJob(const LibraryScanJob&) = delete;
+    LibraryScanJob& operator=(const LibraryScanJob&) = delete;
+
+    size_t total() const { return total_.load(); }
+    size_t completed() const { return completed_.load(); }
+    bool isDone() const { return done_.load(); }
+    void cancel() { cancelRequested_ = true; }
+
+    // The finished index (once isDone, and only once)
+    std::unique_ptr<TuneIndex> takeIndex() { return std::move(index_); }
+
+    // Files that could not be read, and how long the scan took
+    size_t failed() const { return failed_; }
+    double elapsedMs() const { return elapsedMs_; }
+
+private:
+    void run();
+
+    std::vector<std::string> folders_;
+    std::vector<LibraryTune> known_;
+    std::unique_ptr<TuneIndex> index_;
+    size_t failed_ = 0;
+    double elapsedMs_ = 0.0;
+    std::atomic<size_t> total_{0};
+    std::atomic<size_t> completed_{0};
+    std::atomic<bool> cancelRequested_{false};
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+
+// Library folder list, one path per line, kept beside the metadata cache
+std::string defaultLibraryFoldersPath();
+std::vector<std::string> loadLibraryFolders(const std::string& path);
+bool saveLibraryFolders(const std::string& path, const std::vector<std::string>& folders, std::string& error);
+
+} // namespace setlistgui
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "FileIo.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace setlistgui {
+
+// One X: tune read out of a tunebook
+struct BookTune {
+    std::uint32_t index = 0;    // Position in the book, from 0
+    std::uint64_t offset = 0;   // Where the tune starts in the file
+    std::string reference;      // Value of its X: field
+    std::string content;        // From the X: line up to the next tune's X: line
+};
+
+// Splits a tunebook (one file holding many X: tunes) into its tunes while
+// reading it in chunks, so memory stays at about one chunk plus the largest
+// tune however big the book is. Text before the first X: line (the book's
+// file header) is not part of any tune.
+class TunebookReader {
+public:
+    static constexpr size_t kChunkSize = 256 * 1024;
+
+    // Called once per tune, in file order; content may be moved out.
+    // Return false to stop reading.
+    using TuneCallback = std::function<bool(BookTune& tune)>;
+
+    // Read path, calling onTune for each tune; stamp receives the file's
+    // size and mtime. Fills error and returns false if the file can't be read.
+    static bool read(const std::string& path, const TuneCallback& onTune, FileStamp& stamp, std::string& error);
+};
+
+// File name for a tune exported on its own: "<book name>_X<reference>.abc"
+// (the tune's position is used if the reference has no usable characters).
+// Books often repeat X: numbers, so withPosition adds the tune's position
+// ("<book name>_X<reference>_<position>.abc") to tell such tunes apart.
+std::string bookTuneFilename(const std::string& bookPath, const BookTune& tune, bool withPosition = false);
+
+} // namespace setlistgui
@@ -0,0 +1,147 @@
+#include "AbcHeaderScanner.h"
+#include <algorithm>
+
+namespace setlistgui {
+
+namespace {
+
+constexpr std::string_view kTitlePrefix = "T:";
+constexpr std::string_view kPartNamePrefix = "%%part-name";
+constexpr std::string_view kComposerPrefix = "C:";
+constexpr std::string_view kKeyPrefix = "K:";
+
+// Characters matched by \s in the regex "C" locale
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Characters the regex '.' refuses to match
+bool isLineTerminator(char c) {
+    return c == '\n' || c == '\r';
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Equivalent of the "\s*(.+)" / "\s+(.+)" tail of the old header regexes.
+// The whitespace run backtracks until (.+) can take at least one character,
+// so "T:  " captures " " and a trailing '\r' is never part of the value.
+bool captureValue(std::string_view rest, size_t minSpaces, std::string_view& value) {
+    size_t spaces = 0;
+    while (spaces < rest.size() && isSpace(rest[spaces])) {
+        ++spaces;
+    }
+    if (spaces < minSpaces) {
+        return false;
+    }
+
+    for (size_t start = spaces;; --start) {
+        if (start < rest.size() && !isLineTerminator(rest[start])) {
+            size_t end = start;
+            while (end < rest.size() && !isLineTerminator(rest[end])) {
+                ++end;
+            }
+            value = rest.substr(start, end - start);
+            return true;
+        }
+        if (start == minSpaces) {
+            return false;
+        }
+    }
+}
+
+// Filter out time signatures (like "4:22") and keep instrument names
+bool isInstrumentName(std::string_view tag) {
+    return !tag.empty() && tag.find(':') == std::string_view::npos;
+}
+
+void addUnique(std::vector<std::string_view>& instruments, std::string_view name) {
+    if (std::find(instruments.begin(), instruments.end(), name) == instruments.end()) {
+        instruments.push_back(name);
+    }
+}
+
+// Collect every [..] and (..) tag, matching left to right like sregex_iterator
+void addTitleTags(std::string_view title, std::vector<std::string_view>& instruments) {
+    bool squareClosed = true; // Whether a ']' may still follow
+    bool roundClosed = true;  // Whether a ')' may still follow
+
+    size_t pos = 0;
+    while (pos < title.size()) {
+        char open = title[pos];
+        bool square = (open == '[' && squareClosed);
+        bool round = (open == '(' && roundClosed);
+
+        if (square || round) {
+            size_t close = title.find(square ? ']' : ')', pos + 1);
+            if (close != std::string_view::npos) {
+                std::string_view tag = title.substr(pos + 1, close - pos - 1);
+                if (isInstrumentName(tag)) {
+                    addUnique(instruments, tag);
+                }
+                pos = close + 1;
+                continue;
+            }
+            (square ? squareClosed : roundClosed) = false;
+        }
+        ++pos;
+    }
+}
+
+} // namespace
+
+void AbcHeaderScanner::scan(std::string_view content, AbcHeaderScan& result) {
+    result.clear();
+
+    size_t lineStart = 0;
+    while (lineStart < content.size()) {
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = content.size();
+        }
+        std::string_view line = content.substr(lineStart, lineEnd - lineStart);
+        std::string_view value;
+
+        if (startsWith(line, kTitlePrefix)) {
+            if (captureValue(line.substr(kTitlePrefix.size()), 0, value)) {
+                size_t lineLength = line.size();
+                if (lineLength > 0 && line[lineLength - 1] == '\r') {
+                    --lineLength;  // Keep CRLF endings intact when the line is rewritten
+                }
+                result.titles.push_back({value, bracketInstrument(value), lineStart, lineLength});
+                addTitleTags(value, result.instruments);
+            }
+        } else if (startsWith(line, kPartNamePrefix)) {
+            if (captureValue(line.substr(kPartNamePrefix.size()), 1, value)) {
+                addUnique(result.instruments, value);
+            }
+        } else if (startsWith(line, kComposerPrefix)) {
+            if (captureValue(line.substr(kComposerPrefix.size()), 0, value)) {
+                addUnique(result.composers, value);
+            }
+        } else if (startsWith(line, kKeyPrefix)) {
+            if (captureValue(line.substr(kKeyPrefix.size()), 0, value)) {
+                addUnique(result.keys, value);
+            }
+        }
+
+        lineStart = lineEnd + 1;
+    }
+}
+
+std::string_view AbcHeaderScanner::bracketInstrument(std::string_view title) {
+    size_t open = title.find('[');
+    if (open == std::string_view::npos) {
+        return {};
+    }
+    size_t close = title.find(']', open + 1);
+    if (close == std::string_view::npos) {
+        return {};
+    }
+
+    std::string_view tag = title.substr(open + 1, close - open - 1);
+    return isInstrumentName(tag) ? tag : std::string_view();
+}
+
+} // namespace setlistgui
@@ -0,0 +1,205 @@
+#include "ArchiveWriter.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace setlistgui {
+
+namespace {
+
+// Zip: version 2.0 (deflate), made by Unix so the 0644 mode is kept;
+// bit 11 marks names as UTF-8. Every entry is dated 1980-01-01 00:00.
+constexpr std::uint16_t kZipVersion = 20;
+constexpr std::uint16_t kZipMadeBy = (3 << 8) | kZipVersion;
+constexpr std::uint16_t kZipUtf8 = 1 << 11;
+constexpr std::uint16_t kZipStored = 0;
+constexpr std::uint16_t kZipDeflated = 8;
+constexpr std::uint16_t kZipTime = 0;
+constexpr std::uint16_t kZipDate = (0 << 9) | (1 << 5) | 1;
+constexpr std::uint32_t kZipFileMode = 0100644u << 16;
+constexpr std::uint64_t kZipLimit = 0xFFFFFFFFu;  // No zip64
+constexpr std::uint64_t kZipMaxEntries = 0xFFFF;
+
+constexpr size_t kTarBlock = 512;
+constexpr size_t kTarNameLength = 100;
+constexpr std::uint64_t kTarMaxSize = 077777777777ull;  // 11 octal digits
+
+void put16(std::string& out, std::uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void put32(std::string& out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// A zero-padded octal field of a tar header, NUL-terminated
+void putOctal(char* field, size_t width, std::uint64_t value) {
+    std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1), static_cast<unsigned long long>(value));
+}
+
+// One ustar header block
+std::string tarHeader(std::string_view name, std::uint64_t size, char type) {
+    std::string header(kTarBlock, '\0');
+    char* block = &header[0];
+    std::copy(name.begin(), name.begin() + static_cast<std::ptrdiff_t>(std::min(name.size(), kTarNameLength)), block);
+    putOctal(block + 100, 8, 0644);  // mode
+    putOctal(block + 108, 8, 0);     // uid
+    putOctal(block + 116, 8, 0);     // gid
+    putOctal(block + 124, 12, size);
+    putOctal(block + 136, 12, 0);    // mtime
+    block[156] = type;
+    std::copy_n("ustar", 6, block + 257);
+    std::copy_n("00", 2, block + 263);
+
+    // Checksum: byte sum with the checksum field counted as spaces
+    std::fill(block + 148, block + 156, ' ');
+    unsigned checksum = 0;
+    for (char c : header) {
+        checksum += static_cast<unsigned char>(c);
+    }
+    std::snprintf(block + 148, 7, "%06o", checksum);
+    block[155] = ' ';
+    return header;
+}
+
+std::string tarPadding(std::uint64_t size) {
+    return std::string(static_cast<size_t>((kTarBlock - size % kTarBlock) % kTarBlock), '\0');
+}
+
+} // namespace
+
+bool archiveFormatFor(const std::string& path, ArchiveFormat& format) {
+    auto endsWith = [&](std::string_view suffix) {
+        if (path.size() < suffix.size()) {
+            return false;
+        }
+        return std::equal(suffix.begin(), suffix.end(), path.end() - static_cast<std::ptrdiff_t>(suffix.size()),
+                          [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+    };
+    if (endsWith(".zip")) {
+        format = ArchiveFormat::Zip;
+        return true;
+    }
+    if (endsWith(".tar")) {
+        format = ArchiveFormat::Tar;
+        return true;
+    }
+    return false;
+}
+
+ArchiveWriter::ArchiveWriter(std::ostream& out, ArchiveFormat format)
+    : out_(out), format_(format) {
+}
+
+bool ArchiveWriter::add(const ArchiveEntry& entry, std::string& error) {
+    return format_ == ArchiveFormat::Zip ? addZip(entry, error) : addTar(entry, error);
+}
+
+bool ArchiveWriter::write(std::string_view bytes, std::string& error) {
+    out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out_) {
+        error = "Cannot write the archive";
+        return false;
+    }
+    offset_ += bytes.size();
+    return true;
+}
+
+bool ArchiveWriter::addZip(const ArchiveEntry& entry, std::string& error) {
+    if (entries_ >= kZipMaxEntries || offset_ > kZipLimit || entry.size > kZipLimit ||
+        entry.data.size() > kZipLimit || entry.name.size() > 0xFFFF) {
+        error = "Too large for a zip archive (use .tar): " + entry.name;
+        return false;
+    }
+
+    // Fields shared by the local header and the central directory record
+    std::string common;
+    put16(common, kZipVersion);
+    put16(common, kZipUtf8);
+    put16(common, entry.deflated ? kZipDeflated : kZipStored);
+    put16(common, kZipTime);
+    put16(common, kZipDate);
+    put32(common, entry.crc);
+    put32(common, static_cast<std::uint32_t>(entry.data.size()));
+    put32(common, static_cast<std::uint32_t>(entry.size));
+    put16(common, static_cast<std::uint16_t>(entry.name.size()));
+    put16(common, 0);  // Extra field length
+
+    auto localOffset = static_cast<std::uint32_t>(offset_);
+    std::string local;
+    put32(local, 0x04034B50);
+    local += common;
+    local += entry.name;
+    if (!write(local, error) || !write(entry.data, error)) {
+        return false;
+    }
+
+    put32(centralDirectory_, 0x02014B50);
+    put16(centralDirectory_, kZipMadeBy);
+    centralDirectory_ += common;
+    put16(centralDirectory_, 0);  // Comment length
+    put16(centralDirectory_, 0);  // Disk number
+    put16(centralDirectory_, 0);  // Internal attributes
+    put32(centralDirectory_, kZipFileMode);
+    put32(centralDirectory_, localOffset);
+    centralDirectory_ += entry.name;
+    ++entries_;
+    return true;
+}
+
+bool ArchiveWriter::addTar(const ArchiveEntry& entry, std::string& error) {
+    if (entry.deflated) {
+        error = "A tar entry must be stored, not deflated: " + entry.name;
+        return false;
+    }
+    if (entry.data.size() > kTarMaxSize) {
+        error = "Too large for a tar archive: " + entry.name;
+        return false;
+    }
+
+    // Names past the ustar limit go in a pax extended header first
+    if (entry.name.size() > kTarNameLength) {
+        std::string record = " path=" + entry.name + "\n";
+        size_t length = record.size();
+        while (std::to_string(length).size() + record.size() != length) {
+            length = std::to_string(length).size() + record.size();
+        }
+        record = std::to_string(length) + record;
+        if (!write(tarHeader("././@PaxHeader", record.size(), 'x'), error) || !write(record, error) ||
+            !write(tarPadding(record.size()), error)) {
+            return false;
+        }
+    }
+    if (!write(tarHeader(entry.name, entry.data.size(), '0'), error) || !write(entry.data, error) ||
+        !write(tarPadding(entry.data.size()), error)) {
+        return false;
+    }
+    ++entries_;
+    return true;
+}
+
+bool ArchiveWriter::finish(std::string& error) {
+    if (format_ == ArchiveFormat::Tar) {
+        return write(std::string(2 * kTarBlock, '\0'), error);
+    }
+
+    if (offset_ > kZipLimit) {
+        error = "Too large for a zip archive (use .tar)";
+        return false;
+    }
+    std::string end;
+    put32(end, 0x06054B50);
+    put16(end, 0);  // This disk
+    put16(end, 0);  // Disk with the central directory
+    put16(end, static_cast<std::uint16_t>(entries_));
+    put16(end, static_cast<std::uint16_t>(entries_));
+    put32(end, static_cast<std::uint32_t>(centralDirectory_.size()));
+    put32(end, static_cast<std::uint32_t>(offset_));
+    put16(end, 0);  // Comment length
+    return write(centralDirectory_, error) && write(end, error);
+}
+
+} // namespace setlistgui
@@ -0,0 +1,49 @@
+#include "ContentHash.h"
+#include <cstring>
+
+namespace setlistgui {
+
+namespace {
+
+constexpr std::uint64_t kMultiplier1 = 0x9E3779B97F4A7C15ull;
+constexpr std::uint64_t kMultiplier2 = 0xC2B2AE3D27D4EB4Full;
+
+std::uint64_t rotateLeft(std::uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Final avalanche (from MurmurHash3's fmix64)
+std::uint64_t finalize(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace
+
+std::uint64_t contentHash(std::string_view data) {
+    std::uint64_t h = 0x27D4EB2F165667C5ull ^ (static_cast<std::uint64_t>(data.size()) * kMultiplier1);
+    const char* p = data.data();
+    size_t remaining = data.size();
+
+    while (remaining >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = rotateLeft(h ^ (word * kMultiplier2), 31) * kMultiplier1;
+        p += 8;
+        remaining -= 8;
+    }
+
+    std::uint64_t tail = 0;
+    if (remaining > 0) {
+        std::memcpy(&tail, p, remaining);
+    }
+    h = rotateLeft(h ^ (tail * kMultiplier2), 31) * kMultiplier1;
+
+    return finalize(h);
+}
+
+} // namespace setlistgui
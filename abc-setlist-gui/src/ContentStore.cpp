@@ -0,0 +1,116 @@
+#include "ContentStore.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include <fstream>
+
+namespace setlistgui {
+
+namespace {
+
+std::string keyFor(const std::string& path, std::uint64_t offset, std::uint64_t hash) {
+    return path + '\n' + std::to_string(offset) + '\n' + std::to_string(hash);
+}
+
+bool readRange(const std::string& path, std::uint64_t offset, std::uint64_t size, std::string& content,
+               std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "Cannot open " + path;
+        return false;
+    }
+    content.resize(static_cast<size_t>(size));
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(&content[0], static_cast<std::streamsize>(size));
+    if (static_cast<std::uint64_t>(in.gcount()) != size) {
+        error = path + " is shorter than when it was loaded";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ContentStore::ContentStore(size_t budgetBytes)
+    : budgetBytes_(budgetBytes) {
+}
+
+bool ContentStore::fetch(const std::string& path, std::uint64_t offset, std::uint64_t size, bool wholeFile,
+                         std::uint64_t hash, std::shared_ptr<const std::string>& content, std::string& error) {
+    std::string key = keyFor(path, offset, hash);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            content = it->second->content;
+            ++hits_;
+            return true;
+        }
+        ++misses_;
+    }
+
+    // Read and verify outside the lock, so workers fetch in parallel
+    ProfileScope probe("fetchContent");
+    std::string bytes;
+    if (wholeFile) {
+        MappedFile file;
+        if (!file.open(path, error)) {
+            return false;
+        }
+        if (file.view().size() != size) {
+            error = path + " changed on disk since it was loaded";
+            return false;
+        }
+        bytes = file.takeContents();
+    } else if (!readRange(path, offset, size, bytes, error)) {
+        return false;
+    }
+    if (contentHash(bytes) != hash) {
+        error = path + " changed on disk since it was loaded";
+        return false;
+    }
+    content = std::make_shared<const std::string>(std::move(bytes));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(key) == 0 && content->size() <= budgetBytes_) {
+        lru_.push_front({key, content});
+        entries_.emplace(std::move(key), lru_.begin());
+        residentBytes_ += content->size();
+        trim();
+    }
+    return true;
+}
+
+void ContentStore::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budgetBytes_ = budgetBytes;
+    trim();
+}
+
+void ContentStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    entries_.clear();
+    residentBytes_ = 0;
+}
+
+ContentStore::Stats ContentStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.entries = entries_.size();
+    stats.residentBytes = residentBytes_;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    return stats;
+}
+
+void ContentStore::trim() {
+    while (residentBytes_ > budgetBytes_ && !lru_.empty()) {
+        residentBytes_ -= lru_.back().content->size();
+        entries_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+}
+
+} // namespace setlistgui
@@ -0,0 +1,228 @@
+#include "Deflate.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace setlistgui {
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr int kMaxChain = 64;  // Candidates tried per position
+constexpr int kHashBits = 15;
+
+// Length codes 257..285 and distance codes 0..29: first value of each
+// code and its number of extra bits
+constexpr std::array<std::uint16_t, 29> kLengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                       31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<std::uint8_t, 29> kLengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                       2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<std::uint16_t, 30> kDistanceBase = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                         33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                         1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<std::uint8_t, 30> kDistanceExtra = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                         6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+std::uint32_t reverseBits(std::uint32_t code, int length) {
+    std::uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+// The fixed literal/length code (RFC 1951 3.2.6), bit-reversed so it can
+// be written LSB first
+struct FixedCodes {
+    std::array<std::uint16_t, 288> literal{};
+    std::array<std::uint8_t, 288> literalLength{};
+    std::array<std::uint8_t, 30> distance{};
+
+    FixedCodes() {
+        for (std::uint32_t symbol = 0; symbol < 288; ++symbol) {
+            std::uint32_t code;
+            int length;
+            if (symbol < 144) {
+                code = 0x30 + symbol;
+                length = 8;
+            } else if (symbol < 256) {
+                code = 0x190 + (symbol - 144);
+                length = 9;
+            } else if (symbol < 280) {
+                code = symbol - 256;
+                length = 7;
+            } else {
+                code = 0xC0 + (symbol - 280);
+                length = 8;
+            }
+            literal[symbol] = static_cast<std::uint16_t>(reverseBits(code, length));
+            literalLength[symbol] = static_cast<std::uint8_t>(length);
+        }
+        for (std::uint32_t symbol = 0; symbol < 30; ++symbol) {
+            distance[symbol] = static_cast<std::uint8_t>(reverseBits(symbol, 5));
+        }
+    }
+};
+
+const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : out_(out) {}
+
+    void put(std::uint32_t value, int count) {
+        bits_ |= static_cast<std::uint64_t>(value) << count_;
+        count_ += count;
+        while (count_ >= 8) {
+            out_.push_back(static_cast<char>(bits_ & 0xFF));
+            bits_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    void flush() {
+        if (count_ > 0) {
+            out_.push_back(static_cast<char>(bits_ & 0xFF));
+        }
+        bits_ = 0;
+        count_ = 0;
+    }
+
+private:
+    std::string& out_;
+    std::uint64_t bits_ = 0;
+    int count_ = 0;
+};
+
+class FixedBlockWriter {
+public:
+    explicit FixedBlockWriter(std::string& out) : bits_(out), codes_(fixedCodes()) {
+        bits_.put(1, 1);  // BFINAL
+        bits_.put(1, 2);  // BTYPE 01: fixed Huffman codes
+    }
+
+    void literal(unsigned char byte) { symbol(byte); }
+
+    void match(size_t length, size_t distance) {
+        size_t code = static_cast<size_t>(std::upper_bound(kLengthBase.begin(), kLengthBase.end(), length) -
+                                          kLengthBase.begin()) - 1;
+        symbol(static_cast<std::uint32_t>(257 + code));
+        bits_.put(static_cast<std::uint32_t>(length - kLengthBase[code]), kLengthExtra[code]);
+
+        code = static_cast<size_t>(std::upper_bound(kDistanceBase.begin(), kDistanceBase.end(), distance) -
+                                   kDistanceBase.begin()) - 1;
+        bits_.put(codes_.distance[code], 5);
+        bits_.put(static_cast<std::uint32_t>(distance - kDistanceBase[code]), kDistanceExtra[code]);
+    }
+
+    void finish() {
+        symbol(256);  // End of block
+        bits_.flush();
+    }
+
+private:
+    void symbol(std::uint32_t value) { bits_.put(codes_.literal[value], codes_.literalLength[value]); }
+
+    BitWriter bits_;
+    const FixedCodes& codes_;
+};
+
+std::uint32_t hashAt(const unsigned char* p) {
+    std::uint32_t key = (static_cast<std::uint32_t>(p[0]) << 16) | (static_cast<std::uint32_t>(p[1]) << 8) | p[2];
+    return (key * 2654435761u) >> (32 - kHashBits);
+}
+
+} // namespace
+
+std::string deflateRaw(std::string_view data) {
+    std::string out;
+    out.reserve(data.size() / 2 + 16);
+    FixedBlockWriter block(out);
+
+    // head: last position with each hash; prev: the position before it with
+    // the same hash, kept for one window (older ones are out of reach anyway)
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t size = data.size();
+    std::vector<std::int32_t> head(size_t(1) << kHashBits, -1);
+    std::vector<std::int32_t> prev(std::min(size, kWindowSize), -1);
+    auto insert = [&](size_t position) {
+        if (position + kMinMatch <= size) {
+            std::uint32_t hash = hashAt(bytes + position);
+            prev[position % kWindowSize] = head[hash];
+            head[hash] = static_cast<std::int32_t>(position);
+        }
+    };
+
+    size_t position = 0;
+    while (position < size) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (position + kMinMatch <= size) {
+            size_t limit = std::min(kMaxMatch, size - position);
+            std::int32_t candidate = head[hashAt(bytes + position)];
+            for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain) {
+                size_t distance = position - static_cast<size_t>(candidate);
+                if (distance > kWindowSize) {
+                    break;
+                }
+                const unsigned char* a = bytes + candidate;
+                const unsigned char* b = bytes + position;
+                if (a[bestLength] == b[bestLength]) {
+                    size_t length = 0;
+                    while (length < limit && a[length] == b[length]) {
+                        ++length;
+                    }
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if (length == limit) {
+                            break;
+                        }
+                    }
+                }
+                candidate = prev[static_cast<size_t>(candidate) % kWindowSize];
+            }
+        }
+
+        if (bestLength >= kMinMatch) {
+            block.match(bestLength, bestDistance);
+            for (size_t i = 0; i < bestLength; ++i) {
+                insert(position + i);
+            }
+            position += bestLength;
+        } else {
+            block.literal(bytes[position]);
+            insert(position);
+            ++position;
+        }
+    }
+    block.finish();
+    return out;
+}
+
+std::uint32_t crc32(std::string_view data) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace setlistgui
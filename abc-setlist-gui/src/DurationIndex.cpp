@@ -0,0 +1,64 @@
+#include "DurationIndex.h"
+
+namespace setlistgui {
+
+namespace {
+
+size_t lowbit(size_t i) {
+    return i & (~i + 1);
+}
+
+} // namespace
+
+void DurationIndex::assign(const std::vector<int>& values) {
+    values_ = values;
+    tree_.assign(values_.begin(), values_.end());
+    total_ = 0;
+
+    // Linear build: each node passes its sum up to its parent once
+    for (size_t i = 1; i <= tree_.size(); ++i) {
+        total_ += values_[i - 1];
+        size_t parent = i + lowbit(i);
+        if (parent <= tree_.size()) {
+            tree_[parent - 1] += tree_[i - 1];
+        }
+    }
+}
+
+void DurationIndex::push_back(int value) {
+    // The new node covers (i - lowbit(i), i]: its value plus the sum of the
+    // preceding values in that range
+    size_t i = values_.size() + 1;
+    long long node = value + prefixSum(i - 1) - prefixSum(i - lowbit(i));
+    values_.push_back(value);
+    tree_.push_back(node);
+    total_ += value;
+}
+
+void DurationIndex::set(size_t position, int value) {
+    long long delta = static_cast<long long>(value) - values_[position];
+    if (delta == 0) {
+        return;
+    }
+    values_[position] = value;
+    total_ += delta;
+    for (size_t i = position + 1; i <= tree_.size(); i += lowbit(i)) {
+        tree_[i - 1] += delta;
+    }
+}
+
+void DurationIndex::clear() {
+    values_.clear();
+    tree_.clear();
+    total_ = 0;
+}
+
+long long DurationIndex::prefixSum(size_t count) const {
+    long long sum = 0;
+    for (size_t i = count; i > 0; i -= lowbit(i)) {
+        sum += tree_[i - 1];
+    }
+    return sum;
+}
+
+} // namespace setlistgui
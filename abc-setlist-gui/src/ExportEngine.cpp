@@ -0,0 +1,726 @@
+#include "ExportEngine.h"
+#include "ContentHash.h"
+#include "Deflate.h"
+#include "FileIo.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The export folder as an absolute path, created if missing (createdTarget
+// is then set so a failed export can remove it again)
+fs::path prepareTarget(const std::string& folderPath, fs::path& createdTarget) {
+    fs::path target = fs::absolute(folderPath).lexically_normal();
+    if (target.filename().empty()) {
+        target = target.parent_path();  // Drop a trailing separator
+    }
+    if (!fs::exists(target)) {
+        fs::create_directories(target);
+        createdTarget = target;
+    }
+    return target;
+}
+
+// Create an empty staging directory next to the target so renames out of it
+// stay on one filesystem. Falls back to a hidden folder inside the target
+// when the target is a drive or share root.
+fs::path createStagingDirectory(const fs::path& target) {
+    std::random_device random;
+    fs::path name = target.filename();
+    fs::path parent = target.parent_path();
+    bool besideTarget = !name.empty() && !parent.empty() && parent != target;
+
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        std::string suffix = ".export-" + std::to_string(random());
+        fs::path staging = besideTarget ?
+                           parent / ("." + name.string() + suffix) :
+                           target / (".setlist" + suffix);
+        std::error_code ec;
+        if (fs::create_directory(staging, ec)) {
+            return staging;
+        }
+        if (ec && besideTarget) {
+            besideTarget = false;  // Parent not writable, stage inside the target
+        }
+    }
+    throw std::runtime_error("Cannot create staging folder for " + target.string());
+}
+
+void stageItem(const ExportItem& item, const fs::path& stagedPath, ExportFileResult& result) {
+    ProfileScope probe("exportFile");
+    auto start = Clock::now();
+    result.filename = item.filename;
+
+    if (item.render) {
+        std::string content;
+        result.success = item.render(content, result.error) &&
+                         writeFileDurable(stagedPath.string(), content, result.error);
+        if (result.success) {
+            result.bytesWritten = content.size();
+        }
+    } else {
+        result.success = copyFileFast(item.sourcePath, stagedPath.string(), result.bytesWritten, result.error);
+        if (result.success && item.verifySource) {
+            // Check the copy, not the source, so what gets published is
+            // exactly what was loaded
+            MappedFile staged;
+            result.success = staged.open(stagedPath.string(), result.error, MapMode::Map);
+            if (result.success && (staged.view().size() != item.sourceSize ||
+                                   contentHash(staged.view()) != item.sourceHash)) {
+                result.success = false;
+                result.error = item.sourcePath + " changed on disk since it was loaded";
+            }
+        }
+    }
+
+    result.elapsedMs = millisecondsSince(start);
+}
+
+// Render (or read and verify) an item's content into an archive entry,
+// deflated for zip unless that doesn't make it smaller
+void packItem(const ExportItem& item, ArchiveFormat format, ArchiveEntry& entry, ExportFileResult& result) {
+    ProfileScope probe("archiveFile");
+    auto start = Clock::now();
+    result.filename = item.filename;
+
+    std::string content;
+    if (item.render) {
+        result.success = item.render(content, result.error);
+    } else {
+        MappedFile source;
+        result.success = source.open(item.sourcePath, result.error);
+        if (result.success && item.verifySource &&
+            (source.view().size() != item.sourceSize || contentHash(source.view()) != item.sourceHash)) {
+            result.success = false;
+            result.error = item.sourcePath + " changed on disk since it was loaded";
+        }
+        if (result.success) {
+            content = source.takeContents();
+        }
+    }
+
+    if (result.success) {
+        entry.name = item.filename;
+        entry.size = content.size();
+        if (format == ArchiveFormat::Zip) {
+            entry.crc = crc32(content);
+            std::string packed = deflateRaw(content);
+            entry.deflated = packed.size() < content.size();
+            entry.data = entry.deflated ? std::move(packed) : std::move(content);
+        } else {
+            entry.data = std::move(content);
+        }
+    }
+    result.elapsedMs = millisecondsSince(start);
+}
+
+// Every item needs a name of its own: a second file with the same name
+// (ignoring ASCII case, as Windows and macOS do) would replace the first in
+// the folder or archive and lose a song. Fills report.error for the first
+// name used twice.
+bool checkUniqueNames(const std::vector<ExportItem>& items, ExportReport& report) {
+    std::unordered_map<std::string, size_t> seen;
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::string key = items[i].filename;
+        for (char& c : key) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        auto [first, added] = seen.emplace(std::move(key), i);
+        if (!added) {
+            report.error = "Two songs would be exported as " + items[i].filename + " (" +
+                           std::to_string(first->second + 1) + " and " + std::to_string(i + 1) +
+                           "); turn numbering on or rename one";
+            for (size_t k : {first->second, i}) {
+                report.files[k].filename = items[k].filename;
+                report.files[k].error = "Name used by another song";
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// One file recorded in the sync manifest
+struct SyncEntry {
+    std::string name;
+    FileStamp stamp;
+    std::uint64_t hash = 0;
+};
+
+// A bare file name; anything else in a manifest is ignored so a damaged or
+// hand-edited manifest can't make sync touch files outside the folder
+bool isPlainName(const std::string& name) {
+    fs::path path(name);
+    return !name.empty() && name != "." && name != ".." && path.filename() == path;
+}
+
+// Manifest lines are "size<TAB>mtime<TAB>hash<TAB>name", one per slot in
+// setlist order; a missing or unreadable manifest reads as empty
+std::vector<SyncEntry> parseSyncManifest(const std::string& text) {
+    std::vector<SyncEntry> entries;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t first = line.find('\t');
+        size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+        size_t third = second == std::string::npos ? second : line.find('\t', second + 1);
+        if (third == std::string::npos) {
+            continue;
+        }
+        SyncEntry entry;
+        entry.stamp.size = std::strtoull(line.c_str(), nullptr, 10);
+        entry.stamp.modifiedTime = std::strtoll(line.c_str() + first + 1, nullptr, 10);
+        entry.hash = std::strtoull(line.c_str() + second + 1, nullptr, 16);
+        entry.name = line.substr(third + 1);
+        if (isPlainName(entry.name)) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    return entries;
+}
+
+std::string formatSyncManifest(const std::vector<SyncEntry>& entries) {
+    std::string text = "# setlist sync manifest: size, mtime, hash, name\n";
+    char hash[17];
+    for (const auto& entry : entries) {
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(entry.hash));
+        text += std::to_string(entry.stamp.size) + '\t' + std::to_string(entry.stamp.modifiedTime) + '\t' + hash +
+                '\t' + entry.name + '\n';
+    }
+    return text;
+}
+
+} // namespace
+
+ExportReport ExportEngine::run(const std::string& folderPath, const std::vector<ExportItem>& items) {
+    auto start = Clock::now();
+    ExportReport report;
+    report.files.resize(items.size());
+
+    if (!checkUniqueNames(items, report)) {
+        report.elapsedMs = millisecondsSince(start);
+        return report;
+    }
+
+    fs::path staging;
+    fs::path createdTarget;  // Removed again if the export fails
+    try {
+        fs::path target = prepareTarget(folderPath, createdTarget);
+        staging = createStagingDirectory(target);
+
+        auto stagedPath = [&](size_t i) {
+            return staging / (std::to_string(i) + ".part");
+        };
+
+        parallelFor(items.size(), [&](size_t i) {
+            try {
+                stageItem(items[i], stagedPath(i), report.files[i]);
+            } catch (const std::exception& e) {
+                report.files[i].success = false;
+                report.files[i].error = e.what();
+            }
+        });
+
+        for (const auto& file : report.files) {
+            if (!file.success) {
+                report.error = file.filename + ": " + file.error;
+                break;
+            }
+        }
+
+        if (report.error.empty()) {
+            // Everything is on disk; publish each file with an atomic rename
+            ProfileScope publishProbe("exportPublish");
+            for (size_t i = 0; i < items.size(); ++i) {
+                std::error_code ec;
+                fs::rename(stagedPath(i), target / items[i].filename, ec);
+                if (ec) {
+                    report.files[i].success = false;
+                    report.files[i].error = ec.message();
+                    if (report.error.empty()) {
+                        report.error = items[i].filename + ": " + ec.message();
+                    }
+                    continue;
+                }
+                report.totalBytes += report.files[i].bytesWritten;
+                ++report.written;
+            }
+            syncDirectory(target.string());
+        } else {
+            for (auto& file : report.files) {
+                if (file.success) {
+                    file.success = false;
+                    file.error = "Not published (export aborted)";
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        report.error = e.what();
+    }
+
+    if (!staging.empty()) {
+        std::error_code ec;
+        fs::remove_all(staging, ec);
+    }
+
+    report.success = report.error.empty();
+    if (!report.success && !createdTarget.empty()) {
+        std::error_code ec;
+        fs::remove(createdTarget, ec);  // Only succeeds while still empty
+    }
+    report.elapsedMs = millisecondsSince(start);
+    return report;
+}
+
+ExportReport ExportEngine::sync(const std::string& folderPath, const std::vector<ExportItem>& items) {
+    auto start = Clock::now();
+    ExportReport report;
+    report.files.resize(items.size());
+
+    if (!checkUniqueNames(items, report)) {
+        report.elapsedMs = millisecondsSince(start);
+        return report;
+    }
+
+    fs::path staging;
+    fs::path createdTarget;  // Removed again if the export fails
+    try {
+        fs::path target = prepareTarget(folderPath, createdTarget);
+        fs::path manifestPath = target / kSyncManifestName;
+
+        std::unordered_set<std::string> wanted;
+        for (size_t i = 0; i < items.size(); ++i) {
+            report.files[i].filename = items[i].filename;
+            wanted.insert(items[i].filename);
+        }
+
+        // What the folder holds: the files the last sync listed (hashed again
+        // only if their size or mtime changed since) and any unlisted files
+        // already at wanted names
+        std::string previousManifest;
+        {
+            std::ifstream in(manifestPath, std::ios::binary);
+            std::ostringstream text;
+            text << in.rdbuf();
+            previousManifest = text.str();
+        }
+        std::vector<SyncEntry> listed = parseSyncManifest(previousManifest);
+        std::vector<std::string> names;
+        std::unordered_set<std::string> listedNames;
+        for (const auto& entry : listed) {
+            if (listedNames.insert(entry.name).second) {
+                names.push_back(entry.name);
+            }
+        }
+        size_t listedCount = names.size();
+        for (const auto& item : items) {
+            if (!listedNames.count(item.filename)) {
+                names.push_back(item.filename);
+            }
+        }
+        std::unordered_map<std::string, const SyncEntry*> lastListed;
+        for (const auto& entry : listed) {
+            lastListed[entry.name] = &entry;
+        }
+
+        std::vector<SyncEntry> present(names.size());
+        std::vector<char> exists(names.size(), 0);
+        parallelFor(names.size(), [&](size_t i) {
+            SyncEntry& entry = present[i];
+            entry.name = names[i];
+            std::string path = (target / entry.name).string();
+            if (!statFileStamp(path, entry.stamp)) {
+                return;  // Gone (or never there)
+            }
+            if (i < listedCount) {
+                const SyncEntry& recorded = *lastListed.at(entry.name);
+                if (recorded.stamp == entry.stamp) {
+                    entry.hash = recorded.hash;
+                    exists[i] = 1;
+                    return;
+                }
+            }
+            MappedFile file;
+            std::string error;
+            if (file.open(path, error)) {
+                entry.stamp = file.stamp();
+                entry.hash = contentHash(file.view());
+                exists[i] = 1;
+            }
+        });
+
+        // Size and hash of each wanted file; items that don't know theirs
+        // are rendered (and the content kept for writing) or their source hashed
+        std::vector<std::string> rendered(items.size());
+        std::vector<char> isRendered(items.size(), 0);
+        std::vector<std::uint64_t> outputSize(items.size(), 0);
+        std::vector<std::uint64_t> outputHash(items.size(), 0);
+        parallelFor(items.size(), [&](size_t i) {
+            const ExportItem& item = items[i];
+            ExportFileResult& result = report.files[i];
+            result.success = true;
+            if (item.outputKnown) {
+                outputSize[i] = item.outputSize;
+                outputHash[i] = item.outputHash;
+                return;
+            }
+            try {
+                if (item.render) {
+                    result.success = item.render(rendered[i], result.error);
+                    isRendered[i] = 1;
+                    outputSize[i] = rendered[i].size();
+                    outputHash[i] = contentHash(rendered[i]);
+                } else {
+                    MappedFile source;
+                    result.success = source.open(item.sourcePath, result.error);
+                    outputSize[i] = source.view().size();
+                    outputHash[i] = contentHash(source.view());
+                }
+            } catch (const std::exception& e) {
+                result.success = false;
+                result.error = e.what();
+            }
+        });
+
+        // Keep files already in place, then rename files whose content is
+        // wanted under another name; everything else is written
+        constexpr size_t kNone = static_cast<size_t>(-1);
+        std::unordered_map<std::string, size_t> presentByName;
+        for (size_t p = 0; p < present.size(); ++p) {
+            if (exists[p]) {
+                presentByName.emplace(present[p].name, p);
+            }
+        }
+        std::vector<char> claimed(present.size(), 0);
+        std::vector<size_t> renameFrom(items.size(), kNone);
+        std::vector<char> toWrite(items.size(), 0);
+        for (size_t i = 0; i < items.size(); ++i) {
+            report.files[i].action = ExportAction::Kept;
+            auto existing = presentByName.find(items[i].filename);
+            if (existing != presentByName.end() && present[existing->second].stamp.size == outputSize[i] &&
+                present[existing->second].hash == outputHash[i]) {
+                claimed[existing->second] = 1;
+            } else {
+                toWrite[i] = 1;
+            }
+        }
+        std::unordered_multimap<std::uint64_t, size_t> movable;
+        for (size_t p = 0; p < present.size(); ++p) {
+            if (exists[p] && !claimed[p]) {
+                movable.emplace(present[p].hash, p);
+            }
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (!toWrite[i]) {
+                continue;
+            }
+            auto range = movable.equal_range(outputHash[i]);
+            for (auto candidate = range.first; candidate != range.second; ++candidate) {
+                if (present[candidate->second].stamp.size == outputSize[i]) {
+                    renameFrom[i] = candidate->second;
+                    claimed[candidate->second] = 1;
+                    movable.erase(candidate);
+                    toWrite[i] = 0;
+                    report.files[i].action = ExportAction::Renamed;
+                    report.files[i].renamedFrom = present[renameFrom[i]].name;
+                    break;
+                }
+            }
+            if (toWrite[i]) {
+                report.files[i].action = ExportAction::Written;
+            }
+        }
+
+        // Orphans: files the last sync wrote that nothing wants any more
+        std::vector<size_t> orphans;
+        for (size_t p = 0; p < listedCount; ++p) {
+            if (exists[p] && !claimed[p] && !wanted.count(present[p].name)) {
+                orphans.push_back(p);
+            }
+        }
+
+        bool changes = !orphans.empty();
+        for (size_t i = 0; i < items.size(); ++i) {
+            changes = changes || toWrite[i] || renameFrom[i] != kNone;
+        }
+        auto stagedPath = [&](size_t i) {
+            return staging / (std::to_string(i) + ".part");
+        };
+        if (changes) {
+            staging = createStagingDirectory(target);
+        }
+
+        // Produce changed files in staging, as run() does
+        parallelFor(items.size(), [&](size_t i) {
+            ExportFileResult& result = report.files[i];
+            if (!toWrite[i] || !result.success) {
+                return;
+            }
+            try {
+                if (isRendered[i]) {
+                    auto fileStart = Clock::now();
+                    result.success = writeFileDurable(stagedPath(i).string(), rendered[i], result.error);
+                    result.bytesWritten = result.success ? rendered[i].size() : 0;
+                    result.elapsedMs = millisecondsSince(fileStart);
+                } else {
+                    stageItem(items[i], stagedPath(i), result);
+                }
+            } catch (const std::exception& e) {
+                result.success = false;
+                result.error = e.what();
+            }
+        });
+
+        for (const auto& file : report.files) {
+            if (!file.success) {
+                report.error = file.filename + ": " + file.error;
+                break;
+            }
+        }
+
+        // From here on the folder changes, so the manifest is rewritten
+        // even if something fails; before this point nothing was touched
+        bool publishing = report.error.empty();
+        std::vector<size_t> stuck;  // Rename sources that could not be moved
+        if (publishing && changes) {
+            ProfileScope publishProbe("exportPublish");
+
+            // Move rename sources aside first, so a swap or chain of names
+            // can't overwrite a file before it has been moved
+            auto fail = [&](size_t i, const std::error_code& ec) {
+                report.files[i].success = false;
+                report.files[i].error = ec.message();
+                if (report.error.empty()) {
+                    report.error = items[i].filename + ": " + ec.message();
+                }
+            };
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (renameFrom[i] != kNone) {
+                    std::error_code ec;
+                    fs::rename(target / present[renameFrom[i]].name, stagedPath(i), ec);
+                    if (ec) {
+                        fail(i, ec);
+                        stuck.push_back(renameFrom[i]);
+                    }
+                }
+            }
+            for (size_t i = 0; i < items.size(); ++i) {
+                if ((!toWrite[i] && renameFrom[i] == kNone) || !report.files[i].success) {
+                    continue;
+                }
+                std::error_code ec;
+                fs::rename(stagedPath(i), target / items[i].filename, ec);
+                if (ec) {
+                    fail(i, ec);
+                }
+            }
+            for (size_t p : orphans) {
+                std::error_code ec;
+                if (fs::remove(target / present[p].name, ec)) {
+                    ++report.removed;
+                    exists[p] = 0;
+                }
+            }
+            syncDirectory(target.string());
+        } else if (!report.error.empty()) {
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (report.files[i].success && (toWrite[i] || renameFrom[i] != kNone)) {
+                    report.files[i].success = false;
+                    report.files[i].error = "Not published (export aborted)";
+                }
+            }
+        }
+
+        for (size_t i = 0; i < items.size(); ++i) {
+            const ExportFileResult& file = report.files[i];
+            if (!file.success) {
+                continue;
+            }
+            switch (file.action) {
+            case ExportAction::Written: ++report.written; break;
+            case ExportAction::Renamed: ++report.renamed; break;
+            case ExportAction::Kept: ++report.kept; break;
+            }
+            report.totalBytes += file.bytesWritten;
+        }
+
+        // Record what is in place now: every wanted file that is there, in
+        // setlist order, and any orphan or rename source left behind (so the
+        // next sync deals with it)
+        std::vector<SyncEntry> entries;
+        if (publishing) {
+            for (size_t i = 0; i < items.size(); ++i) {
+                SyncEntry entry;
+                entry.name = items[i].filename;
+                entry.hash = outputHash[i];
+                if (report.files[i].success && statFileStamp((target / entry.name).string(), entry.stamp)) {
+                    entries.push_back(std::move(entry));
+                }
+            }
+            for (size_t p : orphans) {
+                if (exists[p]) {
+                    entries.push_back(present[p]);
+                }
+            }
+            for (size_t p : stuck) {
+                if (!wanted.count(present[p].name)) {
+                    entries.push_back(present[p]);
+                }
+            }
+            std::string manifest = formatSyncManifest(entries);
+            if (manifest != previousManifest) {
+                std::string error;
+                std::string partPath = uniqueTempPath(manifestPath.string());
+                std::error_code ec;
+                if (writeFileDurable(partPath, manifest, error)) {
+                    fs::rename(partPath, manifestPath, ec);
+                }
+                if (!error.empty() || ec) {
+                    if (report.error.empty()) {
+                        report.error = std::string(kSyncManifestName) + ": " + (error.empty() ? ec.message() : error);
+                    }
+                    fs::remove(partPath, ec);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        report.error = e.what();
+    }
+
+    if (!staging.empty()) {
+        std::error_code ec;
+        fs::remove_all(staging, ec);
+    }
+
+    report.success = report.error.empty();
+    if (!report.success && !createdTarget.empty()) {
+        std::error_code ec;
+        fs::remove(createdTarget, ec);  // Only succeeds while still empty
+    }
+    report.elapsedMs = millisecondsSince(start);
+    return report;
+}
+
+ExportReport ExportEngine::archive(const std::string& archivePath, ArchiveFormat format,
+                                   const std::vector<ExportItem>& items) {
+    auto start = Clock::now();
+    ExportReport report;
+    report.files.resize(items.size());
+    if (!checkUniqueNames(items, report)) {
+        report.elapsedMs = millisecondsSince(start);
+        return report;
+    }
+
+    // Written under a temporary name beside the archive and renamed over
+    // it once complete, so a failed export keeps the previous archive
+    std::string partPath = uniqueTempPath(archivePath);
+    std::ofstream out(partPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        report.error = "Cannot create " + archivePath;
+        report.elapsedMs = millisecondsSince(start);
+        return report;
+    }
+
+    // A few entries per worker are in memory at a time: produced in
+    // parallel, then written in order (which keeps the archive the same
+    // whatever the thread count)
+    ArchiveWriter writer(out, format);
+    size_t window = 4 * workerCount(items.size());
+    std::vector<ArchiveEntry> entries;
+    for (size_t first = 0; first < items.size() && report.error.empty(); first += window) {
+        size_t count = std::min(window, items.size() - first);
+        entries.assign(count, ArchiveEntry());
+        parallelFor(count, [&](size_t k) {
+            size_t i = first + k;
+            try {
+                packItem(items[i], format, entries[k], report.files[i]);
+            } catch (const std::exception& e) {
+                report.files[i].success = false;
+                report.files[i].error = e.what();
+            }
+        });
+
+        ProfileScope writeProbe("archiveWrite");
+        for (size_t k = 0; k < count; ++k) {
+            size_t i = first + k;
+            ExportFileResult& result = report.files[i];
+            if (!result.success) {
+                report.error = result.filename + ": " + result.error;
+                break;
+            }
+            if (!writer.add(entries[k], result.error)) {
+                result.success = false;
+                report.error = result.filename + ": " + result.error;
+                break;
+            }
+            result.bytesWritten = entries[k].data.size();
+            ++report.written;
+        }
+    }
+
+    std::string error;
+    if (report.error.empty() && !writer.finish(error)) {
+        report.error = error;
+    }
+    out.close();
+    if (report.error.empty() && out.fail()) {
+        report.error = "Cannot write " + archivePath;
+    }
+    if (report.error.empty()) {
+        std::error_code ec;
+        fs::rename(partPath, archivePath, ec);
+        if (ec) {
+            report.error = "Cannot replace " + archivePath + ": " + ec.message();
+        } else {
+            fs::path parent = fs::absolute(archivePath, ec).parent_path();
+            syncDirectory(parent.string());
+        }
+    }
+
+    report.success = report.error.empty();
+    if (report.success) {
+        report.totalBytes = writer.size();
+    } else {
+        report.written = 0;
+        for (auto& file : report.files) {
+            if (file.success) {
+                file.success = false;
+                file.error = "Not published (export aborted)";
+            }
+        }
+        std::error_code ec;
+        fs::remove(partPath, ec);
+    }
+    report.elapsedMs = millisecondsSince(start);
+    return report;
+}
+
+} // namespace setlistgui
@@ -0,0 +1,256 @@
+#include "FileIo.h"
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace setlistgui {
+
+#ifdef _WIN32
+
+bool writeFileDurable(const std::string& path, std::string_view data, std::string& error) {
+    std::ofstream outFile(path, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open()) {
+        error = "Cannot create " + path;
+        return false;
+    }
+    outFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    outFile.flush();
+    if (!outFile) {
+        error = "Write failed for " + path;
+        return false;
+    }
+    return true;
+}
+
+bool copyFileFast(const std::string& src, const std::string& dst, std::uintmax_t& bytesCopied, std::string& error) {
+    std::error_code ec;
+    std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
+    bytesCopied = std::filesystem::file_size(dst, ec);
+    return true;
+}
+
+void syncDirectory(const std::string&) {
+}
+
+bool statFileStamp(const std::string& path, FileStamp& stamp) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(std::filesystem::path(path).c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    stamp.size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    stamp.modifiedTime = static_cast<std::int64_t>((static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                                                   data.ftLastWriteTime.dwLowDateTime);
+    return true;
+}
+
+#else
+
+namespace {
+
+std::string errnoMessage(const std::string& what) {
+    return what + ": " + std::error_code(errno, std::generic_category()).message();
+}
+
+// Closes the descriptor on every return path
+struct FileDescriptor {
+    int fd;
+    explicit FileDescriptor(int value) : fd(value) {}
+    ~FileDescriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+};
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool bufferedCopy(int in, int out, std::uintmax_t& bytesCopied) {
+    char buffer[64 * 1024];
+    for (;;) {
+        ssize_t count = ::read(in, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        if (!writeAll(out, buffer, static_cast<size_t>(count))) {
+            return false;
+        }
+        bytesCopied += static_cast<std::uintmax_t>(count);
+    }
+}
+
+#ifdef __linux__
+// Returns false (with nothing written) when the kernel can't do the copy,
+// so the caller can fall back to a buffered copy
+bool kernelCopy(int in, int out, off_t size, std::uintmax_t& bytesCopied, bool& failed) {
+    failed = false;
+
+#ifdef FICLONE
+    // Reflink: shares extents on btrfs/XFS, no data is copied at all
+    if (::ioctl(out, FICLONE, in) == 0) {
+        bytesCopied = static_cast<std::uintmax_t>(size);
+        return true;
+    }
+#endif
+
+    off_t remaining = size;
+    while (remaining > 0) {
+        ssize_t copied = ::copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(remaining), 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Nothing copied yet: cross-device or unsupported filesystem
+            if (bytesCopied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                                     errno == EOPNOTSUPP || errno == EBADF)) {
+                return false;
+            }
+            failed = true;
+            return false;
+        }
+        if (copied == 0) {
+            break;  // Source shrank while copying
+        }
+        bytesCopied += static_cast<std::uintmax_t>(copied);
+        remaining -= copied;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+bool writeFileDurable(const std::string& path, std::string_view data, std::string& error) {
+    FileDescriptor out(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (out.fd < 0) {
+        error = errnoMessage("Cannot create " + path);
+        return false;
+    }
+    if (!writeAll(out.fd, data.data(), data.size())) {
+        error = errnoMessage("Write failed for " + path);
+        return false;
+    }
+    if (::fsync(out.fd) != 0) {
+        error = errnoMessage("Flush failed for " + path);
+        return false;
+    }
+    return true;
+}
+
+bool copyFileFast(const std::string& src, const std::string& dst, std::uintmax_t& bytesCopied, std::string& error) {
+    bytesCopied = 0;
+
+    FileDescriptor in(::open(src.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.fd < 0) {
+        error = errnoMessage("Cannot open " + src);
+        return false;
+    }
+    struct stat info;
+    if (::fstat(in.fd, &info) != 0) {
+        error = errnoMessage("Cannot stat " + src);
+        return false;
+    }
+
+    FileDescriptor out(::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (out.fd < 0) {
+        error = errnoMessage("Cannot create " + dst);
+        return false;
+    }
+
+    bool copied = false;
+#ifdef __linux__
+    bool failed = false;
+    copied = kernelCopy(in.fd, out.fd, info.st_size, bytesCopied, failed);
+    if (failed) {
+        error = errnoMessage("Copy failed for " + src);
+        return false;
+    }
+#endif
+    if (!copied && !bufferedCopy(in.fd, out.fd, bytesCopied)) {
+        error = errnoMessage("Copy failed for " + src);
+        return false;
+    }
+
+    if (::fsync(out.fd) != 0) {
+        error = errnoMessage("Flush failed for " + dst);
+        return false;
+    }
+    return true;
+}
+
+bool statFileStamp(const std::string& path, FileStamp& stamp) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    stamp.size = static_cast<std::uint64_t>(info.st_size);
+#ifdef __APPLE__
+    stamp.modifiedTime = static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    stamp.modifiedTime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+void syncDirectory(const std::string& path) {
+    FileDescriptor dir(::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (dir.fd >= 0) {
+        ::fsync(dir.fd);
+    }
+}
+
+#endif
+
+std::string uniqueTempPath(const std::string& path) {
+    // Random per process, counted within it
+    static const std::uint64_t processKey = (static_cast<std::uint64_t>(std::random_device()()) << 32) |
+                                            std::random_device()();
+    static std::atomic<std::uint64_t> counter{0};
+    return path + "." + std::to_string(processKey) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+} // namespace setlistgui
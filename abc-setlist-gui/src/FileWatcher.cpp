@@ -0,0 +1,252 @@
+#include "FileWatcher.h"
+#include <cstdint>
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+constexpr auto kWakeInterval = std::chrono::milliseconds(100);
+
+#ifdef __linux__
+// Saves show up as a write+close, or as a rename/create over the file; the
+// folder itself going away ends its watch
+constexpr std::uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE |
+                                     IN_DELETE | IN_MOVED_FROM | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+} // namespace
+
+FileWatcher::FileWatcher(std::chrono::milliseconds settleTime, std::chrono::milliseconds pollInterval)
+    : settleTime_(settleTime), pollInterval_(pollInterval) {
+#ifdef __linux__
+    notifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    thread_ = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#ifdef __linux__
+    if (notifyFd_ >= 0) {
+        close(notifyFd_);
+    }
+#endif
+}
+
+void FileWatcher::setPaths(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_set<std::string> wanted(paths.begin(), paths.end());
+
+    // Forget files that are no longer in the set
+    for (auto it = paths_.begin(); it != paths_.end();) {
+        if (wanted.count(*it)) {
+            ++it;
+            continue;
+        }
+        stamps_.erase(*it);
+        pending_.erase(*it);
+        polled_.erase(*it);
+#ifdef __linux__
+        fs::path path(*it);
+        auto watch = folderWatches_.find(path.parent_path().string());
+        if (watch != folderWatches_.end()) {
+            WatchedFolder& folder = folders_[watch->second];
+            folder.files.erase(path.filename().string());
+            if (folder.files.empty()) {
+                inotify_rm_watch(notifyFd_, watch->second);
+                folders_.erase(watch->second);
+                folderWatches_.erase(watch);
+            }
+        }
+#endif
+        it = paths_.erase(it);
+    }
+
+    for (const auto& path : wanted) {
+        if (!paths_.insert(path).second) {
+            continue;
+        }
+#ifdef __linux__
+        if (notifyFd_ >= 0) {
+            fs::path file(path);
+            std::string folder = file.parent_path().string();
+            auto watch = folderWatches_.find(folder);
+            if (watch == folderWatches_.end()) {
+                int wd = inotify_add_watch(notifyFd_, folder.c_str(), kWatchMask);
+                if (wd < 0) {
+                    polled_.insert(path);  // Folder gone, not watchable or past the watch limit
+                    continue;
+                }
+                watch = folderWatches_.emplace(folder, wd).first;
+                folders_[wd].folder = folder;
+            }
+            folders_[watch->second].files[file.filename().string()] = path;
+        }
+#endif
+    }
+}
+
+std::vector<std::string> FileWatcher::takeChanged() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> changed;
+    changed.swap(changed_);
+    return changed;
+}
+
+void FileWatcher::setOnChange(std::function<void()> onChange) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    onChange_ = std::move(onChange);
+}
+
+void FileWatcher::markChanged(const std::string& path, Clock::time_point now) {
+    pending_[path] = now;  // Each new event restarts the settle timer
+}
+
+void FileWatcher::run() {
+    auto nextPoll = Clock::now();
+    while (!stop_) {
+        if (notifyFd_ >= 0) {
+            readNotifications();
+        } else {
+            std::this_thread::sleep_for(kWakeInterval);
+        }
+        if (Clock::now() >= nextPoll) {
+            pollStamps();
+            nextPoll = Clock::now() + pollInterval_;
+        }
+
+        // Report files that have been quiet long enough
+        std::function<void()> onChange;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = Clock::now();
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                if (now - it->second >= settleTime_) {
+                    changed_.push_back(it->first);
+                    it = pending_.erase(it);
+                    onChange = onChange_;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (onChange) {
+            onChange();
+        }
+    }
+}
+
+void FileWatcher::readNotifications() {
+#ifdef __linux__
+    pollfd descriptor{notifyFd_, POLLIN, 0};
+    if (poll(&descriptor, 1, static_cast<int>(kWakeInterval.count())) <= 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = read(notifyFd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost: treat every file as possibly changed
+                for (const auto& path : paths_) {
+                    markChanged(path, now);
+                }
+                continue;
+            }
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // The watch is dead (or would follow the folder elsewhere)
+                if (folders_.count(event->wd)) {
+                    dropFolderWatch(event->wd, !(event->mask & IN_IGNORED), now);
+                }
+                continue;
+            }
+            auto folder = folders_.find(event->wd);
+            if (folder == folders_.end() || event->len == 0) {
+                continue;
+            }
+            auto file = folder->second.files.find(event->name);
+            if (file != folder->second.files.end()) {
+                markChanged(file->second, now);
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::dropFolderWatch(int wd, bool removeWatch, Clock::time_point now) {
+#ifdef __linux__
+    // Poll the folder's files from now on; they may have changed with it.
+    // Files added to the folder later get a fresh watch if it exists again.
+    auto folder = folders_.find(wd);
+    for (const auto& file : folder->second.files) {
+        polled_.insert(file.second);
+        markChanged(file.second, now);
+    }
+    folderWatches_.erase(folder->second.folder);
+    folders_.erase(folder);
+    if (removeWatch) {
+        inotify_rm_watch(notifyFd_, wd);
+    }
+#else
+    (void)wd;
+    (void)removeWatch;
+    (void)now;
+#endif
+}
+
+void FileWatcher::pollStamps() {
+    std::vector<std::string> paths;
+    {
+        // Everything without inotify, else only files it can't cover
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto& polled = notifyFd_ >= 0 ? polled_ : paths_;
+        paths.assign(polled.begin(), polled.end());
+    }
+
+    // Stat outside the lock; a missing file gets an empty stamp
+    std::vector<FileStamp> stamps(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!statFileStamp(paths[i], stamps[i])) {
+            stamps[i] = FileStamp();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!paths_.count(paths[i])) {
+            continue;  // Removed meanwhile
+        }
+        auto known = stamps_.find(paths[i]);
+        if (known == stamps_.end()) {
+            stamps_.emplace(paths[i], stamps[i]);  // First sighting is the baseline
+        } else if (known->second != stamps[i]) {
+            known->second = stamps[i];
+            markChanged(paths[i], now);
+        }
+    }
+}
+
+} // namespace setlistgui
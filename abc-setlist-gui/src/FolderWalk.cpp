@@ -0,0 +1,146 @@
+#include "FolderWalk.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+// Folders are walked a handful at a time even on small machines: the walk
+// waits on the disk far more than on the CPU
+constexpr size_t kMinWalkers = 4;
+constexpr size_t kMaxWalkers = 16;
+
+// A folder waiting to be listed, and the chain of folders that led to it
+// (by real path) so a symlink back into the chain can be recognised
+struct PendingFolder {
+    size_t root = 0;
+    fs::path path;
+    std::shared_ptr<const fs::path> realPath;
+    std::shared_ptr<const PendingFolder> parent;
+};
+
+bool isOnChain(const PendingFolder* folder, const fs::path& realPath) {
+    for (; folder; folder = folder->parent.get()) {
+        if (*folder->realPath == realPath) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool hasAbcExtension(const std::string& path) {
+    if (path.size() < 4) {
+        return false;
+    }
+    const char* extension = path.c_str() + path.size() - 4;
+    return extension[0] == '.' &&
+           (extension[1] == 'a' || extension[1] == 'A') &&
+           (extension[2] == 'b' || extension[2] == 'B') &&
+           (extension[3] == 'c' || extension[3] == 'C');
+}
+
+void walkAbcFiles(const std::vector<std::string>& roots, const FolderWalkCallback& onFile,
+                  const std::atomic<bool>& cancel) {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<const PendingFolder>> queue;
+    size_t busy = 0;  // Walkers listing a folder (and so maybe queueing more)
+
+    for (size_t root = 0; root < roots.size(); ++root) {
+        std::error_code ec;
+        fs::path realPath = fs::canonical(roots[root], ec);
+        if (ec) {
+            continue;
+        }
+        auto folder = std::make_shared<PendingFolder>();
+        folder->root = root;
+        folder->path = roots[root];
+        folder->realPath = std::make_shared<const fs::path>(std::move(realPath));
+        queue.push_back(std::move(folder));
+    }
+
+    auto listFolder = [&](const std::shared_ptr<const PendingFolder>& folder) {
+        std::vector<std::shared_ptr<const PendingFolder>> subfolders;
+        std::error_code ec;
+        fs::directory_iterator it(folder->path, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::directory_iterator() && !cancel; it.increment(ec)) {
+            const fs::directory_entry& entry = *it;
+            std::error_code typeError;
+            bool isLink = entry.is_symlink(typeError);
+            if (entry.is_directory(typeError)) {
+                // A plain folder's real path follows from its parent's; only
+                // links need resolving
+                std::shared_ptr<const fs::path> realPath;
+                if (isLink) {
+                    std::error_code linkError;
+                    fs::path target = fs::canonical(entry.path(), linkError);
+                    if (linkError || isOnChain(folder.get(), target)) {
+                        continue;  // Dangling, or a loop
+                    }
+                    realPath = std::make_shared<const fs::path>(std::move(target));
+                } else {
+                    realPath = std::make_shared<const fs::path>(*folder->realPath / entry.path().filename());
+                }
+                auto subfolder = std::make_shared<PendingFolder>();
+                subfolder->root = folder->root;
+                subfolder->path = entry.path();
+                subfolder->realPath = std::move(realPath);
+                subfolder->parent = folder;
+                subfolders.push_back(std::move(subfolder));
+            } else if (entry.is_regular_file(typeError)) {
+                std::string path = entry.path().string();
+                if (hasAbcExtension(path)) {
+                    onFile(folder->root, path);
+                }
+            }
+        }
+        return subfolders;
+    };
+
+    auto walker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return !queue.empty() || busy == 0 || cancel; });
+            if (queue.empty() || cancel) {
+                break;  // Nothing left and nobody can queue more (or cancelled)
+            }
+            auto folder = std::move(queue.front());
+            queue.pop_front();
+            ++busy;
+            lock.unlock();
+
+            auto subfolders = listFolder(folder);
+
+            lock.lock();
+            --busy;
+            for (auto& subfolder : subfolders) {
+                queue.push_back(std::move(subfolder));
+            }
+            wake.notify_all();
+        }
+        wake.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+    size_t walkers = std::max(kMinWalkers, workerCount(kMaxWalkers));
+    for (size_t t = 1; t < walkers; ++t) {
+        threads.emplace_back(walker);
+    }
+    walker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace setlistgui
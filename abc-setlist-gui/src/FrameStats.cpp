@@ -0,0 +1,69 @@
+#include "FrameStats.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace setlistgui {
+
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto toSeconds = [](const FILETIME& time) {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) / 1e7;  // 100 ns units
+    };
+    return toSeconds(kernel) + toSeconds(user);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    auto toSeconds = [](const timeval& time) {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+    };
+    return toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+#endif
+}
+
+void FrameStats::update(double now, bool rendered) {
+    // Advance the ring, clearing the seconds that passed without a frame
+    auto second = static_cast<long long>(now);
+    if (currentSecond_ < 0) {
+        currentSecond_ = second;
+    }
+    for (long long s = currentSecond_ + 1; s <= second && s <= currentSecond_ + 60; ++s) {
+        size_t& bucket = buckets_[static_cast<size_t>(s % 60)];
+        framesPerMinute_ -= bucket;
+        bucket = 0;
+    }
+    currentSecond_ = second;
+
+    if (rendered) {
+        ++buckets_[static_cast<size_t>(second % 60)];
+        ++framesPerMinute_;
+    }
+
+    // CPU usage, sampled once a second
+    if (sampleTime_ < 0.0) {
+        sampleTime_ = now;
+        sampleCpu_ = processCpuSeconds();
+    } else if (now - sampleTime_ >= 1.0) {
+        double cpu = processCpuSeconds();
+        cpuPercent_ = 100.0 * (cpu - sampleCpu_) / (now - sampleTime_);
+        sampleTime_ = now;
+        sampleCpu_ = cpu;
+    }
+}
+
+} // namespace setlistgui
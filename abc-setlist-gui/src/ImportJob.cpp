@@ -0,0 +1,212 @@
+#include "ImportJob.h"
+#include "FolderWalk.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+
+namespace setlistgui {
+
+bool DuplicateCheck::isKnownFile(const std::string& path, const FileStamp& stamp, std::uint64_t& hash) const {
+    if (!job_ || !job_->known_) {
+        return false;
+    }
+    auto it = job_->known_->files.find(path);
+    if (it == job_->known_->files.end() || it->second.first != stamp) {
+        return false;
+    }
+    hash = it->second.second;
+    return true;
+}
+
+bool DuplicateCheck::claim(std::uint64_t hash) {
+    if (!job_ || !job_->known_) {
+        return true;
+    }
+    if (job_->known_->hashes.count(hash)) {
+        return false;
+    }
+
+    // The earliest file in import order keeps the content whichever worker
+    // gets to it first; a later file that claimed it first was parsed in
+    // vain, and finishImport drops it
+    std::lock_guard<std::mutex> lock(job_->claimsMutex_);
+    ImportJob::OrderKey key(position_, *path_);
+    auto inserted = job_->claims_.emplace(hash, key);
+    if (inserted.second) {
+        return true;
+    }
+    if (key < inserted.first->second) {
+        inserted.first->second = std::move(key);
+        return true;
+    }
+    return false;  // Claimed by an earlier file (or earlier in this tunebook)
+}
+
+void DuplicateCheck::skip(std::string what, std::uint64_t hash) {
+    ImportDuplicate duplicate;
+    duplicate.path = std::move(what);
+    duplicate.hash = hash;
+    skipped_->push_back(std::move(duplicate));
+}
+
+ImportJob::ImportJob(std::vector<std::string> paths, Loader loader, bool expandFolders,
+                     std::shared_ptr<const KnownContent> known)
+    : paths_(std::move(paths)), loader_(std::move(loader)), expandFolders_(expandFolders), known_(std::move(known)) {
+    if (expandFolders_) {
+        walking_ = true;
+    } else {
+        results_.resize(paths_.size());
+        total_ = paths_.size();
+    }
+    thread_ = std::thread(&ImportJob::run, this);
+}
+
+ImportJob::~ImportJob() {
+    cancel();
+    wait();
+}
+
+float ImportJob::progress() const {
+    size_t total = this->total();
+    if (total == 0) {
+        return isDone() ? 1.0f : 0.0f;
+    }
+    return static_cast<float>(completed()) / static_cast<float>(total);
+}
+
+void ImportJob::wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ImportJob::load(const std::string& path, size_t position, Result& result) {
+    result.attempted = true;
+    DuplicateCheck duplicates;
+    duplicates.job_ = this;
+    duplicates.position_ = position;
+    duplicates.path_ = &path;
+    duplicates.skipped_ = &result.duplicates;
+    try {
+        result.loaded = loader_(path, duplicates, result.songs, result.error);
+    } catch (const std::exception& e) {
+        result.loaded = false;
+        result.error = e.what();
+    } catch (...) {
+        result.loaded = false;
+        result.error = "Unknown error";
+    }
+}
+
+void ImportJob::run() {
+    if (expandFolders_) {
+        runExpanded();
+    } else {
+        parallelFor(paths_.size(), [this](size_t i) {
+            if (!cancelRequested_) {
+                load(paths_[i], i, results_[i]);
+            }
+            ++completed_;
+        });
+    }
+    done_ = true;
+}
+
+void ImportJob::runExpanded() {
+    // A file found by the walk; position is its folder's place in the batch
+    struct Found {
+        size_t position;
+        std::string path;
+        Result result;
+    };
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Found> found;  // A deque, so workers keep their entry while more are added
+    size_t next = 0;
+    bool walkFinished = false;
+
+    auto add = [&](size_t position, const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            found.push_back({position, path, Result()});
+            ++total_;
+        }
+        ready.notify_one();
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            ready.wait(lock, [&] { return next < found.size() || walkFinished; });
+            if (next == found.size()) {
+                break;
+            }
+            Found& item = found[next++];
+            lock.unlock();
+            if (!cancelRequested_) {
+                load(item.path, item.position, item.result);
+            }
+            ++completed_;
+            lock.lock();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t workerThreads = workerCount(std::numeric_limits<size_t>::max());
+    for (size_t t = 0; t < workerThreads; ++t) {
+        workers.emplace_back(worker);
+    }
+
+    // Files go straight to the workers; folders are walked
+    std::vector<std::string> folders;
+    std::vector<size_t> folderPositions;
+    for (size_t i = 0; i < paths_.size(); ++i) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(paths_[i], ec)) {
+            folders.push_back(paths_[i]);
+            folderPositions.push_back(i);
+        } else {
+            add(i, paths_[i]);
+        }
+    }
+    walkAbcFiles(folders, [&](size_t root, const std::string& path) {
+        add(folderPositions[root], path);
+    }, cancelRequested_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        walkFinished = true;
+    }
+    walking_ = false;
+    ready.notify_all();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    // The walk finds files in whatever order the walkers get to them; sort
+    // so the same drop always gives the same setlist
+    std::vector<Found*> ordered;
+    ordered.reserve(found.size());
+    for (auto& item : found) {
+        ordered.push_back(&item);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const Found* a, const Found* b) {
+        return a->position != b->position ? a->position < b->position : a->path < b->path;
+    });
+
+    paths_.clear();
+    paths_.reserve(ordered.size());
+    results_.reserve(ordered.size());
+    for (Found* item : ordered) {
+        paths_.push_back(std::move(item->path));
+        results_.push_back(std::move(item->result));
+    }
+}
+
+} // namespace setlistgui
@@ -0,0 +1,30 @@
+#include "InstrumentPool.h"
+
+namespace setlistgui {
+
+InstrumentPool::InstrumentPool() {
+    intern(std::string_view());
+}
+
+InstrumentId InstrumentPool::intern(std::string_view name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+
+    auto id = static_cast<InstrumentId>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+bool InstrumentPool::find(std::string_view name, InstrumentId& id) const {
+    auto it = ids_.find(name);
+    if (it == ids_.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+} // namespace setlistgui
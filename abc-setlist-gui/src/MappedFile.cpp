@@ -0,0 +1,181 @@
+#include "MappedFile.h"
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace setlistgui {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if (mapping_) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping_);
+#else
+        ::munmap(mapping_, mappedSize_);
+#endif
+        mapping_ = nullptr;
+        mappedSize_ = 0;
+    }
+    buffer_.clear();
+    view_ = std::string_view();
+}
+
+std::string MappedFile::takeContents() {
+    std::string contents = mapping_ ? std::string(view_) : std::move(buffer_);
+    close();
+    return contents;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, std::string& error, MapMode mode) {
+    close();
+    stamp_ = FileStamp();
+
+    std::filesystem::path filePath(path);
+    HANDLE file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Cannot open " + path + ": " + std::system_category().message(static_cast<int>(GetLastError()));
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        error = "Cannot stat " + path;
+        CloseHandle(file);
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(size.QuadPart);
+    stamp_.size = static_cast<std::uint64_t>(size.QuadPart);
+
+    FILETIME lastWrite;
+    if (GetFileTime(file, nullptr, nullptr, &lastWrite)) {
+        stamp_.modifiedTime = static_cast<std::int64_t>((static_cast<std::uint64_t>(lastWrite.dwHighDateTime) << 32) |
+                                                  lastWrite.dwLowDateTime);
+    }
+
+    bool ok = true;
+    if (mode == MapMode::Map && fileSize >= kMapThreshold) {
+        HANDLE section = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (section) {
+            mapping_ = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(section);  // The view keeps the section alive
+        }
+        if (mapping_) {
+            mappedSize_ = fileSize;
+            view_ = std::string_view(static_cast<const char*>(mapping_), fileSize);
+        } else {
+            error = "Cannot map " + path;
+            ok = false;
+        }
+    } else {
+        buffer_.resize(fileSize);
+        DWORD read = 0;
+        if (fileSize > 0 && (!ReadFile(file, buffer_.data(), static_cast<DWORD>(fileSize), &read, nullptr) ||
+                             read != fileSize)) {
+            error = "Cannot read " + path;
+            ok = false;
+        }
+        view_ = buffer_;
+    }
+
+    CloseHandle(file);
+    if (!ok) {
+        close();
+    }
+    return ok;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, std::string& error, MapMode mode) {
+    close();
+    stamp_ = FileStamp();
+
+    auto fail = [&](const char* what) {
+        error = std::string(what) + " " + path + ": " + std::error_code(errno, std::generic_category()).message();
+        return false;
+    };
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fail("Cannot open");
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        fail("Cannot stat");
+        ::close(fd);
+        return false;
+    }
+    if (!S_ISREG(info.st_mode)) {
+        ::close(fd);
+        error = "Not a regular file: " + path;
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    stamp_.size = static_cast<std::uint64_t>(info.st_size);
+#ifdef __APPLE__
+    stamp_.modifiedTime = static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    stamp_.modifiedTime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+
+    bool ok = true;
+    if (mode == MapMode::Map && fileSize >= kMapThreshold) {
+        void* mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ok = fail("Cannot map");
+        } else {
+            ::madvise(mapping, fileSize, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            mappedSize_ = fileSize;
+            view_ = std::string_view(static_cast<const char*>(mapping), fileSize);
+        }
+    } else {
+        buffer_.resize(fileSize);
+        size_t total = 0;
+        while (total < fileSize) {
+            ssize_t count = ::read(fd, &buffer_[total], fileSize - total);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                ok = fail("Cannot read");
+                break;
+            }
+            if (count == 0) {
+                buffer_.resize(total);  // File shrank since fstat
+                break;
+            }
+            total += static_cast<size_t>(count);
+        }
+        view_ = buffer_;
+    }
+
+    ::close(fd);  // A mapping stays valid after the descriptor is closed
+    if (!ok) {
+        close();
+    }
+    return ok;
+}
+
+#endif
+
+} // namespace setlistgui
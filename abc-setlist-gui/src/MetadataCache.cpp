@@ -0,0 +1,357 @@
+#include "MetadataCache.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+// File layout: magic, version, entry count, then the entries. Integers are
+// LEB128 varints (signed ones zigzag-encoded), strings are length-prefixed
+// and the content hash is 8 raw little-endian bytes.
+constexpr char kMagic[4] = {'A', 'B', 'C', 'M'};
+constexpr std::uint64_t kVersion = 3;
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : out_(out) {}
+
+    void varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+    void signedVarint(std::int64_t value) {
+        varint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+    void fixed64(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+    void string(std::string_view value) {
+        varint(value.size());
+        out_.append(value.data(), value.size());
+    }
+
+private:
+    std::string& out_;
+};
+
+// Every read is bounds-checked; ok() turns false on truncated/corrupt input
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    bool ok() const { return ok_; }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos_ >= data_.size()) {
+                ok_ = false;
+                return 0;
+            }
+            auto byte = static_cast<unsigned char>(data_[pos_++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+    std::int64_t signedVarint() {
+        std::uint64_t value = varint();
+        return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+    std::uint64_t fixed64() {
+        if (data_.size() - pos_ < 8) {
+            ok_ = false;
+            return 0;
+        }
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data_[pos_++])) << (8 * i);
+        }
+        return value;
+    }
+    std::string string() {
+        std::uint64_t size = varint();
+        if (!ok_ || size > data_.size() - pos_) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string value(data_.substr(pos_, static_cast<size_t>(size)));
+        pos_ += static_cast<size_t>(size);
+        return value;
+    }
+    // Element count that can't claim more entries than bytes remain
+    size_t count() {
+        std::uint64_t value = varint();
+        if (value > data_.size() - pos_) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<size_t>(value);
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+} // namespace
+
+MetadataCache::MetadataCache(std::string cacheFilePath)
+    : cacheFilePath_(std::move(cacheFilePath)) {
+}
+
+std::string MetadataCache::defaultPath() {
+    fs::path base;
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        base = localAppData;
+    }
+#else
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME")) {
+        base = xdgCache;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = fs::path(home) / ".cache";
+    }
+#endif
+    if (base.empty()) {
+        std::error_code ec;
+        base = fs::temp_directory_path(ec);
+    }
+    return (base / "abc-setlist-gui" / "metadata.cache").string();
+}
+
+bool MetadataCache::load() {
+    MappedFile file;
+    std::string error;
+    if (!file.open(cacheFilePath_, error, MapMode::Map)) {
+        return false;  // No cache yet
+    }
+
+    std::unordered_map<std::string, Entry> loaded;
+    Reader reader(file.view());
+    bool valid = file.view().substr(0, sizeof(kMagic)) == std::string_view(kMagic, sizeof(kMagic));
+    if (valid) {
+        reader = Reader(file.view().substr(sizeof(kMagic)));
+        valid = reader.varint() == kVersion;
+    }
+
+    size_t entryCount = valid ? reader.count() : 0;
+    for (size_t i = 0; valid && i < entryCount; ++i) {
+        std::string path = reader.string();
+        Entry entry;
+        entry.stamp.size = reader.varint();
+        entry.stamp.modifiedTime = reader.signedVarint();
+        entry.metadata.contentHash = reader.fixed64();
+        entry.metadata.durationSeconds = static_cast<int>(reader.signedVarint());
+        entry.metadata.title = reader.string();
+
+        size_t titleCount = reader.count();
+        entry.metadata.titleLines.resize(titleCount);
+        for (auto& titleLine : entry.metadata.titleLines) {
+            titleLine.instrument = reader.string();
+            titleLine.lineOffset = reader.varint();
+            titleLine.lineLength = reader.varint();
+            titleLine.textOffset = reader.varint();
+            titleLine.textLength = reader.varint();
+        }
+
+        size_t instrumentCount = reader.count();
+        entry.metadata.instruments.resize(instrumentCount);
+        for (auto& instrument : entry.metadata.instruments) {
+            instrument = reader.string();
+        }
+        entry.metadata.key = reader.string();
+
+        valid = reader.ok();
+        if (valid) {
+            loaded[std::move(path)] = std::move(entry);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!valid) {
+        // Corrupt or from an incompatible version: start over
+        entries_.clear();
+        ++revision_;
+        return false;
+    }
+    entries_ = std::move(loaded);
+    savedRevision_ = revision_;
+    return true;
+}
+
+bool MetadataCache::save() {
+    std::lock_guard<std::mutex> saving(saveMutex_);
+    std::string data;
+    std::uint64_t revision = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (revision_ == savedRevision_) {
+            return true;
+        }
+        revision = revision_;
+
+        data.append(kMagic, sizeof(kMagic));
+        Writer writer(data);
+        writer.varint(kVersion);
+        writer.varint(entries_.size());
+        for (const auto& [path, entry] : entries_) {
+            const SongMetadata& metadata = entry.metadata;
+            writer.string(path);
+            writer.varint(entry.stamp.size);
+            writer.signedVarint(entry.stamp.modifiedTime);
+            writer.fixed64(metadata.contentHash);
+            writer.signedVarint(metadata.durationSeconds);
+            writer.string(metadata.title);
+            writer.varint(metadata.titleLines.size());
+            for (const auto& titleLine : metadata.titleLines) {
+                writer.string(titleLine.instrument);
+                writer.varint(titleLine.lineOffset);
+                writer.varint(titleLine.lineLength);
+                writer.varint(titleLine.textOffset);
+                writer.varint(titleLine.textLength);
+            }
+            writer.varint(metadata.instruments.size());
+            for (const auto& instrument : metadata.instruments) {
+                writer.string(instrument);
+            }
+            writer.string(metadata.key);
+        }
+    }
+
+    // Write beside the cache file and rename over it, so a crash mid-save
+    // leaves the previous cache intact. The temporary name is unique, as
+    // another process (the CLI with --cache) may be saving the same file.
+    std::error_code ec;
+    fs::create_directories(fs::path(cacheFilePath_).parent_path(), ec);
+    std::string tempPath = uniqueTempPath(cacheFilePath_);
+    std::string error;
+    if (!writeFileDurable(tempPath, data, error)) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    fs::rename(tempPath, cacheFilePath_, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+
+    // Only now is the snapshot on disk; a failed save leaves the cache to
+    // be written by the next one. Changes made meanwhile stay unsaved.
+    std::lock_guard<std::mutex> lock(mutex_);
+    savedRevision_ = revision;
+    return true;
+}
+
+bool MetadataCache::lookup(const std::string& canonicalPath, const FileStamp& stamp,
+                           std::string_view content, SongMetadata& metadata) {
+    bool verify = verifyContent();
+    std::uint64_t hash = verify ? contentHash(content) : 0;  // Hashed outside the lock
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(canonicalPath);
+    if (it == entries_.end() || it->second.stamp != stamp ||
+        (verify && it->second.metadata.contentHash != hash)) {
+        ++misses_;
+        return false;
+    }
+
+    ++hits_;
+    metadata = it->second.metadata;
+    return true;
+}
+
+void MetadataCache::store(const std::string& canonicalPath, const FileStamp& stamp, SongMetadata metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[canonicalPath];
+    entry.stamp = stamp;
+    entry.metadata = std::move(metadata);
+    ++revision_;
+}
+
+void MetadataCache::setVerifyContent(bool verify) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    verifyContent_ = verify;
+}
+
+bool MetadataCache::verifyContent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return verifyContent_;
+}
+
+void MetadataCache::invalidate(const std::string& canonicalPath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.erase(canonicalPath) > 0) {
+        ++revision_;
+    }
+}
+
+void MetadataCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    hits_ = 0;
+    misses_ = 0;
+    ++revision_;
+}
+
+size_t MetadataCache::compact() {
+    // Stat outside the lock so import workers' lookups aren't held up by
+    // the sweep
+    std::vector<std::pair<std::string, FileStamp>> recorded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recorded.reserve(entries_.size());
+        for (const auto& [path, entry] : entries_) {
+            recorded.emplace_back(path, entry.stamp);
+        }
+    }
+    std::vector<size_t> stale;
+    for (size_t i = 0; i < recorded.size(); ++i) {
+        FileStamp current;
+        if (!statFileStamp(recorded[i].first, current) || current != recorded[i].second) {
+            stale.push_back(i);
+        }
+    }
+
+    // An entry stored again meanwhile describes the file as it is now
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = 0;
+    for (size_t i : stale) {
+        auto it = entries_.find(recorded[i].first);
+        if (it != entries_.end() && it->second.stamp == recorded[i].second) {
+            entries_.erase(it);
+            ++removed;
+        }
+    }
+    if (removed > 0) {
+        ++revision_;
+    }
+    return removed;
+}
+
+MetadataCache::Stats MetadataCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.entries = entries_.size();
+    stats.hits = hits_;
+    stats.misses = misses_;
+    return stats;
+}
+
+} // namespace setlistgui
@@ -0,0 +1,222 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point kEpoch = Clock::now();
+
+std::atomic<std::uint32_t> g_nextThreadId{1};
+thread_local std::uint32_t t_threadId = 0;
+
+std::uint32_t currentThreadId() {
+    if (t_threadId == 0) {
+        t_threadId = g_nextThreadId++;
+    }
+    return t_threadId;
+}
+
+struct ThreadName {
+    std::uint32_t threadId;
+    std::string name;
+};
+
+// Everything behind the probes; only touched while profiling is enabled
+struct ProfilerState {
+    std::mutex mutex;
+    std::vector<ProfileEvent> recent = std::vector<ProfileEvent>(Profiler::kRecentEvents);
+    size_t recentNext = 0;
+    std::vector<float> frames = std::vector<float>(Profiler::kFrameHistory, 0.0f);
+    size_t framesNext = 0;
+    bool tracing = false;
+    std::vector<ProfileEvent> trace;
+    std::vector<ThreadName> threadNames;
+};
+
+ProfilerState& state() {
+    static ProfilerState instance;
+    return instance;
+}
+
+const char* categoryName(ProfileCategory category) {
+    return category == ProfileCategory::Frame ? "frame" : "operation";
+}
+
+void writeJsonString(FILE* out, const char* text) {
+    std::fputc('"', out);
+    for (const char* p = text; *p; ++p) {
+        auto c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            std::fputc('\\', out);
+            std::fputc(c, out);
+        } else if (c < 0x20) {
+            std::fprintf(out, "\\u%04x", c);
+        } else {
+            std::fputc(c, out);
+        }
+    }
+    std::fputc('"', out);
+}
+
+} // namespace
+
+std::atomic<bool> Profiler::enabled_{false};
+
+void Profiler::setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+std::int64_t Profiler::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - kEpoch).count();
+}
+
+void Profiler::record(const char* name, ProfileCategory category, std::int64_t startUs, std::int64_t endUs) {
+    ProfileEvent event;
+    event.name = name;
+    event.category = category;
+    event.threadId = currentThreadId();
+    event.startUs = startUs;
+    event.durationUs = endUs - startUs;
+
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.recent[s.recentNext] = event;
+    s.recentNext = (s.recentNext + 1) % kRecentEvents;
+    if (s.tracing && s.trace.size() < kMaxTraceEvents) {
+        s.trace.push_back(event);
+    }
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    std::uint32_t threadId = currentThreadId();
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (auto& threadName : s.threadNames) {
+        if (threadName.threadId == threadId) {
+            threadName.name = name;
+            return;
+        }
+    }
+    s.threadNames.push_back({threadId, name});
+}
+
+void Profiler::recordFrame(float milliseconds) {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.frames[s.framesNext] = milliseconds;
+    s.framesNext = (s.framesNext + 1) % kFrameHistory;
+}
+
+std::vector<float> Profiler::frameTimes() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::vector<float> frames;
+    frames.reserve(kFrameHistory);
+    frames.insert(frames.end(), s.frames.begin() + s.framesNext, s.frames.end());
+    frames.insert(frames.end(), s.frames.begin(), s.frames.begin() + s.framesNext);
+    return frames;
+}
+
+std::vector<ProfileEvent> Profiler::slowestRecent(size_t count) {
+    std::vector<ProfileEvent> operations;
+    {
+        ProfilerState& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (const auto& event : s.recent) {
+            if (event.category == ProfileCategory::Operation && event.durationUs > 0) {
+                operations.push_back(event);
+            }
+        }
+    }
+    count = std::min(count, operations.size());
+    std::partial_sort(operations.begin(), operations.begin() + count, operations.end(),
+                      [](const ProfileEvent& a, const ProfileEvent& b) { return a.durationUs > b.durationUs; });
+    operations.resize(count);
+    return operations;
+}
+
+void Profiler::startTrace() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.trace.clear();
+    s.tracing = true;
+}
+
+bool Profiler::isTracing() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.tracing;
+}
+
+size_t Profiler::traceEventCount() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.trace.size();
+}
+
+bool Profiler::stopTrace(const std::string& path, std::string& error) {
+    std::vector<ProfileEvent> events;
+    std::vector<ThreadName> threadNames;
+    {
+        ProfilerState& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.tracing = false;
+        events.swap(s.trace);
+        threadNames = s.threadNames;
+    }
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "Cannot write " + path;
+        return false;
+    }
+
+    // Chrome trace-event format: complete ("X") events plus thread names
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& threadName : threadNames) {
+        std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                     first ? "" : ",\n", threadName.threadId);
+        writeJsonString(out, threadName.name.c_str());
+        std::fprintf(out, "}}");
+        first = false;
+    }
+    for (const auto& event : events) {
+        std::fprintf(out, "%s{\"name\":", first ? "" : ",\n");
+        writeJsonString(out, event.name);
+        std::fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+                     categoryName(event.category), event.threadId,
+                     static_cast<long long>(event.startUs), static_cast<long long>(event.durationUs));
+        first = false;
+    }
+    std::fprintf(out, "\n]}\n");
+
+    bool ok = std::fflush(out) == 0 && !std::ferror(out);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        error = "Error writing " + path;
+    }
+    return ok;
+}
+
+std::string Profiler::defaultTracePath() {
+    std::error_code ec;
+    fs::path folder = fs::temp_directory_path(ec);
+    std::time_t now = std::time(nullptr);
+    char name[64];
+    std::strftime(name, sizeof(name), "abc-setlist-trace-%Y%m%d-%H%M%S.json", std::localtime(&now));
+    return (folder / name).string();
+}
+
+} // namespace setlistgui
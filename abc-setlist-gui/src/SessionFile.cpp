@@ -0,0 +1,460 @@
+#include "SessionFile.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "MetadataCache.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+// File layout (integers little-endian; sections follow each other in this
+// order with no gaps):
+//
+//   Header        kHeaderSize bytes
+//   Songs         songCount records of kSongSize bytes, in setlist order
+//   Title lines   titleLineCount records of kTitleLineSize bytes
+//   Instruments   instrumentCount u32 string ids (each card's list)
+//   Strings       stringCount (u32 offset, u32 length) entries, then
+//                 stringBytes bytes of text; string 0 is ""
+//   Content       optional embedded song bytes, from contentOffset
+//
+// Header: magic, u32 version, u32 flags, i32 padding, i32 intro,
+// u32 export folder, u32 songCount, u32 titleLineCount,
+// u32 instrumentCount, u32 stringCount, u64 stringBytes,
+// u64 contentOffset, u64 fileSize, u64 hash of everything between the
+// header and contentOffset.
+constexpr char kMagic[4] = {'A', 'B', 'C', 'S'};
+constexpr std::uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 72;
+constexpr size_t kSongSize = 104;
+constexpr size_t kTitleLineSize = 48;
+constexpr size_t kStringEntrySize = 8;
+
+// Header flags
+constexpr std::uint32_t kSplitTunebooks = 1;
+constexpr std::uint32_t kAddNumbering = 2;
+constexpr std::uint32_t kSyncExport = 4;
+
+// Song and title line flags
+constexpr std::uint32_t kTitleEdited = 1;
+constexpr std::uint32_t kBookTune = 2;
+constexpr std::uint32_t kEmbedded = 4;
+constexpr std::uint32_t kLineEdited = 1;
+
+void put32(std::string& out, size_t at, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[at + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void put64(std::string& out, size_t at, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[at + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+std::uint32_t get32(std::string_view data, size_t at) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[at + i])) << (8 * i);
+    }
+    return value;
+}
+
+std::uint64_t get64(std::string_view data, size_t at) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[at + i])) << (8 * i);
+    }
+    return value;
+}
+
+// Deduplicating string table: each distinct string gets one id
+class StringTable {
+public:
+    StringTable() { add(std::string_view()); }
+
+    std::uint32_t add(std::string_view value) {
+        auto it = ids_.find(value);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        auto id = static_cast<std::uint32_t>(strings_.size());
+        strings_.push_back(value);
+        ids_.emplace(value, id);
+        bytes_ += value.size();
+        return id;
+    }
+
+    size_t size() const { return strings_.size(); }
+    size_t bytes() const { return bytes_; }
+
+    void write(std::string& out, size_t at) const {
+        size_t text = at + strings_.size() * kStringEntrySize;
+        std::uint32_t offset = 0;
+        for (size_t i = 0; i < strings_.size(); ++i) {
+            put32(out, at + i * kStringEntrySize, offset);
+            put32(out, at + i * kStringEntrySize + 4, static_cast<std::uint32_t>(strings_[i].size()));
+            out.replace(text + offset, strings_[i].size(), strings_[i]);
+            offset += static_cast<std::uint32_t>(strings_[i].size());
+        }
+    }
+
+private:
+    std::vector<std::string_view> strings_;  // Views into the songs being written
+    std::unordered_map<std::string_view, std::uint32_t> ids_;
+    size_t bytes_ = 0;
+};
+
+SourceStatus checkSource(const SourceCheck& check) {
+    SourceStatus status;
+    status.path = check.path;
+    status.recorded = check.stamp;
+    if (!statFileStamp(check.path, status.current)) {
+        status.result = SourceStatus::Result::Missing;
+        return status;
+    }
+    if (status.current == check.stamp) {
+        return status;
+    }
+
+    MappedFile file;
+    std::string error;
+    if (!file.open(check.path, error)) {
+        status.result = SourceStatus::Result::Missing;
+        return status;
+    }
+    std::string_view data = file.view();
+    status.current = file.stamp();
+    status.result = SourceStatus::Result::Touched;
+    for (const auto& range : check.ranges) {
+        bool fits = range.wholeFile ? data.size() == range.size
+                                    : range.offset <= data.size() && range.size <= data.size() - range.offset;
+        if (!fits || contentHash(data.substr(static_cast<size_t>(range.offset), static_cast<size_t>(range.size))) !=
+                         range.hash) {
+            status.result = SourceStatus::Result::Changed;
+            break;
+        }
+    }
+    return status;
+}
+
+} // namespace
+
+bool writeSessionFile(const std::string& path, const SessionSettings& settings,
+                      const std::vector<SessionSong>& songs, const InstrumentPool& instruments,
+                      std::vector<std::uint64_t>& contentOffsets, std::string& error) {
+    ProfileScope probe("writeSession");
+    StringTable strings;
+    std::uint32_t exportFolder = strings.add(settings.exportFolder);
+
+    // Intern every string first: the table's size fixes where content starts
+    size_t titleLineCount = 0;
+    size_t instrumentCount = 0;
+    std::vector<std::uint32_t> instrumentIds(instruments.size());
+    for (InstrumentId id = 0; id < instruments.size(); ++id) {
+        instrumentIds[id] = strings.add(instruments.name(id));
+    }
+    for (const auto& song : songs) {
+        const SongSource& source = *song.details->source;
+        strings.add(song.card->title);
+        strings.add(song.card->filename);
+        strings.add(source.originalFilePath);
+        strings.add(source.originalTitle);
+        strings.add(source.key);
+        strings.add(source.bookReference);
+        for (size_t i = 0; i < song.details->titleLines.size(); ++i) {
+            strings.add(song.details->titleLines[i].fullTitle);
+            strings.add(source.titleTexts[i]);
+        }
+        titleLineCount += song.details->titleLines.size();
+        instrumentCount += song.card->instruments.size();
+    }
+
+    size_t songsAt = kHeaderSize;
+    size_t titleLinesAt = songsAt + songs.size() * kSongSize;
+    size_t instrumentsAt = titleLinesAt + titleLineCount * kTitleLineSize;
+    size_t stringsAt = instrumentsAt + instrumentCount * 4;
+    size_t contentAt = stringsAt + strings.size() * kStringEntrySize + strings.bytes();
+    size_t fileSize = contentAt;
+    for (const auto& song : songs) {
+        if (song.content) {
+            fileSize += song.content->size();
+        }
+    }
+    if (strings.bytes() > UINT32_MAX) {
+        error = "Too much text for a session file";
+        return false;
+    }
+
+    std::string data(fileSize, '\0');
+    data.replace(0, sizeof(kMagic), kMagic, sizeof(kMagic));
+    put32(data, 4, kVersion);
+    put32(data, 8, (settings.splitTunebooks ? kSplitTunebooks : 0) | (settings.addNumbering ? kAddNumbering : 0) |
+                       (settings.syncExport ? kSyncExport : 0));
+    put32(data, 12, static_cast<std::uint32_t>(settings.paddingSeconds));
+    put32(data, 16, static_cast<std::uint32_t>(settings.introSeconds));
+    put32(data, 20, exportFolder);
+    put32(data, 24, static_cast<std::uint32_t>(songs.size()));
+    put32(data, 28, static_cast<std::uint32_t>(titleLineCount));
+    put32(data, 32, static_cast<std::uint32_t>(instrumentCount));
+    put32(data, 36, static_cast<std::uint32_t>(strings.size()));
+    put64(data, 40, strings.bytes());
+    put64(data, 48, contentAt);
+    put64(data, 56, fileSize);
+
+    contentOffsets.assign(songs.size(), 0);
+    size_t firstTitleLine = 0;
+    size_t firstInstrument = 0;
+    size_t nextContent = contentAt;
+    for (size_t index = 0; index < songs.size(); ++index) {
+        const SongCard& card = *songs[index].card;
+        const SongDetails& details = *songs[index].details;
+        const SongSource& source = *details.source;
+        const auto& content = songs[index].content;
+        size_t at = songsAt + index * kSongSize;
+        put32(data, at, strings.add(card.title));
+        put32(data, at + 4, strings.add(card.filename));
+        put32(data, at + 8, strings.add(source.originalFilePath));
+        put32(data, at + 12, strings.add(source.originalTitle));
+        put32(data, at + 16, strings.add(source.key));
+        put32(data, at + 20, strings.add(source.bookReference));
+        put32(data, at + 24, static_cast<std::uint32_t>(card.durationSeconds));
+        put32(data, at + 28, (card.titleEdited ? kTitleEdited : 0) | (source.bookTune ? kBookTune : 0) |
+                                 (content ? kEmbedded : 0));
+        put32(data, at + 32, static_cast<std::uint32_t>(firstTitleLine));
+        put32(data, at + 36, static_cast<std::uint32_t>(details.titleLines.size()));
+        put32(data, at + 40, static_cast<std::uint32_t>(firstInstrument));
+        put32(data, at + 44, static_cast<std::uint32_t>(card.instruments.size()));
+        put32(data, at + 48, source.bookIndex);
+        put64(data, at + 56, source.stamp.size);
+        put64(data, at + 64, static_cast<std::uint64_t>(source.stamp.modifiedTime));
+        put64(data, at + 72, source.contentSize);
+        put64(data, at + 80, source.contentHash);
+        put64(data, at + 88, source.bookOffset);
+        if (content) {
+            put64(data, at + 96, nextContent);
+            data.replace(nextContent, content->size(), *content);
+            contentOffsets[index] = nextContent;
+            nextContent += content->size();
+        }
+
+        for (size_t i = 0; i < details.titleLines.size(); ++i) {
+            const TitleLine& titleLine = details.titleLines[i];
+            size_t lineAt = titleLinesAt + (firstTitleLine + i) * kTitleLineSize;
+            put32(data, lineAt, strings.add(titleLine.fullTitle));
+            put32(data, lineAt + 4, instrumentIds[titleLine.instrument]);
+            put32(data, lineAt + 8, strings.add(source.titleTexts[i]));
+            put32(data, lineAt + 12, titleLine.titleEdited ? kLineEdited : 0);
+            put64(data, lineAt + 16, titleLine.lineOffset);
+            put64(data, lineAt + 24, titleLine.lineLength);
+            put64(data, lineAt + 32, titleLine.textOffset);
+            put64(data, lineAt + 40, titleLine.textLength);
+        }
+        firstTitleLine += details.titleLines.size();
+
+        for (InstrumentId instrument : card.instruments) {
+            put32(data, instrumentsAt + firstInstrument * 4, instrumentIds[instrument]);
+            ++firstInstrument;
+        }
+    }
+    strings.write(data, stringsAt);
+    put64(data, 64, contentHash(std::string_view(data).substr(kHeaderSize, contentAt - kHeaderSize)));
+
+    // Write beside the session and rename over it, so a failed save leaves
+    // the previous session intact
+    std::error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent, ec);
+    }
+    std::string tempPath = uniqueTempPath(path);
+    if (!writeFileDurable(tempPath, data, error)) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        error = "Cannot replace " + path + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+bool readSessionFile(const std::string& path, SessionSettings& settings, std::vector<LoadedSong>& songs,
+                     std::string& error) {
+    ProfileScope probe("readSession");
+    MappedFile file;
+    if (!file.open(path, error, MapMode::Map)) {
+        return false;
+    }
+    std::string_view data = file.view();
+    if (data.size() < kHeaderSize || data.substr(0, sizeof(kMagic)) != std::string_view(kMagic, sizeof(kMagic))) {
+        error = path + " is not a session file";
+        return false;
+    }
+    if (get32(data, 4) != kVersion) {
+        error = path + " is from an incompatible version";
+        return false;
+    }
+
+    // Section sizes must add up exactly, and the records must hash to the
+    // header's checksum, before anything in them is trusted
+    std::uint32_t flags = get32(data, 8);
+    size_t songCount = get32(data, 24);
+    size_t titleLineCount = get32(data, 28);
+    size_t instrumentCount = get32(data, 32);
+    size_t stringCount = get32(data, 36);
+    std::uint64_t stringBytes = get64(data, 40);
+    std::uint64_t contentAt = get64(data, 48);
+    size_t songsAt = kHeaderSize;
+    size_t titleLinesAt = songsAt + songCount * kSongSize;
+    size_t instrumentsAt = titleLinesAt + titleLineCount * kTitleLineSize;
+    size_t stringsAt = instrumentsAt + instrumentCount * 4;
+    size_t textAt = stringsAt + stringCount * kStringEntrySize;
+    if (get64(data, 56) != data.size() || stringCount == 0 || stringBytes > data.size() ||
+        contentAt != textAt + stringBytes || contentAt > data.size() ||
+        contentHash(data.substr(kHeaderSize, static_cast<size_t>(contentAt) - kHeaderSize)) != get64(data, 64)) {
+        error = path + " is damaged";
+        return false;
+    }
+
+    std::vector<std::string_view> strings(stringCount);
+    for (size_t i = 0; i < stringCount; ++i) {
+        std::uint64_t offset = get32(data, stringsAt + i * kStringEntrySize);
+        std::uint64_t length = get32(data, stringsAt + i * kStringEntrySize + 4);
+        if (offset + length > stringBytes) {
+            error = path + " is damaged";
+            return false;
+        }
+        strings[i] = data.substr(textAt + static_cast<size_t>(offset), static_cast<size_t>(length));
+    }
+    bool valid = true;
+    auto string = [&](size_t at) {
+        std::uint32_t id = get32(data, at);
+        if (id >= stringCount) {
+            valid = false;
+            return std::string();
+        }
+        return std::string(strings[id]);
+    };
+
+    std::vector<LoadedSong> loaded(songCount);
+    for (size_t index = 0; valid && index < songCount; ++index) {
+        size_t at = songsAt + index * kSongSize;
+        LoadedSong& song = loaded[index];
+        SongSource& source = song.source;
+        song.card.title = string(at);
+        song.card.filename = string(at + 4);
+        source.originalFilePath = string(at + 8);
+        source.originalTitle = string(at + 12);
+        source.key = string(at + 16);
+        source.bookReference = string(at + 20);
+        song.card.durationSeconds = static_cast<std::int32_t>(get32(data, at + 24));
+        std::uint32_t songFlags = get32(data, at + 28);
+        song.card.titleEdited = (songFlags & kTitleEdited) != 0;
+        source.bookTune = (songFlags & kBookTune) != 0;
+        size_t firstTitleLine = get32(data, at + 32);
+        size_t lineCount = get32(data, at + 36);
+        size_t firstInstrument = get32(data, at + 40);
+        size_t cardInstruments = get32(data, at + 44);
+        source.bookIndex = get32(data, at + 48);
+        source.stamp.size = get64(data, at + 56);
+        source.stamp.modifiedTime = static_cast<std::int64_t>(get64(data, at + 64));
+        source.contentSize = get64(data, at + 72);
+        source.contentHash = get64(data, at + 80);
+        source.bookOffset = get64(data, at + 88);
+        if (songFlags & kEmbedded) {
+            source.embeddedPath = path;
+            source.embeddedOffset = get64(data, at + 96);
+            valid = source.embeddedOffset >= contentAt && source.embeddedOffset <= data.size() &&
+                    source.contentSize <= data.size() - source.embeddedOffset;
+        }
+        if (firstTitleLine > titleLineCount || lineCount > titleLineCount - firstTitleLine ||
+            firstInstrument > instrumentCount || cardInstruments > instrumentCount - firstInstrument) {
+            valid = false;
+            break;
+        }
+
+        song.details.titleLines.resize(lineCount);
+        song.partInstruments.resize(lineCount);
+        source.titleTexts.resize(lineCount);
+        for (size_t i = 0; i < lineCount; ++i) {
+            size_t lineAt = titleLinesAt + (firstTitleLine + i) * kTitleLineSize;
+            TitleLine& titleLine = song.details.titleLines[i];
+            titleLine.fullTitle = string(lineAt);
+            titleLine.instrument = InstrumentPool::kNone;
+            song.partInstruments[i] = string(lineAt + 4);
+            source.titleTexts[i] = string(lineAt + 8);
+            titleLine.titleEdited = (get32(data, lineAt + 12) & kLineEdited) != 0;
+            titleLine.lineOffset = static_cast<size_t>(get64(data, lineAt + 16));
+            titleLine.lineLength = static_cast<size_t>(get64(data, lineAt + 24));
+            titleLine.textOffset = static_cast<size_t>(get64(data, lineAt + 32));
+            titleLine.textLength = static_cast<size_t>(get64(data, lineAt + 40));
+            if (titleLine.lineOffset + titleLine.lineLength > source.contentSize ||
+                titleLine.textOffset + titleLine.textLength > source.contentSize) {
+                valid = false;
+            }
+        }
+        song.instruments.resize(cardInstruments);
+        for (size_t i = 0; i < cardInstruments; ++i) {
+            song.instruments[i] = string(instrumentsAt + (firstInstrument + i) * 4);
+        }
+    }
+    std::string exportFolder = string(20);
+    if (!valid) {
+        error = path + " is damaged";
+        return false;
+    }
+
+    settings.paddingSeconds = static_cast<std::int32_t>(get32(data, 12));
+    settings.introSeconds = static_cast<std::int32_t>(get32(data, 16));
+    settings.splitTunebooks = (flags & kSplitTunebooks) != 0;
+    settings.addNumbering = (flags & kAddNumbering) != 0;
+    settings.syncExport = (flags & kSyncExport) != 0;
+    settings.exportFolder = std::move(exportFolder);
+    songs = std::move(loaded);
+    return true;
+}
+
+SourceCheckJob::SourceCheckJob(std::vector<SourceCheck> checks)
+    : checks_(std::move(checks)) {
+    thread_ = std::thread([this] { run(); });
+}
+
+SourceCheckJob::~SourceCheckJob() {
+    cancel();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SourceCheckJob::run() {
+    ProfileScope probe("checkSources");
+    std::vector<SourceStatus> results(checks_.size());
+    parallelFor(checks_.size(), [&](size_t i) {
+        if (cancelRequested_) {
+            results[i].path = checks_[i].path;
+            results[i].recorded = results[i].current = checks_[i].stamp;
+        } else {
+            results[i] = checkSource(checks_[i]);
+        }
+        ++completed_;
+    });
+    results_ = std::move(results);
+    done_ = true;
+}
+
+std::string defaultSessionPath() {
+    return (fs::path(MetadataCache::defaultPath()).parent_path() / "session.abcs").string();
+}
+
+} // namespace setlistgui
@@ -0,0 +1,483 @@
+#include "SetBuilder.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+namespace setlistgui {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t kNoSong = std::numeric_limits<std::uint32_t>::max();
+constexpr std::int64_t kLengthWeight = 1000;   // Per second outside the tolerance
+constexpr size_t kMaxChangeTable = 2048;       // Pool size up to which pair costs are precomputed
+constexpr std::uint64_t kStallMoves = 50000;   // Moves without a new local best before a restart
+constexpr int kMoveKinds = 8;
+
+// Tonic and mode of a K: value, so that "D", "Dmaj" and "D major" (or
+// "Em", "Emin" and "E aeolian") compare equal; "" when there is no key or
+// no tonic ("none", "HP"), so such tunes never count as a key repeat
+std::string normalizeKey(std::string_view key) {
+    std::string lower;
+    for (char c : key) {
+        lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    size_t start = lower.find_first_not_of(" \t");
+    if (start == std::string::npos || lower[start] < 'a' || lower[start] > 'g') {
+        return std::string();
+    }
+
+    std::string tonic(1, lower[start]);
+    size_t next = start + 1;
+    if (next < lower.size() && (lower[next] == '#' || lower[next] == 'b')) {
+        tonic.push_back(lower[next++]);
+    }
+
+    // The mode is written straight after the tonic or as the next word
+    size_t modeEnd = next;
+    while (modeEnd < lower.size() && std::isalpha(static_cast<unsigned char>(lower[modeEnd]))) {
+        ++modeEnd;
+    }
+    std::string mode = lower.substr(next, modeEnd - next);
+    if (mode.empty()) {
+        size_t word = lower.find_first_not_of(" \t", next);
+        if (word != std::string::npos) {
+            size_t wordEnd = word;
+            while (wordEnd < lower.size() && std::isalpha(static_cast<unsigned char>(lower[wordEnd]))) {
+                ++wordEnd;
+            }
+            if (wordEnd == lower.size() || lower[wordEnd] == ' ' || lower[wordEnd] == '\t') {
+                mode = lower.substr(word, wordEnd - word);  // Not "clef=..." and the like
+            }
+        }
+    }
+
+    mode = mode.substr(0, 3);
+    if (mode == "maj" || mode == "ion") {
+        mode.clear();
+    } else if (mode == "m" || mode == "min" || mode == "aeo") {
+        mode = "m";
+    } else if (mode != "dor" && mode != "phr" && mode != "lyd" && mode != "mix" && mode != "loc") {
+        mode.clear();
+    }
+    return tonic + mode;
+}
+
+int symmetricDifference(const std::vector<InstrumentId>& a, const std::vector<InstrumentId>& b) {
+    int count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] == b[j]) {
+            ++i;
+            ++j;
+        } else if (a[i] < b[j]) {
+            ++count;
+            ++i;
+        } else {
+            ++count;
+            ++j;
+        }
+    }
+    return count + static_cast<int>(a.size() - i) + static_cast<int>(b.size() - j);
+}
+
+} // namespace
+
+SetBuilderJob::SetBuilderJob(std::vector<SetCandidate> candidates, SetBuilderOptions options)
+    : candidates_(std::move(candidates)), options_(std::move(options)),
+      start_(Clock::now()), bestCost_(std::numeric_limits<std::int64_t>::max()) {
+    size_t count = candidates_.size();
+
+    std::unordered_map<std::uint32_t, std::uint32_t> indexOf;
+    std::unordered_map<std::string, int> keyIds;
+    keys_.resize(count, -1);
+    instruments_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const SetCandidate& candidate = candidates_[i];
+        indexOf.emplace(candidate.id, static_cast<std::uint32_t>(i));
+
+        std::string key = normalizeKey(candidate.key);
+        if (!key.empty()) {
+            keys_[i] = keyIds.emplace(key, static_cast<int>(keyIds.size())).first->second;
+        }
+
+        auto& instruments = instruments_[i];
+        for (InstrumentId instrument : candidate.instruments) {
+            if (instrument != InstrumentPool::kNone) {
+                instruments.push_back(instrument);
+            }
+        }
+        std::sort(instruments.begin(), instruments.end());
+        instruments.erase(std::unique(instruments.begin(), instruments.end()), instruments.end());
+    }
+
+    // Pinned songs that are in the pool, each once (an opener wins over a closer)
+    std::vector<char> pinned(count, 0);
+    auto pin = [&](const std::vector<std::uint32_t>& ids, std::vector<std::uint32_t>& into) {
+        for (std::uint32_t id : ids) {
+            auto it = indexOf.find(id);
+            if (it != indexOf.end() && !pinned[it->second]) {
+                pinned[it->second] = 1;
+                into.push_back(it->second);
+            }
+        }
+    };
+    pin(options_.openers, openers_);
+    pin(options_.closers, closers_);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        if (!pinned[i]) {
+            free_.push_back(i);
+        }
+    }
+    byDuration_ = free_;
+    std::sort(byDuration_.begin(), byDuration_.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return candidates_[a].durationSeconds < candidates_[b].durationSeconds;
+    });
+
+    if (count <= kMaxChangeTable) {
+        changes_.resize(count * count);
+        for (size_t a = 0; a < count; ++a) {
+            for (size_t b = 0; b < count; ++b) {
+                changes_[a * count + b] = static_cast<std::uint16_t>(
+                    std::min(symmetricDifference(instruments_[a], instruments_[b]), 0xFFFF));
+            }
+        }
+    }
+
+    thread_ = std::thread(&SetBuilderJob::run, this);
+}
+
+SetBuilderJob::~SetBuilderJob() {
+    cancel();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+double SetBuilderJob::elapsedMs() const {
+    if (done_) {
+        return elapsedMs_.load();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+}
+
+std::vector<SetSolution> SetBuilderJob::takeImprovements() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SetSolution> improvements;
+    improvements.swap(improvements_);
+    return improvements;
+}
+
+bool SetBuilderJob::best(SetSolution& solution) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (haveBest_) {
+        solution = best_;
+    }
+    return haveBest_;
+}
+
+void SetBuilderJob::setOnImprovement(std::function<void()> onImprovement) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    onImprovement_ = std::move(onImprovement);
+}
+
+void SetBuilderJob::run() {
+    ProfileScope probe("buildSet");
+    size_t threads = options_.threads;
+    if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    if (free_.empty()) {
+        threads = 1;  // Nothing to choose: one evaluation of the pinned songs
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < threads; ++worker) {
+        workers.emplace_back(&SetBuilderJob::search, this, worker);
+    }
+    search(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    elapsedMs_ = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+    done_ = true;
+}
+
+int SetBuilderJob::transitionChanges(std::uint32_t from, std::uint32_t to) const {
+    if (!changes_.empty()) {
+        return changes_[static_cast<size_t>(from) * candidates_.size() + to];
+    }
+    return symmetricDifference(instruments_[from], instruments_[to]);
+}
+
+SetBuilderJob::Score SetBuilderJob::evaluate(const std::vector<std::uint32_t>& middle) const {
+    Score score;
+    size_t count = 0;
+    int songSeconds = 0;
+    std::uint32_t previous = kNoSong;
+    auto visit = [&](std::uint32_t song) {
+        songSeconds += candidates_[song].durationSeconds;
+        if (previous != kNoSong) {
+            score.instrumentChanges += transitionChanges(previous, song);
+            if (keys_[song] >= 0 && keys_[song] == keys_[previous]) {
+                ++score.keyRepeats;
+            }
+        }
+        previous = song;
+        ++count;
+    };
+    for (std::uint32_t song : openers_) {
+        visit(song);
+    }
+    for (std::uint32_t song : middle) {
+        visit(song);
+    }
+    for (std::uint32_t song : closers_) {
+        visit(song);
+    }
+
+    score.totalSeconds = options_.introSeconds + songSeconds +
+                         (count > 1 ? options_.paddingSeconds * static_cast<int>(count - 1) : 0);
+    int excess = std::max(0, std::abs(score.totalSeconds - options_.targetSeconds) - options_.toleranceSeconds);
+    score.cost = kLengthWeight * excess +
+                 static_cast<std::int64_t>(options_.instrumentChangeWeight) * score.instrumentChanges +
+                 static_cast<std::int64_t>(options_.keyRepeatWeight) * score.keyRepeats;
+    return score;
+}
+
+void SetBuilderJob::offer(const std::vector<std::uint32_t>& middle, const Score& score) {
+    if (score.cost >= bestCost_.load()) {
+        return;
+    }
+
+    std::function<void()> onImprovement;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (haveBest_ && score.cost >= best_.cost) {
+            return;  // Another thread got there first
+        }
+
+        SetSolution solution;
+        solution.order.reserve(openers_.size() + middle.size() + closers_.size());
+        auto append = [&](const std::vector<std::uint32_t>& songs) {
+            for (std::uint32_t song : songs) {
+                solution.order.push_back(candidates_[song].id);
+            }
+        };
+        append(openers_);
+        append(middle);
+        append(closers_);
+        solution.totalSeconds = score.totalSeconds;
+        solution.lengthError = score.totalSeconds - options_.targetSeconds;
+        solution.instrumentChanges = score.instrumentChanges;
+        solution.keyRepeats = score.keyRepeats;
+        solution.cost = score.cost;
+        solution.foundAfterMs = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+
+        best_ = solution;
+        bestMiddle_ = middle;
+        haveBest_ = true;
+        bestCost_ = score.cost;
+        improvements_.push_back(std::move(solution));
+        onImprovement = onImprovement_;
+        if (score.cost == 0) {
+            solved_ = true;  // Nothing can beat it
+        }
+    }
+    if (onImprovement) {
+        onImprovement();
+    }
+}
+
+void SetBuilderJob::search(size_t worker) {
+    std::uint64_t seed = options_.seed != 0 ? options_.seed : std::random_device()();
+    std::mt19937_64 random(seed + 0x9E3779B97F4A7C15ULL * (worker + 1));
+    auto below = [&random](size_t bound) {
+        return static_cast<size_t>(std::uniform_int_distribution<std::uint64_t>(0, bound - 1)(random));
+    };
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    size_t count = candidates_.size();
+    std::vector<char> used(count, 0);
+    auto durationOf = [this](std::uint32_t song) { return candidates_[song].durationSeconds; };
+
+    // Start from a random set that fills the slot without going over
+    std::vector<std::uint32_t> middle;
+    {
+        std::vector<std::uint32_t> shuffled = free_;
+        std::shuffle(shuffled.begin(), shuffled.end(), random);
+        int total = evaluate(middle).totalSeconds;
+        bool empty = openers_.empty() && closers_.empty();
+        for (std::uint32_t song : shuffled) {
+            int added = durationOf(song) + (empty ? 0 : options_.paddingSeconds);
+            if (total + added <= options_.targetSeconds + options_.toleranceSeconds) {
+                middle.push_back(song);
+                used[song] = 1;
+                total += added;
+                empty = false;
+            }
+        }
+    }
+    Score current = evaluate(middle);
+    offer(middle, current);
+    std::int64_t localBest = current.cost;
+    std::uint64_t sinceLocalBest = 0;
+
+    // An unused free song, near wantedSeconds when it is given
+    auto pickUnused = [&](int wantedSeconds, bool nearLength) -> std::uint32_t {
+        if (free_.empty()) {
+            return kNoSong;
+        }
+        if (nearLength) {
+            auto at = std::lower_bound(byDuration_.begin(), byDuration_.end(), wantedSeconds,
+                                       [this](std::uint32_t song, int seconds) {
+                                           return candidates_[song].durationSeconds < seconds;
+                                       });
+            size_t base = static_cast<size_t>(at - byDuration_.begin());
+            for (int attempt = 0; attempt < 16; ++attempt) {
+                // Walk outwards from the closest lengths: base, base - 1, base + 1, ...
+                std::ptrdiff_t offset = attempt % 2 == 0 ? attempt / 2 : -(attempt + 1) / 2;
+                std::ptrdiff_t index = static_cast<std::ptrdiff_t>(base) + offset;
+                if (index >= 0 && index < static_cast<std::ptrdiff_t>(byDuration_.size()) && !used[byDuration_[index]]) {
+                    return byDuration_[index];
+                }
+            }
+            return kNoSong;
+        }
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            std::uint32_t song = free_[below(free_.size())];
+            if (!used[song]) {
+                return song;
+            }
+        }
+        return kNoSong;
+    };
+
+    double startTemperature = 0.5 + 0.5 * (options_.instrumentChangeWeight + options_.keyRepeatWeight);
+    double budgetMs = static_cast<double>(options_.timeBudget.count());
+    double temperature = startTemperature;
+    std::vector<std::uint32_t> candidate;
+    std::uint64_t moves = 0;
+
+    while (!free_.empty()) {
+        if ((++moves & 255) == 0) {
+            moves_ += 256;
+            double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+            if (cancelRequested_ || solved_ || elapsed >= budgetMs) {
+                break;
+            }
+            temperature = startTemperature * (1.0 - elapsed / budgetMs) + 0.05;
+
+            // Stalled: carry on from the best set any thread has found
+            if (sinceLocalBest > kStallMoves) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                middle = bestMiddle_;
+                std::fill(used.begin(), used.end(), 0);
+                for (std::uint32_t song : middle) {
+                    used[song] = 1;
+                }
+                sinceLocalBest = 0;
+                current = evaluate(middle);
+                localBest = std::min(localBest, current.cost);
+            }
+        }
+
+        candidate = middle;
+        std::uint32_t in = kNoSong;
+        std::uint32_t out = kNoSong;
+        size_t size = candidate.size();
+        int missing = options_.targetSeconds - current.totalSeconds;
+
+        switch (below(kMoveKinds)) {
+        case 0:  // Add any song
+            in = pickUnused(0, false);
+            if (in != kNoSong) {
+                candidate.insert(candidate.begin() + below(size + 1), in);
+            }
+            break;
+        case 1:  // Add a song that fills the gap
+            in = pickUnused(missing - options_.paddingSeconds, true);
+            if (in != kNoSong) {
+                candidate.insert(candidate.begin() + below(size + 1), in);
+            }
+            break;
+        case 2:  // Drop a song
+            if (size > 0) {
+                size_t at = below(size);
+                out = candidate[at];
+                candidate.erase(candidate.begin() + at);
+            }
+            break;
+        case 3:  // Swap in any song
+            if (size > 0 && (in = pickUnused(0, false)) != kNoSong) {
+                size_t at = below(size);
+                out = candidate[at];
+                candidate[at] = in;
+            }
+            break;
+        case 4:  // Swap in a song that corrects the length
+            if (size > 0) {
+                size_t at = below(size);
+                in = pickUnused(durationOf(candidate[at]) + missing, true);
+                if (in != kNoSong) {
+                    out = candidate[at];
+                    candidate[at] = in;
+                }
+            }
+            break;
+        case 5:  // Swap two songs
+            if (size >= 2) {
+                std::swap(candidate[below(size)], candidate[below(size)]);
+            }
+            break;
+        case 6:  // Move a song
+            if (size >= 2) {
+                size_t from = below(size);
+                std::uint32_t song = candidate[from];
+                candidate.erase(candidate.begin() + from);
+                candidate.insert(candidate.begin() + below(size), song);
+            }
+            break;
+        default:  // Reverse a run
+            if (size >= 2) {
+                size_t first = below(size);
+                size_t last = below(size);
+                if (first > last) {
+                    std::swap(first, last);
+                }
+                std::reverse(candidate.begin() + first, candidate.begin() + last + 1);
+            }
+            break;
+        }
+
+        Score score = evaluate(candidate);
+        std::int64_t delta = score.cost - current.cost;
+        ++sinceLocalBest;
+        if (delta <= 0 || unit(random) < std::exp(-static_cast<double>(delta) / temperature)) {
+            middle.swap(candidate);
+            current = score;
+            if (in != kNoSong) {
+                used[in] = 1;
+            }
+            if (out != kNoSong) {
+                used[out] = 0;
+            }
+            if (current.cost < localBest) {
+                localBest = current.cost;
+                sinceLocalBest = 0;
+                offer(middle, current);
+            }
+        }
+    }
+    moves_ += moves & 255;
+}
+
+} // namespace setlistgui
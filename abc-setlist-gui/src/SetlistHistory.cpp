@@ -0,0 +1,68 @@
+#include "SetlistHistory.h"
+
+namespace setlistgui {
+
+SetlistHistory::SetlistHistory(size_t budgetBytes)
+    : budgetBytes_(budgetBytes) {
+}
+
+void SetlistHistory::push(SetlistSnapshot before) {
+    for (const auto& snapshot : redo_) {
+        bytes_ -= snapshot.bytes;
+    }
+    redo_.clear();
+
+    bytes_ += before.bytes;
+    undo_.push_back(std::move(before));
+    trim();
+}
+
+bool SetlistHistory::undo(SetlistSnapshot current, SetlistSnapshot& restored) {
+    if (undo_.empty()) {
+        return false;
+    }
+
+    bytes_ -= undo_.back().bytes;
+    restored = std::move(undo_.back());
+    undo_.pop_back();
+
+    bytes_ += current.bytes;
+    redo_.push_back(std::move(current));
+    return true;
+}
+
+bool SetlistHistory::redo(SetlistSnapshot current, SetlistSnapshot& restored) {
+    if (redo_.empty()) {
+        return false;
+    }
+
+    bytes_ -= redo_.back().bytes;
+    restored = std::move(redo_.back());
+    redo_.pop_back();
+
+    bytes_ += current.bytes;
+    undo_.push_back(std::move(current));
+    trim();
+    return true;
+}
+
+void SetlistHistory::setBudget(size_t budgetBytes) {
+    budgetBytes_ = budgetBytes;
+    trim();
+}
+
+void SetlistHistory::clear() {
+    undo_.clear();
+    redo_.clear();
+    bytes_ = 0;
+}
+
+void SetlistHistory::trim() {
+    // Always keep the newest undo step, even if it alone is over budget
+    while (bytes_ > budgetBytes_ && undo_.size() > 1) {
+        bytes_ -= undo_.front().bytes;
+        undo_.pop_front();
+    }
+}
+
+} // namespace setlistgui
@@ -1,270 +1,1193 @@
 #include "SetlistManager.h"
-#include <fstream>
-#include <sstream>
-#include <regex>
+#include "ContentHash.h"
+#include "ContentStore.h"
+#include "ImportJob.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "SessionFile.h"
+#include "SetlistHistory.h"
+#include "Tunebook.h"
 #include <algorithm>
 #include <filesystem>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace setlistgui {
 
-SetlistManager::SetlistManager() {
+namespace {
+
+// Cache key: the same file reached through different relative paths or
+// symlinks shares one entry
+std::string cacheKeyFor(const std::string& filepath) {
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(filepath, ec);
+    return ec ? filepath : canonical.string();
+}
+
+// Approximate heap footprint of a recorded song, excluding its shared source
+size_t approximateBytes(const SongState& state) {
+    size_t bytes = sizeof(SongState) + state.card.title.capacity() + state.card.filename.capacity() +
+                   state.card.instruments.capacity() * sizeof(InstrumentId) +
+                   state.details.titleLines.capacity() * sizeof(TitleLine);
+    for (const auto& titleLine : state.details.titleLines) {
+        bytes += titleLine.fullTitle.capacity();
+    }
+    return bytes;
+}
+
+size_t sourceBytes(const SongDetails& details) {
+    const SongSource& source = *details.source;
+    size_t bytes = sizeof(SongSource) + source.originalFilePath.capacity() + source.originalTitle.capacity() +
+                   source.bookReference.capacity() + source.embeddedPath.capacity() +
+                   source.titleTexts.capacity() * sizeof(std::string);
+    for (const auto& text : source.titleTexts) {
+        bytes += text.capacity();
+    }
+    return bytes;
+}
+
+// Identity of the content a song was loaded from, and the original T: line
+// texts, which are all the song keeps of it
+void recordContent(std::string_view content, std::uint64_t hash, LoadedSong& song) {
+    song.source.contentSize = content.size();
+    song.source.contentHash = hash;
+    song.source.titleTexts.clear();
+    song.source.titleTexts.reserve(song.details.titleLines.size());
+    for (const auto& titleLine : song.details.titleLines) {
+        song.source.titleTexts.emplace_back(content.substr(titleLine.textOffset, titleLine.textLength));
+    }
+}
+
+// A cache entry's line positions must fit the file they are applied to
+bool cachedLinesFit(const SongMetadata& metadata, size_t contentSize) {
+    for (const auto& cached : metadata.titleLines) {
+        if (cached.lineOffset + cached.lineLength > contentSize ||
+            cached.textOffset + cached.textLength > contentSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Which reloaded song replaces a song's source: the file's only song, or
+// for a tune from a tunebook the tune with the same X: value (preferring the
+// same position). SIZE_MAX if there is none.
+size_t findReloaded(const SongSource& current, const std::vector<LoadedSong>& songs) {
+    if (!current.bookTune) {
+        return (songs.size() == 1 && !songs[0].source.bookTune) ? 0 : SIZE_MAX;
+    }
+    size_t match = SIZE_MAX;
+    for (size_t i = 0; i < songs.size(); ++i) {
+        const SongSource& candidate = songs[i].source;
+        if (candidate.bookTune && candidate.bookReference == current.bookReference) {
+            if (candidate.bookIndex == current.bookIndex) {
+                return i;
+            }
+            if (match == SIZE_MAX) {
+                match = i;
+            }
+        }
+    }
+    return match;
+}
+
+} // namespace
+
+SetlistManager::SetlistManager()
+    : history_(std::make_unique<SetlistHistory>()), contents_(std::make_unique<ContentStore>()) {
     parser_ = std::make_shared<showtimecalc::services::AbcParser>();
-    repository_ = std::make_shared<showtimecalc::infrastructure::FileAbcRepository>();
+}
+
+SetlistManager::~SetlistManager() = default;
+
+std::string_view SongDetails::originalTitleLine(size_t index) const {
+    return source->titleTexts[index];
+}
+
+std::string_view SongDetails::titleLineText(size_t index) const {
+    const auto& titleLine = titleLines[index];
+    return titleLine.titleEdited ? std::string_view(titleLine.fullTitle) : originalTitleLine(index);
 }
 
 bool SetlistManager::addSongFromFile(const std::string& filepath) {
+    ProfileScope probe("addSongFromFile");
+    std::vector<LoadedSong> songs;
+    std::string error;
+    if (!loadSongCard(*parser_, cache_.get(), nullptr, filepath, songs, error) ||
+        hashIndex().count(songs[0].source.contentHash)) {
+        return false;
+    }
+
+    recordUndoStep();
+    appendSong(std::move(songs[0]));
+    return true;
+}
+
+ImportReport SetlistManager::addSongsFromFiles(const std::vector<std::string>& filepaths) {
+    auto job = startImport(filepaths);
+    return finishImport(*job);
+}
+
+std::unique_ptr<ImportJob> SetlistManager::startImport(std::vector<std::string> filepaths) const {
+    return startLoading(std::move(filepaths), true, splitTunebooks_, {}, knownContent());
+}
+
+std::unique_ptr<ImportJob> SetlistManager::startLoading(std::vector<std::string> filepaths, bool expandFolders,
+                                                        bool splitAll, std::unordered_set<std::string> tunebooks,
+                                                        std::shared_ptr<const KnownContent> known) const {
+    // AbcParser holds no per-call state and the cache is thread-safe, so
+    // the workers share both
+    auto parser = parser_;
+    auto cache = cache_;
+    auto loader = [parser, cache, splitAll, tunebooks = std::move(tunebooks)](
+                      const std::string& path, DuplicateCheck& duplicates, std::vector<LoadedSong>& songs,
+                      std::string& error) {
+        if (splitAll || tunebooks.count(path)) {
+            return loadTunebook(*parser, &duplicates, path, songs, error);
+        }
+        return loadSongCard(*parser, cache.get(), &duplicates, path, songs, error);
+    };
+    return std::make_unique<ImportJob>(std::move(filepaths), std::move(loader), expandFolders, std::move(known));
+}
+
+ImportReport SetlistManager::finishImport(ImportJob& job) {
+    ProfileScope probe("finishImport");
+    job.wait();
+
+    ImportReport report;
+    report.requested = job.total();
+    report.cancelled = job.isCancelled();
+
+    // The workers only checked against the setlist as it was when the job
+    // started; songs added since then are caught here
+    auto& index = hashIndex();
+    auto describe = [](const SongSource& source) {
+        return source.bookTune ? source.originalFilePath + " X:" + source.bookReference : source.originalFilePath;
+    };
+    auto duplicateOf = [&](std::uint64_t hash) {
+        auto existing = index.find(hash);
+        return existing == index.end() ? std::string() : describe(*getDetails(existing->second).source);
+    };
+
+    // The whole batch is one undo step
+    for (const auto& result : job.results_) {
+        bool adds = std::any_of(result.songs.begin(), result.songs.end(), [&](const LoadedSong& song) {
+            return !index.count(song.source.contentHash);
+        });
+        if (result.loaded && adds) {
+            recordUndoStep();
+            break;
+        }
+    }
+
+    // Merge in the order the files were given, regardless of which
+    // worker finished first
+    for (size_t i = 0; i < job.results_.size(); ++i) {
+        auto& result = job.results_[i];
+        if (result.loaded) {
+            for (auto& song : result.songs) {
+                const SongSource& source = song.source;
+                if (index.count(source.contentHash)) {
+                    report.duplicates.push_back({describe(source), duplicateOf(source.contentHash), source.contentHash});
+                    continue;
+                }
+                appendSong(std::move(song));
+                ++report.added;
+            }
+
+            // After the songs: a tunebook can repeat one of its own tunes
+            for (auto& duplicate : result.duplicates) {
+                if (duplicate.duplicateOf.empty()) {
+                    duplicate.duplicateOf = duplicateOf(duplicate.hash);
+                }
+                report.duplicates.push_back(std::move(duplicate));
+            }
+        } else if (result.attempted) {
+            report.failures.push_back({job.paths_[i], result.error});
+        } else {
+            ++report.skipped;
+        }
+    }
+    job.results_.clear();
+
+    return report;
+}
+
+bool SetlistManager::loadSongCard(const showtimecalc::services::AbcParser& parser, MetadataCache* cache,
+                                  DuplicateCheck* duplicates, const std::string& filepath,
+                                  std::vector<LoadedSong>& songs, std::string& error) {
+    ProfileScope probe("loadSong");
     try {
-        // Check if file exists
-        if (!std::filesystem::exists(filepath)) {
+        // Re-adding a file the setlist already has, unchanged, needs no read
+        FileStamp stamp;
+        std::uint64_t hash = 0;
+        if (duplicates && statFileStamp(filepath, stamp) && duplicates->isKnownFile(filepath, stamp, hash)) {
+            duplicates->skip(filepath, hash);
+            return true;
+        }
+
+        // Map (or, for small files, read) the file; a missing file fails here
+        MappedFile file;
+        if (!file.open(filepath, error)) {
             return false;
         }
 
-        // Read file content
-        std::string content = repository_->readFile(filepath);
+        // A known file with the same size and mtime skips hashing, scanning
+        // and parsing
+        std::string cacheKey;
+        SongMetadata metadata;
+        bool cached = false;
+        if (cache) {
+            cacheKey = cacheKeyFor(filepath);
+            cached = cache->lookup(cacheKey, file.stamp(), file.view(), metadata) &&
+                     cachedLinesFit(metadata, file.view().size()) && metadata.contentHash != 0;
+        }
+        hash = cached ? metadata.contentHash : contentHash(file.view());
+        if (duplicates && !duplicates->claim(hash)) {
+            duplicates->skip(filepath, hash);
+            return true;
+        }
 
-        // Get filename without path
-        std::string filename = std::filesystem::path(filepath).filename().string();
+        songs.emplace_back();
+        LoadedSong& song = songs.back();
+        SongCard& card = song.card;
+        card.filename = std::filesystem::path(filepath).filename().string();
+        card.titleEdited = false;
+        song.source.originalFilePath = filepath;
+        song.source.stamp = file.stamp();
 
-        // Parse the ABC file
-        auto abcSong = parser_->parse(filename, content);
+        if (cached) {
+            applyMetadata(metadata, song);
+            recordContent(file.view(), hash, song);
+            return true;
+        }
 
-        if (!abcSong || !abcSong->isValid()) {
+        // AbcParser takes a std::string; the same string becomes the song's
+        // content, so the bytes are copied at most once
+        if (!parseSongContent(parser, file.takeContents(), hash, song, error)) {
+            songs.pop_back();
             return false;
         }
 
-        // Extract all title lines with instruments
-        std::vector<TitleLine> titleLines = extractTitleLines(content);
+        if (cache) {
+            cache->store(cacheKey, file.stamp(), makeMetadata(song));
+        }
+        return true;
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    } catch (...) {
+        error = "Unknown error";
+        return false;
+    }
+}
 
-        // Extract instruments for display
-        std::vector<std::string> instruments = extractInstruments(content);
+bool SetlistManager::loadTunebook(const showtimecalc::services::AbcParser& parser, DuplicateCheck* duplicates,
+                                  const std::string& filepath, std::vector<LoadedSong>& songs, std::string& error) {
+    ProfileScope probe("loadTunebook");
+    try {
+        FileStamp stamp;
+        size_t skipped = 0;
+        std::unordered_set<std::string> filenames;  // A repeated X: value gets the tune's position
+        bool read = TunebookReader::read(filepath, [&](BookTune& tune) {
+            std::uint64_t hash = contentHash(tune.content);
+            if (duplicates && !duplicates->claim(hash)) {
+                duplicates->skip(filepath + " X:" + tune.reference, hash);
+                ++skipped;
+                return true;
+            }
 
-        // Create song card
-        SongCard card;
-        card.filename = filename;
-        card.originalFilePath = filepath;
-        card.originalContent = content;
-        card.title = abcSong->getTitle();
-        card.originalTitle = abcSong->getTitle();
-        card.titleLines = titleLines;
-        card.durationSeconds = abcSong->getDurationSeconds();
-        card.instruments = instruments;
-        card.order = static_cast<int>(songs_.size());
-        card.titleEdited = false;
+            LoadedSong song;
+            song.card.filename = bookTuneFilename(filepath, tune);
+            if (!filenames.insert(song.card.filename).second) {
+                song.card.filename = bookTuneFilename(filepath, tune, true);
+                filenames.insert(song.card.filename);
+            }
+            song.card.titleEdited = false;
+            song.source.originalFilePath = filepath;
+            song.source.bookTune = true;
+            song.source.bookIndex = tune.index;
+            song.source.bookOffset = tune.offset;
+            song.source.bookReference = tune.reference;
 
-        songs_.push_back(card);
+            // A tune that doesn't parse is left out; the rest of the book still loads
+            std::string tuneError;
+            if (parseSongContent(parser, std::move(tune.content), hash, song, tuneError)) {
+                songs.push_back(std::move(song));
+            }
+            return true;
+        }, stamp, error);
+        if (!read) {
+            return false;
+        }
+        if (songs.empty() && skipped == 0) {
+            error = "No valid X: tunes in the tunebook";
+            return false;
+        }
+        for (auto& song : songs) {
+            song.source.stamp = stamp;
+        }
         return true;
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
     } catch (...) {
+        error = "Unknown error";
+        return false;
+    }
+}
+
+bool SetlistManager::parseSongContent(const showtimecalc::services::AbcParser& parser, std::string content,
+                                      std::uint64_t hash, LoadedSong& song, std::string& error) {
+    // Collect title lines and instruments straight from the bytes
+    AbcHeaderScan scan;
+    AbcHeaderScanner::scan(content, scan);
+    makeTitleLines(scan, content, song);
+    song.instruments = makeInstruments(scan);
+    song.source.key = scan.keys.empty() ? std::string() : std::string(scan.keys.front());
+
+    auto abcSong = parser.parse(song.card.filename, content);
+    if (!abcSong || !abcSong->isValid()) {
+        error = "Not a valid ABC tune";
+        return false;
+    }
+
+    // Fill song card
+    song.card.title = abcSong->getTitle();
+    song.card.durationSeconds = abcSong->getDurationSeconds();
+    song.source.originalTitle = song.card.title;
+    recordContent(content, hash, song);
+    return true;
+}
+
+void SetlistManager::appendSong(LoadedSong song) {
+    SongCard& card = song.card;
+    card.partCount = static_cast<std::uint16_t>(song.details.titleLines.size());
+
+    card.instruments.clear();
+    card.instruments.reserve(song.instruments.size());
+    for (const auto& instrument : song.instruments) {
+        card.instruments.push_back(instruments_.intern(instrument));
+    }
+    for (size_t i = 0; i < song.details.titleLines.size(); ++i) {
+        song.details.titleLines[i].instrument = instruments_.intern(song.partInstruments[i]);
+    }
+
+    auto id = static_cast<SongId>(slots_.size());
+    slots_.push_back(static_cast<std::uint32_t>(songs_.size()));
+    slotIds_.push_back(id);
+    songs_.push_back(std::move(card));
+    recorded_.push_back(nullptr);
+    recordedSongs_ = nullptr;
+    song.details.source = std::make_shared<const SongSource>(std::move(song.source));
+    details_.push_back(std::move(song.details));
+    order_.push_back(id);
+    durations_.push_back(songs_.back().durationSeconds);
+    if (hashIndexRevision_ == sourceRevision_) {
+        songsByHash_.emplace(details_.back().source->contentHash, id);
+        ++hashIndexRevision_;
+    }
+    ++sourceRevision_;
+}
+
+const std::unordered_map<std::uint64_t, SongId>& SetlistManager::hashIndex() {
+    if (hashIndexRevision_ != sourceRevision_) {
+        songsByHash_.clear();
+        songsByHash_.reserve(order_.size());
+        for (SongId id : order_) {
+            songsByHash_.emplace(getDetails(id).source->contentHash, id);
+        }
+        hashIndexRevision_ = sourceRevision_;
+    }
+    return songsByHash_;
+}
+
+std::shared_ptr<const KnownContent> SetlistManager::knownContent() const {
+    auto known = std::make_shared<KnownContent>();
+    known->hashes.reserve(details_.size());
+    for (const auto& details : details_) {
+        const SongSource& source = *details.source;
+        known->hashes.insert(source.contentHash);
+        if (!source.bookTune) {
+            known->files.emplace(source.originalFilePath, std::make_pair(source.stamp, source.contentHash));
+        }
+    }
+    return known;
+}
+
+std::unique_ptr<ImportJob> SetlistManager::startReload(std::vector<std::string> filepaths) const {
+    // Books that tunes were split from are split again
+    std::unordered_set<std::string> tunebooks;
+    for (const auto& details : details_) {
+        if (details.source->bookTune) {
+            tunebooks.insert(details.source->originalFilePath);
+        }
+    }
+    return startLoading(std::move(filepaths), false, false, std::move(tunebooks), nullptr);
+}
+
+ReloadReport SetlistManager::finishReload(ImportJob& job) {
+    ProfileScope probe("finishReload");
+    job.wait();
+
+    // A file can be in the setlist more than once
+    std::unordered_map<std::string, std::vector<std::uint32_t>> slotsByPath;
+    for (std::uint32_t slot = 0; slot < details_.size(); ++slot) {
+        slotsByPath[details_[slot].source->originalFilePath].push_back(slot);
+    }
+
+    ReloadReport report;
+    for (size_t i = 0; i < job.results_.size(); ++i) {
+        auto& result = job.results_[i];
+        auto it = slotsByPath.find(job.paths_[i]);
+        if (!result.attempted || it == slotsByPath.end()) {
+            continue;  // Cancelled, or the song was removed meanwhile
+        }
+
+        if (!result.loaded) {
+            report.failures.push_back({job.paths_[i], result.error});
+            for (std::uint32_t slot : it->second) {
+                songs_[slot].sourceState = SourceState::ReloadFailed;
+                recorded_[slot] = nullptr;
+            }
+            recordedSongs_ = nullptr;
+            continue;
+        }
+
+        // Match every slot first: preparing a song moves its source out,
+        // and findReloaded compares against the sources
+        std::vector<size_t> matches;
+        matches.reserve(it->second.size());
+        for (std::uint32_t slot : it->second) {
+            matches.push_back(findReloaded(*details_[slot].source, result.songs));
+        }
+
+        // Intern and share each loaded song once, when a slot first uses it
+        std::vector<std::shared_ptr<const SongSource>> sources(result.songs.size());
+        std::vector<std::vector<InstrumentId>> partInstruments(result.songs.size());
+        auto prepare = [&](size_t index) {
+            if (sources[index]) {
+                return;
+            }
+            LoadedSong& loaded = result.songs[index];
+            partInstruments[index].reserve(loaded.partInstruments.size());
+            for (const auto& instrument : loaded.partInstruments) {
+                partInstruments[index].push_back(instruments_.intern(instrument));
+            }
+            sources[index] = std::make_shared<const SongSource>(std::move(loaded.source));
+        };
+
+        for (size_t k = 0; k < it->second.size(); ++k) {
+            std::uint32_t slot = it->second[k];
+            const SongSource& current = *details_[slot].source;
+            size_t match = matches[k];
+            if (match == SIZE_MAX) {
+                if (current.bookTune) {
+                    // The tune was deleted from the book (or no longer parses)
+                    report.failures.push_back(
+                        {job.paths_[i], "X:" + current.bookReference + " is no longer in the tunebook"});
+                    songs_[slot].sourceState = SourceState::ReloadFailed;
+                    recorded_[slot] = nullptr;
+                    recordedSongs_ = nullptr;
+                }
+                continue;
+            }
+            prepare(match);
+            const auto& source = sources[match];
+
+            if (current.contentHash == source->contentHash && current.contentSize == source->contentSize) {
+                // Touched but not changed: just remember the new stamp (and
+                // where the tune now is in its book)
+                if (current.stamp != source->stamp || current.bookIndex != source->bookIndex ||
+                    current.bookOffset != source->bookOffset) {
+                    SongSource updated = current;
+                    updated.stamp = source->stamp;
+                    updated.bookIndex = source->bookIndex;
+                    updated.bookOffset = source->bookOffset;
+                    details_[slot].source = std::make_shared<const SongSource>(std::move(updated));
+                }
+                if (songs_[slot].sourceState == SourceState::ReloadFailed) {
+                    songs_[slot].sourceState = SourceState::Current;
+                }
+                recorded_[slot] = nullptr;
+                recordedSongs_ = nullptr;
+                continue;
+            }
+            applyReload(slot, result.songs[match], source, partInstruments[match]);
+            ++report.reloaded;
+        }
+    }
+    job.results_.clear();
+
+    if (report.reloaded > 0) {
+        rebuildDurations();
+        ++sourceRevision_;
+    }
+    return report;
+}
+
+void SetlistManager::applyReload(std::uint32_t slot, const LoadedSong& loaded,
+                                 const std::shared_ptr<const SongSource>& source,
+                                 const std::vector<InstrumentId>& partInstruments) {
+    SongCard& card = songs_[slot];
+    SongDetails& details = details_[slot];
+
+    SongDetails reloaded;
+    reloaded.source = source;
+    reloaded.titleLines = loaded.details.titleLines;
+    for (size_t i = 0; i < reloaded.titleLines.size(); ++i) {
+        reloaded.titleLines[i].instrument = partInstruments[i];
+    }
+
+    // An edited T: line stays edited at the same index; edits to lines the
+    // file no longer has are dropped
+    bool anyLineEdited = false;
+    size_t keptLines = std::min(details.titleLines.size(), reloaded.titleLines.size());
+    for (size_t i = 0; i < keptLines; ++i) {
+        const TitleLine& previous = details.titleLines[i];
+        if (!previous.titleEdited) {
+            continue;
+        }
+        TitleLine& titleLine = reloaded.titleLines[i];
+        titleLine.titleEdited = (previous.fullTitle != reloaded.originalTitleLine(i));
+        if (titleLine.titleEdited) {
+            titleLine.fullTitle = previous.fullTitle;
+            titleLine.instrument = previous.instrument;
+            anyLineEdited = true;
+        }
+    }
+    details = std::move(reloaded);
+
+    if (card.titleEdited) {
+        card.titleEdited = (card.title != source->originalTitle);
+    } else {
+        card.title = source->originalTitle;
+    }
+    card.durationSeconds = loaded.card.durationSeconds;
+    card.partCount = static_cast<std::uint16_t>(details.titleLines.size());
+    if (anyLineEdited) {
+        refreshInstruments(slot);
+    } else {
+        card.instruments.clear();
+        for (const auto& instrument : loaded.instruments) {
+            card.instruments.push_back(instruments_.intern(instrument));
+        }
+    }
+    card.sourceState = SourceState::Reloaded;
+
+    recorded_[slot] = nullptr;
+    recordedSongs_ = nullptr;
+}
+
+std::vector<std::string> SetlistManager::getSourcePaths() const {
+    std::unordered_set<std::string_view> seen;
+    std::vector<std::string> paths;
+    for (const auto& details : details_) {
+        if (seen.insert(details.source->originalFilePath).second) {
+            paths.push_back(details.source->originalFilePath);
+        }
+    }
+    return paths;
+}
+
+std::vector<std::string> SetlistManager::findStaleSources() const {
+    std::unordered_set<std::string_view> seen;
+    std::vector<std::string> stale;
+    for (const auto& details : details_) {
+        const SongSource& source = *details.source;
+        FileStamp stamp;
+        if (seen.insert(source.originalFilePath).second &&
+            (!statFileStamp(source.originalFilePath, stamp) || stamp != source.stamp)) {
+            stale.push_back(source.originalFilePath);
+        }
+    }
+    return stale;
+}
+
+bool SetlistManager::positionOf(SongId id, size_t& position) const {
+    auto it = std::find(order_.begin(), order_.end(), id);
+    if (it == order_.end()) {
         return false;
     }
+    position = static_cast<size_t>(it - order_.begin());
+    return true;
+}
+
+void SetlistManager::removeSong(SongId id) {
+    ProfileScope probe("removeSong");
+    size_t position;
+    if (!positionOf(id, position)) {
+        return;
+    }
+    std::uint32_t slot = slots_[id];
+    recordUndoStep(sourceBytes(details_[slot]));
+    order_.erase(order_.begin() + position);
+    eraseSlot(slot);
+
+    rebuildDurations();
+    ++sourceRevision_;
+}
+
+void SetlistManager::eraseSlot(std::uint32_t slot) {
+    // Fill the freed slot with the last one so storage stays dense
+    SongId id = slotIds_[slot];
+    auto last = static_cast<std::uint32_t>(songs_.size() - 1);
+    if (slot != last) {
+        songs_[slot] = std::move(songs_[last]);
+        details_[slot] = std::move(details_[last]);
+        recorded_[slot] = std::move(recorded_[last]);
+        slotIds_[slot] = slotIds_[last];
+        slots_[slotIds_[slot]] = slot;
+    }
+    songs_.pop_back();
+    details_.pop_back();
+    recorded_.pop_back();
+    recordedSongs_ = nullptr;
+    slotIds_.pop_back();
+    slots_[id] = kNoSlot;
+}
+
+std::unique_ptr<SetBuilderJob> SetlistManager::startSetBuilder(SetBuilderOptions options) const {
+    std::vector<SetCandidate> candidates;
+    candidates.reserve(order_.size());
+    for (SongId id : order_) {
+        const SongCard& card = getSong(id);
+        SetCandidate candidate;
+        candidate.id = id;
+        candidate.durationSeconds = card.durationSeconds;
+        candidate.instruments = card.instruments;
+        candidate.key = getDetails(id).source->key;
+        candidates.push_back(std::move(candidate));
+    }
+    return std::make_unique<SetBuilderJob>(std::move(candidates), std::move(options));
 }
 
-void SetlistManager::removeSong(size_t index) {
-    if (index < songs_.size()) {
-        songs_.erase(songs_.begin() + index);
+void SetlistManager::applySetOrder(const std::vector<SongId>& order) {
+    ProfileScope probe("applySetOrder");
+    std::vector<SongId> newOrder;
+    std::vector<char> keep(slots_.size(), 0);
+    for (SongId id : order) {
+        if (contains(id) && !keep[id]) {
+            keep[id] = 1;
+            newOrder.push_back(id);
+        }
+    }
+    if (newOrder == order_) {
+        return;
+    }
+
+    size_t retainedBytes = 0;
+    for (SongId id : order_) {
+        if (!keep[id]) {
+            retainedBytes += sourceBytes(getDetails(id));
+        }
+    }
+    recordUndoStep(retainedBytes);
 
-        // Update order values
-        for (size_t i = 0; i < songs_.size(); ++i) {
-            songs_[i].order = static_cast<int>(i);
+    // Erase from the back so slots still to be visited are never the ones moved
+    for (auto slot = static_cast<std::uint32_t>(songs_.size()); slot-- > 0;) {
+        if (!keep[slotIds_[slot]]) {
+            eraseSlot(slot);
         }
     }
+    order_ = std::move(newOrder);
+    rebuildDurations();
+    ++sourceRevision_;
+}
+
+void SetlistManager::moveSong(SongId id, size_t newPosition) {
+    size_t position;
+    if (positionOf(id, position)) {
+        reorderSong(position, newPosition);
+    }
 }
 
 void SetlistManager::reorderSong(size_t oldIndex, size_t newIndex) {
-    if (oldIndex >= songs_.size() || newIndex >= songs_.size() || oldIndex == newIndex) {
+    ProfileScope probe("reorderSong");
+    if (oldIndex >= order_.size() || newIndex >= order_.size() || oldIndex == newIndex) {
         return;
     }
+    recordUndoStep();
 
-    auto song = songs_[oldIndex];
-    songs_.erase(songs_.begin() + oldIndex);
-    songs_.insert(songs_.begin() + newIndex, song);
+    // Shift the ids in between by one; cards and content stay where they are
+    auto first = order_.begin();
+    if (oldIndex < newIndex) {
+        std::rotate(first + oldIndex, first + oldIndex + 1, first + newIndex + 1);
+    } else {
+        std::rotate(first + newIndex, first + oldIndex, first + oldIndex + 1);
+    }
 
-    // Update order values
-    for (size_t i = 0; i < songs_.size(); ++i) {
-        songs_[i].order = static_cast<int>(i);
+    // Only positions inside the rotated range changed; rebuild instead when
+    // the range is long enough that point updates would cost more
+    size_t low = std::min(oldIndex, newIndex);
+    size_t high = std::max(oldIndex, newIndex);
+    size_t span = high - low + 1;
+    size_t logSize = 1;
+    while ((size_t{1} << logSize) < order_.size()) {
+        ++logSize;
+    }
+    if (span * logSize > order_.size()) {
+        rebuildDurations();
+    } else {
+        for (size_t position = low; position <= high; ++position) {
+            durations_.set(position, getSong(order_[position]).durationSeconds);
+        }
     }
 }
 
-void SetlistManager::updateSongTitle(size_t index, const std::string& newTitle) {
-    if (index < songs_.size()) {
-        songs_[index].title = newTitle;
-        songs_[index].titleEdited = (newTitle != songs_[index].originalTitle);
+void SetlistManager::updateSongTitle(SongId id, const std::string& newTitle) {
+    ProfileScope probe("updateSongTitle");
+    if (contains(id) && songs_[slots_[id]].title != newTitle) {
+        std::uint32_t slot = slots_[id];
+        recordUndoStep();
+        recorded_[slot] = nullptr;
+        recordedSongs_ = nullptr;
+        songs_[slot].title = newTitle;
+        songs_[slot].titleEdited = (newTitle != details_[slot].source->originalTitle);
     }
 }
 
-void SetlistManager::updateTitleLine(size_t songIndex, size_t titleLineIndex, const std::string& newFullTitle) {
-    if (songIndex < songs_.size() && titleLineIndex < songs_[songIndex].titleLines.size()) {
-        auto& titleLine = songs_[songIndex].titleLines[titleLineIndex];
-        titleLine.fullTitle = newFullTitle;
-        titleLine.titleEdited = (newFullTitle != titleLine.originalFullTitle);
+void SetlistManager::updateTitleLine(SongId id, size_t titleLineIndex, const std::string& newFullTitle) {
+    ProfileScope probe("updateTitleLine");
+    if (contains(id) && titleLineIndex < details_[slots_[id]].titleLines.size() &&
+        details_[slots_[id]].titleLineText(titleLineIndex) != newFullTitle) {
+        std::uint32_t slot = slots_[id];
+        recordUndoStep();
+        recorded_[slot] = nullptr;
+        recordedSongs_ = nullptr;
+        auto& details = details_[slot];
+        auto& titleLine = details.titleLines[titleLineIndex];
+        titleLine.titleEdited = (newFullTitle != details.originalTitleLine(titleLineIndex));
+        titleLine.fullTitle = titleLine.titleEdited ? newFullTitle : std::string();
 
         // Re-extract instrument from updated title
-        std::regex instrumentRegex(R"(\[(.*?)\])");
-        std::smatch match;
-        if (std::regex_search(newFullTitle, match, instrumentRegex)) {
-            std::string potential = match[1].str();
-            if (!potential.empty() && potential.find(':') == std::string::npos) {
-                titleLine.instrument = potential;
-            } else {
-                titleLine.instrument = "";
+        titleLine.instrument = instruments_.intern(AbcHeaderScanner::bracketInstrument(newFullTitle));
+
+        // Update the instruments display list
+        refreshInstruments(slot);
+    }
+}
+
+void SetlistManager::refreshInstruments(size_t slot) {
+    auto& instruments = songs_[slot].instruments;
+    instruments.clear();
+    for (const auto& tl : details_[slot].titleLines) {
+        if (tl.instrument != InstrumentPool::kNone) {
+            instruments.push_back(tl.instrument);
+        }
+    }
+}
+
+void SetlistManager::clear() {
+    ProfileScope probe("clear");
+    if (!order_.empty()) {
+        recordAndClear();
+    }
+}
+
+void SetlistManager::recordAndClear() {
+    // Everything removed is kept alive by this one undo step
+    size_t retainedBytes = 0;
+    for (const auto& details : details_) {
+        retainedBytes += sourceBytes(details);
+    }
+    recordUndoStep(retainedBytes);
+
+    songs_.clear();
+    details_.clear();
+    recorded_.clear();
+    recordedSongs_ = nullptr;
+    slotIds_.clear();
+    order_.clear();
+    durations_.clear();
+
+    // Ids are never reused, so stale ids held by the UI stay invalid
+    std::fill(slots_.begin(), slots_.end(), kNoSlot);
+    ++sourceRevision_;
+}
+
+bool SetlistManager::saveSession(const std::string& path, const SessionSettings& settings, bool embedContent,
+                                 std::string& error) {
+    ProfileScope probe("saveSession");
+    std::vector<SessionSong> songs(order_.size());
+    for (size_t position = 0; position < order_.size(); ++position) {
+        songs[position].card = &getSong(order_[position]);
+        songs[position].details = &getDetails(order_[position]);
+    }
+    if (embedContent) {
+        std::vector<std::string> errors(songs.size());
+        parallelFor(songs.size(), [&](size_t i) {
+            fetchContent(*songs[i].details->source, songs[i].content, errors[i]);
+        });
+        for (size_t i = 0; i < songs.size(); ++i) {
+            if (!songs[i].content) {
+                error = errors[i];
+                return false;
             }
-        } else {
-            titleLine.instrument = "";
         }
+    }
 
-        // Update the instruments display list
-        songs_[songIndex].instruments.clear();
-        for (const auto& tl : songs_[songIndex].titleLines) {
-            if (!tl.instrument.empty()) {
-                songs_[songIndex].instruments.push_back(tl.instrument);
+    SessionSettings saved = settings;
+    saved.splitTunebooks = splitTunebooks_;
+    std::vector<std::uint64_t> contentOffsets;
+    if (!writeSessionFile(path, saved, songs, instruments_, contentOffsets, error)) {
+        return false;
+    }
+
+    // Songs now find their embedded copy at its new place in the file, and
+    // copies the rewritten file no longer has are forgotten
+    for (size_t position = 0; position < order_.size(); ++position) {
+        std::uint32_t slot = slots_[order_[position]];
+        const SongSource& source = *details_[slot].source;
+        if (!embedContent && source.embeddedPath != path) {
+            continue;
+        }
+        auto rebound = std::make_shared<SongSource>(source);
+        rebound->embeddedPath = embedContent ? path : std::string();
+        rebound->embeddedOffset = embedContent ? contentOffsets[position] : 0;
+        details_[slot].source = std::move(rebound);
+        recorded_[slot] = nullptr;
+        recordedSongs_ = nullptr;
+    }
+    return true;
+}
+
+bool SetlistManager::loadSession(const std::string& path, SessionSettings& settings, std::string& error) {
+    ProfileScope probe("loadSession");
+    std::vector<LoadedSong> songs;
+    if (!readSessionFile(path, settings, songs, error)) {
+        return false;
+    }
+
+    // One undo step even when the setlist is empty (the usual case at
+    // start-up); it also brings back the tunebook mode
+    recordAndClear();
+    splitTunebooks_ = settings.splitTunebooks;
+    for (auto& song : songs) {
+        appendSong(std::move(song));
+    }
+    return true;
+}
+
+std::unique_ptr<SourceCheckJob> SetlistManager::startSourceCheck() const {
+    std::vector<SourceCheck> checks;
+    std::unordered_map<std::string_view, size_t> byPath;
+    for (const auto& details : details_) {
+        const SongSource& source = *details.source;
+        auto [it, added] = byPath.emplace(source.originalFilePath, checks.size());
+        if (added) {
+            checks.push_back({source.originalFilePath, source.stamp, {}});
+        }
+        checks[it->second].ranges.push_back(
+            {source.bookOffset, source.contentSize, source.contentHash, !source.bookTune});
+    }
+    return std::make_unique<SourceCheckJob>(std::move(checks));
+}
+
+std::vector<std::string> SetlistManager::finishSourceCheck(SourceCheckJob& job) {
+    ProfileScope probe("finishSourceCheck");
+    std::unordered_map<std::string_view, const SourceStatus*> touched;
+    std::vector<std::string> changed;
+    for (const auto& status : job.results()) {
+        if (status.result == SourceStatus::Result::Touched) {
+            touched.emplace(status.path, &status);
+        } else if (status.result != SourceStatus::Result::Unchanged) {
+            changed.push_back(status.path);
+        }
+    }
+
+    // Same bytes under a new mtime: adopt the stamp, so the file isn't
+    // taken for changed later. Not an undo step, like a reload.
+    for (std::uint32_t slot = 0; slot < details_.size() && !touched.empty(); ++slot) {
+        const SongSource& source = *details_[slot].source;
+        auto it = touched.find(source.originalFilePath);
+        if (it == touched.end() || source.stamp != it->second->recorded) {
+            continue;
+        }
+        auto restamped = std::make_shared<SongSource>(source);
+        restamped->stamp = it->second->current;
+        details_[slot].source = std::move(restamped);
+        recorded_[slot] = nullptr;
+        recordedSongs_ = nullptr;
+    }
+    return changed;
+}
+
+bool SetlistManager::canUndo() const {
+    return history_->canUndo();
+}
+
+bool SetlistManager::canRedo() const {
+    return history_->canRedo();
+}
+
+bool SetlistManager::undo() {
+    ProfileScope probe("undo");
+    SetlistSnapshot restored;
+    if (!history_->undo(captureSnapshot(), restored)) {
+        return false;
+    }
+    restoreSnapshot(restored);
+    return true;
+}
+
+bool SetlistManager::redo() {
+    ProfileScope probe("redo");
+    SetlistSnapshot restored;
+    if (!history_->redo(captureSnapshot(), restored)) {
+        return false;
+    }
+    restoreSnapshot(restored);
+    return true;
+}
+
+void SetlistManager::setHistoryBudget(size_t budgetBytes) {
+    history_->setBudget(budgetBytes);
+}
+
+void SetlistManager::recordUndoStep(size_t retainedBytes) {
+    SetlistSnapshot snapshot = captureSnapshot();
+    snapshot.bytes += retainedBytes;
+    history_->push(std::move(snapshot));
+}
+
+SetlistSnapshot SetlistManager::captureSnapshot() {
+    SetlistSnapshot snapshot;
+    snapshot.order = order_;
+    snapshot.splitTunebooks = splitTunebooks_;
+    snapshot.bytes = sizeof(SetlistSnapshot) + order_.size() * sizeof(SongId);
+
+    // Songs unchanged since the last snapshot reuse their recorded state;
+    // only edited or newly added ones are copied (content is never copied).
+    // If nothing changed at all, the whole song list is reused.
+    if (!recordedSongs_) {
+        auto songs = std::make_shared<RecordedSongs>();
+        songs->reserve(songs_.size());
+        snapshot.bytes += songs_.size() * sizeof(std::shared_ptr<const SongState>);
+        for (size_t slot = 0; slot < songs_.size(); ++slot) {
+            auto& recorded = recorded_[slot];
+            if (!recorded) {
+                recorded = std::make_shared<const SongState>(SongState{slotIds_[slot], songs_[slot], details_[slot]});
+                snapshot.bytes += approximateBytes(*recorded);
             }
+            songs->push_back(recorded);
         }
+        recordedSongs_ = std::move(songs);
     }
+    snapshot.songs = recordedSongs_;
+
+    return snapshot;
 }
 
-showtimecalc::domain::Duration SetlistManager::getTotalDuration(int paddingSeconds, int introSeconds) const {
-    int totalSeconds = introSeconds;
+void SetlistManager::restoreSnapshot(const SetlistSnapshot& snapshot) {
+    songs_.clear();
+    details_.clear();
+    recorded_.clear();
+    slotIds_.clear();
+    std::fill(slots_.begin(), slots_.end(), kNoSlot);
+
+    const RecordedSongs& states = *snapshot.songs;
+    songs_.reserve(states.size());
+    details_.reserve(states.size());
+    for (const auto& state : states) {
+        slots_[state->id] = static_cast<std::uint32_t>(songs_.size());
+        slotIds_.push_back(state->id);
+        songs_.push_back(state->card);
+        details_.push_back(state->details);
+        recorded_.push_back(state);
+    }
+    recordedSongs_ = snapshot.songs;
+    order_ = snapshot.order;
+    splitTunebooks_ = snapshot.splitTunebooks;
+    rebuildDurations();
+    ++sourceRevision_;
+}
 
-    for (const auto& song : songs_) {
-        totalSeconds += song.durationSeconds;
+void SetlistManager::rebuildDurations() {
+    std::vector<int> values;
+    values.reserve(order_.size());
+    for (SongId id : order_) {
+        values.push_back(getSong(id).durationSeconds);
     }
+    durations_.assign(values);
+}
+
+showtimecalc::domain::Duration SetlistManager::getTotalDuration(int paddingSeconds, int introSeconds) const {
+    int totalSeconds = introSeconds + static_cast<int>(durations_.total());
 
     // Add padding between songs (N-1 gaps for N songs)
-    if (songs_.size() > 1) {
-        totalSeconds += paddingSeconds * (static_cast<int>(songs_.size()) - 1);
+    if (order_.size() > 1) {
+        totalSeconds += paddingSeconds * (static_cast<int>(order_.size()) - 1);
     }
 
     return showtimecalc::domain::Duration(totalSeconds);
 }
 
-bool SetlistManager::exportToFolder(const std::string& folderPath, bool addNumbering) const {
-    try {
-        // Create the folder if it doesn't exist
-        if (!std::filesystem::exists(folderPath)) {
-            std::filesystem::create_directories(folderPath);
-        }
+SongCue SetlistManager::getCue(size_t position, int paddingSeconds, int introSeconds) const {
+    SongCue cue;
+    if (position >= durations_.size()) {
+        return cue;
+    }
 
-        // Copy each file to the destination folder
-        for (size_t i = 0; i < songs_.size(); ++i) {
-            const auto& song = songs_[i];
+    // Intro, every earlier song, and one gap after each of them
+    cue.startSeconds = introSeconds + static_cast<int>(durations_.prefixSum(position)) +
+                       paddingSeconds * static_cast<int>(position);
+    cue.endSeconds = cue.startSeconds + durations_.valueAt(position);
+    return cue;
+}
 
-            // Create new filename with optional order prefix
-            std::string newFilename;
-            if (addNumbering) {
-                std::string orderPrefix = std::to_string(i + 1);
-                if (orderPrefix.length() == 1) {
-                    orderPrefix = "0" + orderPrefix;  // Pad with zero: 01, 02, etc.
-                }
-                newFilename = orderPrefix + "_" + song.filename;
-            } else {
-                newFilename = song.filename;
+ExportReport SetlistManager::exportToFolder(const std::string& folderPath, bool addNumbering, bool sync) const {
+    ProfileScope probe("exportToFolder");
+    std::vector<ExportItem> items = makeExportItems(addNumbering);
+    return sync ? ExportEngine::sync(folderPath, items) : ExportEngine::run(folderPath, items);
+}
+
+ExportReport SetlistManager::exportToArchive(const std::string& archivePath, bool addNumbering) const {
+    ProfileScope probe("exportToArchive");
+    ArchiveFormat format;
+    if (!archiveFormatFor(archivePath, format)) {
+        ExportReport report;
+        report.error = "The archive name must end in .zip or .tar";
+        return report;
+    }
+    return ExportEngine::archive(archivePath, format, makeExportItems(addNumbering));
+}
+
+std::vector<ExportItem> SetlistManager::makeExportItems(bool addNumbering) const {
+    std::vector<ExportItem> items;
+    items.reserve(order_.size());
+
+    for (size_t i = 0; i < order_.size(); ++i) {
+        const auto& song = getSong(order_[i]);
+        const auto& details = getDetails(order_[i]);
+        ExportItem item;
+
+        // Create new filename with optional order prefix
+        if (addNumbering) {
+            std::string orderPrefix = std::to_string(i + 1);
+            if (orderPrefix.length() == 1) {
+                orderPrefix = "0" + orderPrefix;  // Pad with zero: 01, 02, etc.
             }
-            std::string destPath = folderPath + "/" + newFilename;
-
-            // Check if any edits were made
-            bool hasEdits = song.titleEdited;
-            for (const auto& titleLine : song.titleLines) {
-                if (titleLine.titleEdited) {
-                    hasEdits = true;
-                    break;
-                }
+            item.filename = orderPrefix + "_" + song.filename;
+        } else {
+            item.filename = song.filename;
+        }
+
+        // Check if any edits were made
+        bool hasEdits = song.titleEdited;
+        for (const auto& titleLine : details.titleLines) {
+            if (titleLine.titleEdited) {
+                hasEdits = true;
+                break;
             }
+        }
 
-            if (hasEdits) {
-                // Apply edits to content
-                std::string modifiedContent = song.originalContent;
-
-                // Replace T: lines with updated instrument names
-                std::istringstream stream(song.originalContent);
-                std::ostringstream output;
-                std::string line;
-                size_t titleLineIndex = 0;
-                std::regex titleRegex(R"(^T:\s*(.+))");
-
-                while (std::getline(stream, line)) {
-                    std::smatch match;
-                    if (std::regex_search(line, match, titleRegex) && titleLineIndex < song.titleLines.size()) {
-                        const auto& titleLine = song.titleLines[titleLineIndex];
-
-                        if (titleLine.titleEdited) {
-                            // Replace entire T: line with edited full title
-                            output << "T:" << titleLine.fullTitle << "\n";
-                        } else if (titleLineIndex == 0 && song.titleEdited) {
-                            // Replace first title if main title was edited
-                            output << "T:" << song.title << "\n";
-                        } else {
-                            output << line << "\n";
-                        }
-
-                        titleLineIndex++;
-                    } else {
-                        output << line << "\n";
-                    }
+        // Export exactly what the setlist holds: content is read back from
+        // the source and must still hash to what was loaded, so a file that
+        // changed without a reload fails the export instead of slipping in
+        if (hasEdits) {
+            // Apply edits to content (on an export worker)
+            item.render = [this, &song, &details](std::string& content, std::string& error) {
+                std::shared_ptr<const std::string> original;
+                if (!fetchContent(*details.source, original, error)) {
+                    return false;
                 }
-
-                // Write modified content
-                std::ofstream outFile(destPath);
-                if (!outFile.is_open()) {
+                content = renderEditedContent(song, details, *original);
+                return true;
+            };
+        } else if (details.source->bookTune || !details.source->embeddedPath.empty()) {
+            // A tune from a tunebook is written on its own, not the whole
+            // book; a song with a session copy may have to come from there
+            item.outputKnown = true;
+            item.outputSize = details.source->contentSize;
+            item.outputHash = details.source->contentHash;
+            item.render = [this, &details](std::string& content, std::string& error) {
+                std::shared_ptr<const std::string> original;
+                if (!fetchContent(*details.source, original, error)) {
                     return false;
                 }
-                outFile << output.str();
-                outFile.close();
-            } else {
-                // Just copy the original file
-                std::filesystem::copy_file(song.originalFilePath, destPath,
-                                          std::filesystem::copy_options::overwrite_existing);
-            }
+                content = *original;
+                return true;
+            };
+        } else {
+            // Just copy the original file (the copy is verified)
+            item.sourcePath = details.source->originalFilePath;
+            item.verifySource = true;
+            item.sourceSize = details.source->contentSize;
+            item.sourceHash = details.source->contentHash;
+            item.outputKnown = true;
+            item.outputSize = item.sourceSize;
+            item.outputHash = item.sourceHash;
         }
 
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
+bool SetlistManager::fetchContent(const SongSource& source, std::shared_ptr<const std::string>& content,
+                                  std::string& error) const {
+    if (contents_->fetch(source.originalFilePath, source.bookOffset, source.contentSize, !source.bookTune,
+                         source.contentHash, content, error)) {
         return true;
-    } catch (const std::exception& e) {
+    }
+    // The source file changed or is gone: fall back to a session's copy
+    std::string embeddedError;
+    if (source.embeddedPath.empty() ||
+        !contents_->fetch(source.embeddedPath, source.embeddedOffset, source.contentSize, false,
+                          source.contentHash, content, embeddedError)) {
         return false;
     }
+    error.clear();
+    return true;
 }
 
-std::vector<std::string> SetlistManager::extractInstruments(const std::string& content) {
-    std::vector<std::string> instruments;
-    std::istringstream stream(content);
-    std::string line;
-
-    // Regex to match T: lines which often contain instrument names in brackets
-    std::regex titleRegex(R"(^T:\s*(.+))");
-    // Regex to extract text in brackets/parentheses that might be instrument names
-    std::regex instrumentRegex(R"(\[(.*?)\]|\((.*?)\))");
-
-    while (std::getline(stream, line)) {
-        std::smatch match;
-        if (std::regex_search(line, match, titleRegex)) {
-            std::string title = match[1].str();
-
-            // Look for instrument names in brackets
-            std::sregex_iterator iter(title.begin(), title.end(), instrumentRegex);
-            std::sregex_iterator end;
-
-            for (; iter != end; ++iter) {
-                std::string potential = (*iter)[1].str();
-                if (potential.empty()) {
-                    potential = (*iter)[2].str();
-                }
+std::string SetlistManager::renderEditedContent(const SongCard& card, const SongDetails& details,
+                                                const std::string& content) {
+    // Replacement text for a T: line, or nullptr to keep the original bytes
+    auto replacementFor = [&card, &details](size_t index) -> const std::string* {
+        const auto& titleLine = details.titleLines[index];
+        if (titleLine.titleEdited) {
+            return &titleLine.fullTitle;  // Edited full title line
+        }
+        if (index == 0 && card.titleEdited) {
+            return &card.title;  // Main title was edited
+        }
+        return nullptr;
+    };
 
-                // Filter out time signatures (like "4:22") and keep instrument names
-                if (!potential.empty() && potential.find(':') == std::string::npos) {
-                    // Check if not already in list
-                    if (std::find(instruments.begin(), instruments.end(), potential) == instruments.end()) {
-                        instruments.push_back(potential);
-                    }
-                }
-            }
+    // Size the output once, then splice the edited lines in using the
+    // positions recorded at import; everything else is copied byte for byte
+    size_t outputSize = content.size();
+    for (size_t i = 0; i < details.titleLines.size(); ++i) {
+        if (const std::string* replacement = replacementFor(i)) {
+            outputSize = outputSize - details.titleLines[i].lineLength + 2 + replacement->size();
         }
+    }
 
-        // Also check %%part-name directive
-        std::regex partNameRegex(R"(^%%part-name\s+(.+))");
-        if (std::regex_search(line, match, partNameRegex)) {
-            std::string partName = match[1].str();
-            if (std::find(instruments.begin(), instruments.end(), partName) == instruments.end()) {
-                instruments.push_back(partName);
-            }
+    std::string output;
+    output.reserve(outputSize);
+    size_t copied = 0;
+    for (size_t i = 0; i < details.titleLines.size(); ++i) {
+        const std::string* replacement = replacementFor(i);
+        if (!replacement) {
+            continue;
         }
+        const auto& titleLine = details.titleLines[i];
+        output.append(content, copied, titleLine.lineOffset - copied);
+        output += "T:";
+        output += *replacement;
+        copied = titleLine.lineOffset + titleLine.lineLength;
     }
+    output.append(content, copied, std::string::npos);
+
+    return output;
+}
+
+std::vector<std::string> SetlistManager::makeInstruments(const AbcHeaderScan& scan) {
+    std::vector<std::string> instruments(scan.instruments.begin(), scan.instruments.end());
 
     // If no instruments found, add "Unknown"
     if (instruments.empty()) {
@@ -274,43 +1197,73 @@ std::vector<std::string> SetlistManager::extractInstruments(const std::string& c
     return instruments;
 }
 
-std::vector<TitleLine> SetlistManager::extractTitleLines(const std::string& content) {
-    std::vector<TitleLine> titleLines;
-    std::istringstream stream(content);
-    std::string line;
+void SetlistManager::makeTitleLines(const AbcHeaderScan& scan, std::string_view content, LoadedSong& song) {
+    auto& titleLines = song.details.titleLines;
+    titleLines.clear();
+    titleLines.reserve(scan.titles.size());
+    song.partInstruments.clear();
+    song.partInstruments.reserve(scan.titles.size());
 
-    // Regex to match T: lines
-    std::regex titleRegex(R"(^T:\s*(.+))");
-    // Regex to extract text in brackets that might be instrument names
-    std::regex instrumentRegex(R"(\[(.*?)\])");
+    for (const auto& title : scan.titles) {
+        TitleLine titleLine;
+        titleLine.instrument = InstrumentPool::kNone;
+        titleLine.titleEdited = false;
+        titleLine.lineOffset = title.lineOffset;
+        titleLine.lineLength = title.lineLength;
+        titleLine.textOffset = static_cast<size_t>(title.text.data() - content.data());
+        titleLine.textLength = title.text.size();
+        titleLines.push_back(std::move(titleLine));
+        song.partInstruments.emplace_back(title.instrument);
+    }
+}
 
-    while (std::getline(stream, line)) {
-        std::smatch match;
-        if (std::regex_search(line, match, titleRegex)) {
-            std::string titleContent = match[1].str();
+SongMetadata SetlistManager::makeMetadata(const LoadedSong& song) {
+    const SongDetails& details = song.details;
+    SongMetadata metadata;
+    metadata.title = song.source.originalTitle;
+    metadata.durationSeconds = song.card.durationSeconds;
+    metadata.instruments = song.instruments;
+    metadata.key = song.source.key;
+    metadata.contentHash = song.source.contentHash;
 
-            TitleLine titleLine;
-            titleLine.fullTitle = titleContent;
-            titleLine.originalFullTitle = titleContent;
-            titleLine.instrument = "";
-            titleLine.titleEdited = false;
+    metadata.titleLines.reserve(details.titleLines.size());
+    for (size_t i = 0; i < details.titleLines.size(); ++i) {
+        const auto& titleLine = details.titleLines[i];
+        CachedTitleLine cached;
+        cached.instrument = song.partInstruments[i];
+        cached.lineOffset = titleLine.lineOffset;
+        cached.lineLength = titleLine.lineLength;
+        cached.textOffset = titleLine.textOffset;
+        cached.textLength = titleLine.textLength;
+        metadata.titleLines.push_back(std::move(cached));
+    }
 
-            // Look for instrument name in brackets
-            std::smatch instMatch;
-            if (std::regex_search(titleContent, instMatch, instrumentRegex)) {
-                std::string potential = instMatch[1].str();
+    return metadata;
+}
 
-                // Filter out time signatures (like "4:22") and keep instrument names
-                if (!potential.empty() && potential.find(':') == std::string::npos) {
-                    titleLine.instrument = potential;
-                }
-            }
+void SetlistManager::applyMetadata(const SongMetadata& metadata, LoadedSong& song) {
+    song.card.title = metadata.title;
+    song.card.durationSeconds = metadata.durationSeconds;
+    song.source.originalTitle = metadata.title;
+    song.source.key = metadata.key;
+    song.instruments = metadata.instruments;
 
-            titleLines.push_back(titleLine);
-        }
+    auto& titleLines = song.details.titleLines;
+    titleLines.clear();
+    titleLines.reserve(metadata.titleLines.size());
+    song.partInstruments.clear();
+    song.partInstruments.reserve(metadata.titleLines.size());
+    for (const auto& cached : metadata.titleLines) {
+        TitleLine titleLine;
+        titleLine.instrument = InstrumentPool::kNone;
+        titleLine.titleEdited = false;
+        titleLine.lineOffset = static_cast<size_t>(cached.lineOffset);
+        titleLine.lineLength = static_cast<size_t>(cached.lineLength);
+        titleLine.textOffset = static_cast<size_t>(cached.textOffset);
+        titleLine.textLength = static_cast<size_t>(cached.textLength);
+        titleLines.push_back(std::move(titleLine));
+        song.partInstruments.push_back(cached.instrument);
     }
-
-    return titleLines;
 }
 
 } // namespace setlistgui
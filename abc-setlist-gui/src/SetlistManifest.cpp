@@ -0,0 +1,120 @@
+#include "SetlistManifest.h"
+#include "ArchiveWriter.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+std::string trim(const std::string& text) {
+    const char* whitespace = " \t\r";
+    size_t first = text.find_first_not_of(whitespace);
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = text.find_last_not_of(whitespace);
+    return text.substr(first, last - first + 1);
+}
+
+bool parseSeconds(const std::string& value, int& seconds) {
+    try {
+        size_t used = 0;
+        int parsed = std::stoi(value, &used);
+        if (used != value.size() || parsed < 0) {
+            return false;
+        }
+        seconds = parsed;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parseBool(const std::string& value, bool& result) {
+    if (value == "true" || value == "yes" || value == "on" || value == "1") {
+        result = true;
+        return true;
+    }
+    if (value == "false" || value == "no" || value == "off" || value == "0") {
+        result = false;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool readManifest(const std::string& path, SetlistManifest& manifest, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Cannot open manifest: " + path;
+        return false;
+    }
+
+    manifest = SetlistManifest();
+    manifest.path = path;
+    fs::path base = fs::path(path).parent_path();
+    auto resolve = [&base](const std::string& value) {
+        fs::path resolved(value);
+        return resolved.is_absolute() ? resolved.string() : (base / resolved).lexically_normal().string();
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        bool valid = true;
+        if (key == "song") {
+            manifest.songs.push_back({resolve(value), std::string()});
+        } else if (key == "title") {
+            valid = !manifest.songs.empty();
+            if (valid) {
+                manifest.songs.back().title = value;
+            }
+        } else if (key == "output") {
+            manifest.outputFolder = resolve(value);
+        } else if (key == "archive") {
+            ArchiveFormat format;
+            valid = archiveFormatFor(value, format);
+            if (valid) {
+                manifest.archivePath = resolve(value);
+            }
+        } else if (key == "padding") {
+            valid = parseSeconds(value, manifest.paddingSeconds);
+        } else if (key == "intro") {
+            valid = parseSeconds(value, manifest.introSeconds);
+        } else if (key == "numbering") {
+            valid = parseBool(value, manifest.addNumbering);
+        } else if (key == "sync") {
+            valid = parseBool(value, manifest.sync);
+        } else {
+            error = path + ":" + std::to_string(lineNumber) + ": unknown key '" + key + "'";
+            return false;
+        }
+
+        if (!valid) {
+            error = path + ":" + std::to_string(lineNumber) + ": invalid value for '" + key + "'";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace setlistgui
@@ -0,0 +1,428 @@
+#include "TuneLibrary.h"
+#include "AbcHeaderScanner.h"
+#include "FolderWalk.h"
+#include "MappedFile.h"
+#include "MetadataCache.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace setlistgui {
+
+namespace {
+
+char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string trimmed(std::string_view text) {
+    size_t start = 0;
+    size_t end = text.size();
+    while (start < end && isSpace(text[start])) {
+        ++start;
+    }
+    while (end > start && isSpace(text[end - 1])) {
+        --end;
+    }
+    return std::string(text.substr(start, end - start));
+}
+
+void appendTrimmed(const std::vector<std::string_view>& values, std::vector<std::string>& out) {
+    for (auto value : values) {
+        std::string text = trimmed(value);
+        if (!text.empty()) {
+            out.push_back(std::move(text));
+        }
+    }
+}
+
+// A search term and the field it is limited to (kFieldCount: any field)
+struct QueryTerm {
+    std::string text;
+    int field;
+};
+
+} // namespace
+
+bool scanLibraryTune(const std::string& path, LibraryTune& tune, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    AbcHeaderScan scan;
+    AbcHeaderScanner::scan(file.view(), scan);
+
+    tune.path = path;
+    tune.filename = fs::path(path).filename().string();
+    tune.stamp = file.stamp();
+    tune.title = scan.titles.empty() ? std::string() : trimmed(scan.titles.front().text);
+    if (tune.title.empty()) {
+        tune.title = fs::path(path).stem().string();
+    }
+    tune.instruments.clear();
+    tune.composers.clear();
+    tune.keys.clear();
+    appendTrimmed(scan.instruments, tune.instruments);
+    appendTrimmed(scan.composers, tune.composers);
+    appendTrimmed(scan.keys, tune.keys);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// TuneIndex
+
+void TuneIndex::fillText(Entry& entry) {
+    const LibraryTune& tune = entry.tune;
+    std::string& text = entry.text;
+    text.clear();
+
+    auto appendField = [&](Field field, const auto& values) {
+        for (const auto& value : values) {
+            if (!text.empty() && text.back() != '\n') {
+                text += '\t';
+            }
+            text += value;
+        }
+        entry.fieldEnd[field] = static_cast<std::uint32_t>(text.size());
+        text += '\n';
+    };
+
+    text += tune.title;
+    entry.fieldEnd[kTitle] = static_cast<std::uint32_t>(text.size());
+    text += '\n';
+    appendField(kInstruments, tune.instruments);
+    appendField(kComposers, tune.composers);
+    appendField(kKeys, tune.keys);
+    text += tune.filename;
+    entry.fieldEnd[kFilename] = static_cast<std::uint32_t>(text.size());
+
+    std::transform(text.begin(), text.end(), text.begin(), toLowerAscii);
+}
+
+void TuneIndex::collectTrigrams(std::string_view text, std::vector<std::uint32_t>& trigrams) {
+    trigrams.clear();
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        trigrams.push_back(static_cast<std::uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+                           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+                           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+    // Grouped by shard so a shard's trigrams are one contiguous run
+    std::sort(trigrams.begin(), trigrams.end(), [](std::uint32_t a, std::uint32_t b) {
+        size_t shardA = shardOf(a);
+        size_t shardB = shardOf(b);
+        return shardA != shardB ? shardA < shardB : a < b;
+    });
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+size_t TuneIndex::shardOf(std::uint32_t trigram) {
+    return static_cast<size_t>((trigram * 0x9E3779B1u) >> 28) % kShards;
+}
+
+void TuneIndex::index(std::uint32_t id, const std::vector<std::uint32_t>& trigrams) {
+    for (std::uint32_t trigram : trigrams) {
+        shards_[shardOf(trigram)][trigram].push_back(id);
+    }
+}
+
+void TuneIndex::assign(std::vector<LibraryTune> tunes) {
+    ProfileScope probe("buildLibraryIndex");
+    entries_.clear();
+    byPath_.clear();
+    for (auto& shard : shards_) {
+        shard.clear();
+    }
+    dead_ = 0;
+
+    entries_.resize(tunes.size());
+    std::vector<std::vector<std::uint32_t>> trigrams(tunes.size());
+    parallelFor(tunes.size(), [&](size_t i) {
+        entries_[i].tune = std::move(tunes[i]);
+        fillText(entries_[i]);
+        collectTrigrams(entries_[i].text, trigrams[i]);
+    });
+
+    // Each shard owns its own trigrams, so shards are filled concurrently;
+    // ids are visited in order, which keeps every posting list sorted
+    parallelFor(kShards, [&](size_t shard) {
+        Postings& postings = shards_[shard];
+        for (size_t id = 0; id < trigrams.size(); ++id) {
+            const auto& list = trigrams[id];
+            auto first = std::lower_bound(list.begin(), list.end(), shard, [](std::uint32_t trigram, size_t s) {
+                return shardOf(trigram) < s;
+            });
+            for (auto it = first; it != list.end() && shardOf(*it) == shard; ++it) {
+                postings[*it].push_back(static_cast<std::uint32_t>(id));
+            }
+        }
+    });
+
+    byPath_.reserve(entries_.size());
+    for (size_t id = 0; id < entries_.size(); ++id) {
+        auto inserted = byPath_.emplace(entries_[id].tune.path, static_cast<std::uint32_t>(id));
+        if (!inserted.second) {
+            entries_[inserted.first->second].alive = false;  // Same file twice: keep the later one
+            inserted.first->second = static_cast<std::uint32_t>(id);
+            ++dead_;
+        }
+    }
+}
+
+void TuneIndex::update(LibraryTune tune) {
+    remove(tune.path);
+
+    auto id = static_cast<std::uint32_t>(entries_.size());
+    entries_.emplace_back();
+    Entry& entry = entries_.back();
+    entry.tune = std::move(tune);
+    fillText(entry);
+
+    std::vector<std::uint32_t> trigrams;
+    collectTrigrams(entry.text, trigrams);
+    index(id, trigrams);
+    byPath_[entry.tune.path] = id;
+}
+
+bool TuneIndex::remove(const std::string& path) {
+    auto it = byPath_.find(path);
+    if (it == byPath_.end()) {
+        return false;
+    }
+    entries_[it->second].alive = false;
+    byPath_.erase(it);
+    ++dead_;
+
+    // Tombstones only cost memory and query time; rebuild once they dominate
+    if (dead_ > 1024 && dead_ * 2 > entries_.size()) {
+        assign(tunes());
+    }
+    return true;
+}
+
+std::vector<LibraryTune> TuneIndex::tunes() const {
+    std::vector<LibraryTune> live;
+    live.reserve(byPath_.size());
+    for (const auto& entry : entries_) {
+        if (entry.alive) {
+            live.push_back(entry.tune);
+        }
+    }
+    return live;
+}
+
+LibrarySearchResult TuneIndex::search(std::string_view query, size_t limit) const {
+    // Split into lowercased terms, each optionally limited to one field
+    std::vector<QueryTerm> terms;
+    size_t pos = 0;
+    while (pos < query.size()) {
+        while (pos < query.size() && isSpace(query[pos])) {
+            ++pos;
+        }
+        size_t end = pos;
+        while (end < query.size() && !isSpace(query[end])) {
+            ++end;
+        }
+        if (end == pos) {
+            break;
+        }
+        std::string text(query.substr(pos, end - pos));
+        std::transform(text.begin(), text.end(), text.begin(), toLowerAscii);
+        pos = end;
+
+        int field = kFieldCount;
+        if (text.size() > 2 && text[1] == ':') {
+            switch (text[0]) {
+            case 't': field = kTitle; break;
+            case 'i': field = kInstruments; break;
+            case 'c': field = kComposers; break;
+            case 'k': field = kKeys; break;
+            default: break;
+            }
+            if (field != kFieldCount) {
+                text.erase(0, 2);
+            }
+        }
+        terms.push_back({std::move(text), field});
+    }
+
+    // Posting lists of every trigram in the terms; the tunes containing
+    // all of them are the candidates
+    std::vector<const std::vector<std::uint32_t>*> lists;
+    std::vector<std::uint32_t> trigrams;
+    for (const auto& term : terms) {
+        collectTrigrams(term.text, trigrams);
+        for (std::uint32_t trigram : trigrams) {
+            const Postings& shard = shards_[shardOf(trigram)];
+            auto it = shard.find(trigram);
+            if (it == shard.end()) {
+                return {};  // No tune contains this trigram
+            }
+            lists.push_back(&it->second);
+        }
+    }
+
+    std::vector<std::uint32_t> candidates;
+    bool allTunes = lists.empty();  // Only short terms: check every tune
+    if (!allTunes) {
+        std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+        candidates = *lists.front();
+        std::vector<std::uint32_t> narrowed;
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+            narrowed.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+    }
+
+    // Trigrams can match across term boundaries, so confirm each candidate
+    LibrarySearchResult result;
+    auto check = [&](std::uint32_t id) {
+        const Entry& entry = entries_[id];
+        if (!entry.alive) {
+            return;
+        }
+        std::string_view text(entry.text);
+        for (const auto& term : terms) {
+            std::string_view scope = text;
+            if (term.field != kFieldCount) {
+                size_t start = term.field == 0 ? 0 : entry.fieldEnd[term.field - 1] + 1;
+                scope = text.substr(start, entry.fieldEnd[term.field] - start);
+            }
+            if (scope.find(term.text) == std::string_view::npos) {
+                return;
+            }
+        }
+        if (result.ids.size() < limit) {
+            result.ids.push_back(id);
+        }
+        ++result.matched;
+    };
+
+    if (allTunes) {
+        for (std::uint32_t id = 0; id < entries_.size(); ++id) {
+            check(id);
+        }
+    } else {
+        for (std::uint32_t id : candidates) {
+            check(id);
+        }
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// LibraryScanJob
+
+LibraryScanJob::LibraryScanJob(std::vector<std::string> folders, std::vector<LibraryTune> known)
+    : folders_(std::move(folders)), known_(std::move(known)) {
+    thread_ = std::thread(&LibraryScanJob::run, this);
+}
+
+LibraryScanJob::~LibraryScanJob() {
+    cancel();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void LibraryScanJob::run() {
+    auto start = std::chrono::steady_clock::now();
+
+    // Every .abc file under the folders, sorted so the library order is stable
+    std::vector<std::string> paths;
+    std::mutex pathsMutex;
+    walkAbcFiles(folders_, [&](size_t, const std::string& path) {
+        std::lock_guard<std::mutex> lock(pathsMutex);
+        paths.push_back(path);
+    }, cancelRequested_);
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    total_ = paths.size();
+
+    std::unordered_map<std::string, const LibraryTune*> knownByPath;
+    for (const auto& tune : known_) {
+        knownByPath.emplace(tune.path, &tune);
+    }
+
+    std::vector<LibraryTune> tunes(paths.size());
+    std::vector<char> loaded(paths.size(), 0);
+    parallelFor(paths.size(), [&](size_t i) {
+        if (!cancelRequested_) {
+            auto known = knownByPath.find(paths[i]);
+            FileStamp stamp;
+            std::string error;
+            if (known != knownByPath.end() && statFileStamp(paths[i], stamp) && stamp == known->second->stamp) {
+                tunes[i] = *known->second;  // Unchanged since the last scan
+                loaded[i] = 1;
+            } else {
+                loaded[i] = scanLibraryTune(paths[i], tunes[i], error) ? 1 : 0;
+            }
+        }
+        ++completed_;
+    });
+
+    if (!cancelRequested_) {
+        std::vector<LibraryTune> scanned;
+        scanned.reserve(tunes.size());
+        for (size_t i = 0; i < tunes.size(); ++i) {
+            if (loaded[i]) {
+                scanned.push_back(std::move(tunes[i]));
+            } else {
+                ++failed_;
+            }
+        }
+        index_ = std::make_unique<TuneIndex>();
+        index_->assign(std::move(scanned));
+    }
+
+    elapsedMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    done_ = true;
+}
+
+// ---------------------------------------------------------------------------
+// Library folders
+
+std::string defaultLibraryFoldersPath() {
+    return (fs::path(MetadataCache::defaultPath()).parent_path() / "library-folders.txt").string();
+}
+
+std::vector<std::string> loadLibraryFolders(const std::string& path) {
+    std::vector<std::string> folders;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            folders.push_back(line);
+        }
+    }
+    return folders;
+}
+
+bool saveLibraryFolders(const std::string& path, const std::vector<std::string>& folders, std::string& error) {
+    std::string data;
+    for (const auto& folder : folders) {
+        data += folder;
+        data += '\n';
+    }
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    return writeFileDurable(path, data, error);
+}
+
+} // namespace setlistgui
@@ -0,0 +1,123 @@
+#include "Tunebook.h"
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace setlistgui {
+
+namespace {
+
+bool isFieldSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// The X: value of the line starting at lineStart
+std::string referenceAt(const std::string& buffer, size_t lineStart) {
+    size_t begin = lineStart + 2;
+    size_t end = buffer.find('\n', begin);
+    if (end == std::string::npos) {
+        end = buffer.size();
+    }
+    while (begin < end && isFieldSpace(buffer[begin])) {
+        ++begin;
+    }
+    while (end > begin && isFieldSpace(buffer[end - 1])) {
+        --end;
+    }
+    return buffer.substr(begin, end - begin);
+}
+
+} // namespace
+
+bool TunebookReader::read(const std::string& path, const TuneCallback& onTune, FileStamp& stamp, std::string& error) {
+    if (!statFileStamp(path, stamp)) {
+        error = "Cannot open file";
+        return false;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "Cannot open file";
+        return false;
+    }
+
+    // buffer holds the current tune so far followed by bytes not yet
+    // checked for tune starts; whole lines are checked as they arrive
+    std::string buffer;
+    std::uint64_t bufferOffset = 0;         // File offset of buffer[0]
+    size_t tuneStart = std::string::npos;   // Start of the current tune in buffer
+    size_t scanned = 0;                     // Checked up to here (always a line start)
+    std::uint32_t index = 0;
+    std::vector<char> chunk(kChunkSize);
+
+    auto emit = [&](size_t end) {
+        BookTune tune;
+        tune.index = index++;
+        tune.offset = bufferOffset + tuneStart;
+        tune.reference = referenceAt(buffer, tuneStart);
+        tune.content.assign(buffer, tuneStart, end - tuneStart);
+        return onTune(tune);
+    };
+
+    bool atEnd = false;
+    while (!atEnd) {
+        in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        size_t count = static_cast<size_t>(in.gcount());
+        if (in.bad()) {
+            error = "Read error";
+            return false;
+        }
+        atEnd = !in;
+        buffer.append(chunk.data(), count);
+
+        // Up to the last complete line (everything once the file is done)
+        size_t end = buffer.size();
+        if (!atEnd) {
+            size_t lastNewline = buffer.rfind('\n');
+            end = (lastNewline == std::string::npos || lastNewline < scanned) ? scanned : lastNewline + 1;
+        }
+        while (scanned < end) {
+            size_t lineStart = scanned;
+            size_t newline = buffer.find('\n', lineStart);
+            scanned = newline == std::string::npos ? buffer.size() : newline + 1;
+            if (buffer.compare(lineStart, 2, "X:") != 0) {
+                continue;
+            }
+            if (tuneStart != std::string::npos && !emit(lineStart)) {
+                return true;
+            }
+            tuneStart = lineStart;
+        }
+
+        // Drop what no tune needs any more
+        size_t keepFrom = tuneStart != std::string::npos ? tuneStart : scanned;
+        buffer.erase(0, keepFrom);
+        bufferOffset += keepFrom;
+        scanned -= keepFrom;
+        if (tuneStart != std::string::npos) {
+            tuneStart = 0;
+        }
+    }
+
+    if (tuneStart != std::string::npos) {
+        emit(buffer.size());
+    }
+    return true;
+}
+
+std::string bookTuneFilename(const std::string& bookPath, const BookTune& tune, bool withPosition) {
+    std::string reference;
+    for (char c : tune.reference) {
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_') {
+            reference += c;
+        }
+    }
+    if (reference.empty()) {
+        reference = std::to_string(tune.index + 1);
+    }
+    if (withPosition) {
+        reference += "_" + std::to_string(tune.index + 1);
+    }
+    return std::filesystem::path(bookPath).stem().string() + "_X" + reference + ".abc";
+}
+
+} // namespace setlistgui
@@ -1,11 +1,24 @@
 #include "SetlistManager.h"
+#include "ImportJob.h"
+#include "ContentStore.h"
+#include "SetlistHistory.h"
+#include "FileWatcher.h"
+#include "FolderWalk.h"
+#include "FrameStats.h"
+#include "TuneLibrary.h"
+#include "Profiler.h"
+#include "SessionFile.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
 #include <string>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <filesystem>
 
 #ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
@@ -18,29 +31,124 @@
 setlistgui::SetlistManager g_setlistManager;
 int g_paddingSeconds = 5;
 int g_introSeconds = 10;
-int g_draggedIndex = -1;
+setlistgui::SongId g_draggedSongId = setlistgui::kInvalidSongId;
 std::vector<std::string> g_droppedFiles;
 char g_editingTitle[256] = "";
-int g_editingIndex = -1;
+setlistgui::SongId g_editingSongId = setlistgui::kInvalidSongId;
 char g_exportFolderPath[512] = "";
 std::string g_exportMessage = "";
 float g_exportMessageTimer = 0.0f;
 bool g_addNumbering = true;  // Toggle for adding numbering to exported files
-int g_editingInstrumentsSongIndex = -1;  // Which song's title lines are being edited
+bool g_syncExport = false;   // Only rewrite files that changed since the last sync
+char g_archivePath[512] = "";  // .zip or .tar to export into
+setlistgui::SongId g_editingPartsSongId = setlistgui::kInvalidSongId;  // Which song's title lines are being edited
 char g_editingTitleLine[512] = "";  // Buffer for editing full title line
 int g_editingTitleLineIndex = -1;
+std::unique_ptr<setlistgui::ImportJob> g_importJob;  // Background import in progress
+setlistgui::ImportReport g_lastImportReport;          // Failures shown until dismissed
+std::string g_importMessage = "";
+float g_importMessageTimer = 0.0f;
+setlistgui::SongId g_pendingRemoveId = setlistgui::kInvalidSongId;  // Applied after the song list is drawn
+setlistgui::SongId g_pendingMoveId = setlistgui::kInvalidSongId;
+size_t g_pendingMovePosition = 0;
+bool g_showDebugOverlay = false;     // Toggled with F12
+bool g_renderContinuously = false;   // Debug: redraw every vsync like before
+bool g_recordingTrace = false;       // Profiler trace being recorded
+std::unique_ptr<setlistgui::FileWatcher> g_fileWatcher;  // Source files changed by other programs
+std::unique_ptr<setlistgui::ImportJob> g_reloadJob;      // Background reload of changed files
+std::vector<std::string> g_pendingReloads;               // Changed files waiting for the next reload
+std::uint64_t g_watchedRevision = 0;
+std::unique_ptr<setlistgui::TuneIndex> g_library;          // Searchable tune library
+std::unique_ptr<setlistgui::LibraryScanJob> g_libraryScan; // Library (re)scan in progress
+std::unique_ptr<setlistgui::FileWatcher> g_libraryWatcher; // Library files changed on disk
+std::vector<std::string> g_libraryFolders;
+std::string g_libraryFoldersPath;
+std::string g_libraryMessage = "";
+char g_libraryFolderInput[512] = "";
+char g_librarySearch[256] = "";
+setlistgui::LibrarySearchResult g_libraryResults;
+bool g_librarySearchDirty = true;
+double g_librarySearchMs = 0.0;
+std::string g_traceMessage = "";
+std::unique_ptr<setlistgui::SetBuilderJob> g_setBuilder;   // Set search in progress
+setlistgui::SetSolution g_setBuilderBest;                  // Best set of the last search
+bool g_haveSetBuilderBest = false;
+size_t g_setBuilderImprovements = 0;
+int g_setBuilderMinutes = 45;       // Target show length, intro and padding included
+int g_setBuilderTolerance = 0;      // Seconds either side of the target
+int g_setBuilderOpeners = 0;        // Keep this many songs from the top of the setlist first
+int g_setBuilderClosers = 0;        // ... and from the bottom last
+int g_setBuilderInstrumentWeight = 1;
+int g_setBuilderKeyWeight = 3;
+int g_setBuilderBudget = 3;         // Seconds to search
+std::unique_ptr<setlistgui::SourceCheckJob> g_sourceCheck;  // Opened session's source files being checked
+char g_sessionPath[512] = "";
+bool g_embedSessionContent = false;  // Store the songs' bytes in saved sessions
+
+// On-demand rendering: frames drawn after each wake-up so ImGui can settle
+// hover/focus state, and how long to sleep between checks when idle
+constexpr int kFramesAfterEvent = 3;
+constexpr double kIdleWaitSeconds = 0.5;
+
+// Bumped by everything that wakes the idle loop: GLFW input and window
+// callbacks, drops, and the background hooks that post an empty event. The
+// loop compares it before and after waiting, so an event arriving right at
+// the timeout is still handled.
+std::atomic<std::uint64_t> g_wakeEvents{0};
+
+// Wake the main loop from another thread
+void WakeMainLoop() {
+    ++g_wakeEvents;
+    glfwPostEmptyEvent();
+}
+
+// Count input and window events. Installed before ImGui's callbacks, which
+// chain to these.
+void InstallWakeCallbacks(GLFWwindow* window) {
+    glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { ++g_wakeEvents; });
+    glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { ++g_wakeEvents; });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { ++g_wakeEvents; });
+    glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { ++g_wakeEvents; });
+    glfwSetScrollCallback(window, [](GLFWwindow*, double, double) { ++g_wakeEvents; });
+    glfwSetCursorEnterCallback(window, [](GLFWwindow*, int) { ++g_wakeEvents; });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { ++g_wakeEvents; });
+    glfwSetWindowSizeCallback(window, [](GLFWwindow*, int, int) { ++g_wakeEvents; });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { ++g_wakeEvents; });
+}
 
 // GLFW drop callback
 void drop_callback(GLFWwindow* window, int count, const char** paths) {
+    ++g_wakeEvents;
     for (int i = 0; i < count; i++) {
         std::string path = paths[i];
-        // Check if it's an .abc file
-        if (path.size() >= 4 && path.substr(path.size() - 4) == ".abc") {
+        // .abc files (any case) and folders, which are searched for .abc files
+        std::error_code ec;
+        if (setlistgui::hasAbcExtension(path) || std::filesystem::is_directory(path, ec)) {
             g_droppedFiles.push_back(path);
         }
     }
 }
 
+// Undo/redo can bring back a copy of a file that has since changed on
+// disk; queue those files for a reload
+void QueueStaleReloads() {
+    for (auto& path : g_setlistManager.findStaleSources()) {
+        g_pendingReloads.push_back(std::move(path));
+    }
+}
+
+void Undo() {
+    if (g_setlistManager.undo()) {
+        QueueStaleReloads();
+    }
+}
+
+void Redo() {
+    if (g_setlistManager.redo()) {
+        QueueStaleReloads();
+    }
+}
+
 #ifdef _WIN32
 // Windows folder browser dialog
 std::string OpenFolderDialog(GLFWwindow* window) {
@@ -71,37 +179,363 @@ std::string OpenFolderDialog(GLFWwindow* window) {
 }
 #endif
 
+// Song cards all have this height, which lets the list skip the ones
+// scrolled out of view
+constexpr float kCardHeight = 120.0f;
+
+// Results shown at most in the library panel (the match count is exact)
+constexpr size_t kLibraryResultLimit = 2000;
+
+// Settings saved with a session, from the controls
+setlistgui::SessionSettings CurrentSessionSettings() {
+    setlistgui::SessionSettings settings;
+    settings.paddingSeconds = g_paddingSeconds;
+    settings.introSeconds = g_introSeconds;
+    settings.addNumbering = g_addNumbering;
+    settings.syncExport = g_syncExport;
+    settings.exportFolder = g_exportFolderPath;
+    return settings;
+}
+
+// Replace the setlist with a session. It shows at once; its source files
+// are checked in the background and changed ones reloaded.
+bool OpenSession(const std::string& path, std::string& error) {
+    setlistgui::SessionSettings settings;
+    if (!g_setlistManager.loadSession(path, settings, error)) {
+        return false;
+    }
+    g_paddingSeconds = settings.paddingSeconds;
+    g_introSeconds = settings.introSeconds;
+    g_addNumbering = settings.addNumbering;
+    g_syncExport = settings.syncExport;
+    strncpy(g_exportFolderPath, settings.exportFolder.c_str(), sizeof(g_exportFolderPath) - 1);
+    g_exportFolderPath[sizeof(g_exportFolderPath) - 1] = '\0';
+    g_sourceCheck = g_setlistManager.startSourceCheck();
+    return true;
+}
+
+// Rescan the library folders in the background, reusing unchanged tunes
+void StartLibraryScan() {
+    std::vector<setlistgui::LibraryTune> known;
+    if (g_library) {
+        known = g_library->tunes();
+    }
+    g_libraryScan = std::make_unique<setlistgui::LibraryScanJob>(g_libraryFolders, std::move(known));
+}
+
+void SaveLibraryFolders() {
+    std::string error;
+    if (!setlistgui::saveLibraryFolders(g_libraryFoldersPath, g_libraryFolders, error)) {
+        g_libraryMessage = "ERROR: " + error;
+    }
+}
+
+// Swap in a finished scan and apply single-file changes from the watcher
+void UpdateLibrary() {
+    if (g_libraryScan && g_libraryScan->isDone()) {
+        g_library = g_libraryScan->takeIndex();
+        char stats[96];
+        snprintf(stats, sizeof(stats), "Indexed %zu tunes in %.0f ms", g_library->size(), g_libraryScan->elapsedMs());
+        g_libraryMessage = stats;
+        if (g_libraryScan->failed() > 0) {
+            g_libraryMessage += " (" + std::to_string(g_libraryScan->failed()) + " unreadable)";
+        }
+        g_libraryScan.reset();
+
+        std::vector<std::string> paths;
+        for (const auto& tune : g_library->tunes()) {
+            paths.push_back(tune.path);
+        }
+        g_libraryWatcher->setPaths(paths);
+        g_librarySearchDirty = true;
+    }
+
+    if (g_library && !g_libraryScan) {
+        for (const auto& path : g_libraryWatcher->takeChanged()) {
+            setlistgui::LibraryTune tune;
+            std::string error;
+            if (setlistgui::scanLibraryTune(path, tune, error)) {
+                g_library->update(std::move(tune));
+            } else {
+                g_library->remove(path);
+            }
+            g_librarySearchDirty = true;
+        }
+    }
+}
+
+void RenderLibraryPanel(GLFWwindow* window) {
+    if (!ImGui::CollapsingHeader("Tune Library")) {
+        return;
+    }
+
+    // Library folders
+    ImGui::SetNextItemWidth(350);
+    ImGui::InputText("##libraryfolder", g_libraryFolderInput, sizeof(g_libraryFolderInput));
+    ImGui::SameLine();
+    if (ImGui::Button("Browse...##library")) {
+        std::string selectedFolder = OpenFolderDialog(window);
+        if (!selectedFolder.empty()) {
+            strncpy(g_libraryFolderInput, selectedFolder.c_str(), sizeof(g_libraryFolderInput) - 1);
+            g_libraryFolderInput[sizeof(g_libraryFolderInput) - 1] = '\0';
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Add Folder") && strlen(g_libraryFolderInput) > 0) {
+        std::string folder = g_libraryFolderInput;
+        if (std::find(g_libraryFolders.begin(), g_libraryFolders.end(), folder) == g_libraryFolders.end()) {
+            g_libraryFolders.push_back(folder);
+            SaveLibraryFolders();
+            StartLibraryScan();
+        }
+        g_libraryFolderInput[0] = '\0';
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Rescan") && !g_libraryScan) {
+        StartLibraryScan();
+    }
+
+    for (size_t i = 0; i < g_libraryFolders.size(); ++i) {
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::SmallButton("x")) {
+            g_libraryFolders.erase(g_libraryFolders.begin() + static_cast<std::ptrdiff_t>(i));
+            SaveLibraryFolders();
+            StartLibraryScan();
+            ImGui::PopID();
+            break;
+        }
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s", g_libraryFolders[i].c_str());
+        ImGui::PopID();
+    }
+
+    // Status
+    if (g_libraryScan) {
+        char progressText[64];
+        snprintf(progressText, sizeof(progressText), "Scanning %zu / %zu files",
+                 g_libraryScan->completed(), g_libraryScan->total());
+        float progress = g_libraryScan->total() > 0 ?
+                         static_cast<float>(g_libraryScan->completed()) / g_libraryScan->total() : 0.0f;
+        ImGui::ProgressBar(progress, ImVec2(350, 0), progressText);
+    } else if (!g_libraryMessage.empty()) {
+        ImVec4 color = (g_libraryMessage.find("ERROR") == 0) ?
+                      ImVec4(1.0f, 0.3f, 0.3f, 1.0f) :
+                      ImVec4(0.6f, 0.6f, 0.6f, 1.0f);
+        ImGui::TextColored(color, "%s", g_libraryMessage.c_str());
+    }
+
+    if (!g_library) {
+        ImGui::Text("Add a folder of .abc files to search it here");
+        return;
+    }
+
+    // Search as you type; results are recomputed only when the query or
+    // the library changes
+    ImGui::SetNextItemWidth(350);
+    if (ImGui::InputTextWithHint("##librarysearch", "Search title, instrument, composer, key...",
+                                 g_librarySearch, sizeof(g_librarySearch))) {
+        g_librarySearchDirty = true;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Words match anywhere; limit one to a field with t: i: c: or k: (e.g. \"k:ador i:fiddle\")");
+    }
+    if (g_librarySearchDirty) {
+        double searchStart = glfwGetTime();
+        g_libraryResults = g_library->search(g_librarySearch, kLibraryResultLimit);
+        g_librarySearchMs = (glfwGetTime() - searchStart) * 1000.0;
+        g_librarySearchDirty = false;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu of %zu tunes (%.2f ms)", g_libraryResults.matched, g_library->size(), g_librarySearchMs);
+
+    // Results (virtualized; one click adds the tune to the setlist)
+    ImGui::BeginChild("libraryresults", ImVec2(0, 180), true);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(g_libraryResults.ids.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const auto& tune = g_library->tune(g_libraryResults.ids[static_cast<size_t>(row)]);
+            ImGui::PushID(row);
+            if (ImGui::SmallButton("Add")) {
+                g_droppedFiles.push_back(tune.path);
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", tune.path.c_str());
+            }
+            ImGui::SameLine();
+            ImGui::Text("%s", tune.title.c_str());
+
+            std::string detail;
+            for (size_t i = 0; i < tune.instruments.size(); ++i) {
+                detail += (i == 0 ? "" : ", ") + tune.instruments[i];
+            }
+            if (!tune.keys.empty()) {
+                detail += "  K:" + tune.keys.front();
+            }
+            if (!tune.composers.empty()) {
+                detail += "  C:" + tune.composers.front();
+            }
+            if (!detail.empty()) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.8f, 1.0f), "%s", detail.c_str());
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+    if (g_libraryResults.matched > g_libraryResults.ids.size()) {
+        ImGui::TextDisabled("... %zu more - refine the search", g_libraryResults.matched - g_libraryResults.ids.size());
+    }
+    ImGui::EndChild();
+}
+
+// Take the improving sets a running search has found since the last frame
+void UpdateSetBuilder() {
+    if (!g_setBuilder) {
+        return;
+    }
+    auto improvements = g_setBuilder->takeImprovements();
+    if (!improvements.empty()) {
+        g_setBuilderBest = std::move(improvements.back());
+        g_haveSetBuilderBest = true;
+        g_setBuilderImprovements += improvements.size();
+    }
+    if (g_setBuilder->isDone()) {
+        g_setBuilder.reset();
+    }
+}
+
+void RenderSetBuilderPanel() {
+    if (!ImGui::CollapsingHeader("Set Builder")) {
+        return;
+    }
+    ImGui::TextDisabled("Picks songs from the setlist to fill a slot (intro and padding included)");
+
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Target (min)", &g_setBuilderMinutes);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Tolerance (sec)", &g_setBuilderTolerance);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Search (sec)", &g_setBuilderBudget);
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Keep first", &g_setBuilderOpeners);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Keep last", &g_setBuilderClosers);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Instrument change cost", &g_setBuilderInstrumentWeight);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Same key cost", &g_setBuilderKeyWeight);
+    g_setBuilderMinutes = std::max(1, g_setBuilderMinutes);
+    g_setBuilderTolerance = std::max(0, g_setBuilderTolerance);
+    g_setBuilderBudget = std::clamp(g_setBuilderBudget, 1, 600);
+    g_setBuilderOpeners = std::max(0, g_setBuilderOpeners);
+    g_setBuilderClosers = std::max(0, g_setBuilderClosers);
+    g_setBuilderInstrumentWeight = std::max(0, g_setBuilderInstrumentWeight);
+    g_setBuilderKeyWeight = std::max(0, g_setBuilderKeyWeight);
+
+    if (g_setBuilder) {
+        if (ImGui::Button("Stop")) {
+            g_setBuilder->cancel();
+        }
+        ImGui::SameLine();
+        float budgetMs = static_cast<float>(g_setBuilder->options().timeBudget.count());
+        char progressText[64];
+        snprintf(progressText, sizeof(progressText), "Searching (%.1fM moves)", g_setBuilder->movesTried() / 1e6);
+        ImGui::ProgressBar(std::min(1.0f, static_cast<float>(g_setBuilder->elapsedMs()) / budgetMs),
+                           ImVec2(350, 0), progressText);
+    } else if (ImGui::Button("Build Set") && g_setlistManager.songCount() > 0) {
+        setlistgui::SetBuilderOptions options;
+        options.targetSeconds = g_setBuilderMinutes * 60;
+        options.toleranceSeconds = g_setBuilderTolerance;
+        options.paddingSeconds = g_paddingSeconds;
+        options.introSeconds = g_introSeconds;
+        options.instrumentChangeWeight = g_setBuilderInstrumentWeight;
+        options.keyRepeatWeight = g_setBuilderKeyWeight;
+        options.timeBudget = std::chrono::milliseconds(g_setBuilderBudget * 1000);
+        const auto& order = g_setlistManager.getOrder();
+        size_t openers = std::min(order.size(), static_cast<size_t>(g_setBuilderOpeners));
+        size_t closers = std::min(order.size() - openers, static_cast<size_t>(g_setBuilderClosers));
+        options.openers.assign(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(openers));
+        options.closers.assign(order.end() - static_cast<std::ptrdiff_t>(closers), order.end());
+        g_setBuilder = g_setlistManager.startSetBuilder(std::move(options));
+        g_haveSetBuilderBest = false;
+        g_setBuilderImprovements = 0;
+    }
+
+    if (!g_haveSetBuilderBest) {
+        return;
+    }
+
+    // Best set so far, updated live while the search runs
+    const auto& best = g_setBuilderBest;
+    showtimecalc::domain::Duration total(best.totalSeconds);
+    ImGui::Text("Best: %s (%+d s), %zu songs, %d instrument change(s), %d key repeat(s)",
+                total.toString().c_str(), best.lengthError, best.order.size(), best.instrumentChanges,
+                best.keyRepeats);
+    ImGui::SameLine();
+    ImGui::TextDisabled("found after %.0f ms, %zu improvements", best.foundAfterMs, g_setBuilderImprovements);
+
+    ImGui::BeginChild("setbuilderresult", ImVec2(0, 140), true);
+    for (size_t i = 0; i < best.order.size(); ++i) {
+        setlistgui::SongId id = best.order[i];
+        if (!g_setlistManager.contains(id)) {
+            ImGui::TextDisabled("%2zu. (removed from the setlist)", i + 1);
+            continue;
+        }
+        const auto& card = g_setlistManager.getSong(id);
+        showtimecalc::domain::Duration duration(card.durationSeconds);
+        const std::string& key = g_setlistManager.getDetails(id).source->key;
+        ImGui::Text("%2zu. %s", i + 1, card.title.c_str());
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.8f, 1.0f), "%s%s%s", duration.toString().c_str(),
+                           key.empty() ? "" : "  K:", key.c_str());
+    }
+    ImGui::EndChild();
+
+    if (ImGui::Button("Apply to Setlist")) {
+        g_setlistManager.applySetOrder(best.order);  // Undo brings the full list back
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Replaces the setlist with this set; Undo restores the other songs");
+    }
+}
+
 // Render a song card
-void RenderSongCard(size_t index, const setlistgui::SongCard& card) {
-    ImGui::PushID(static_cast<int>(index));
+void RenderSongCard(size_t position, setlistgui::SongId id, const setlistgui::SongCard& card) {
+    ImGui::PushID(static_cast<int>(id));
 
     // Card background
     ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.15f, 0.15f, 0.17f, 1.0f));
-    ImGui::BeginChild("card", ImVec2(-1, 120), true, ImGuiWindowFlags_NoScrollbar);
+    ImGui::BeginChild("card", ImVec2(-1, kCardHeight), true, ImGuiWindowFlags_NoScrollbar);
 
     // Drag source for reordering
     if (ImGui::IsWindowHovered() && ImGui::IsMouseDown(0)) {
-        g_draggedIndex = static_cast<int>(index);
+        g_draggedSongId = id;
     }
 
     // Title (editable on double-click)
     ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
-    ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.6f, 1.0f), "%d. ", static_cast<int>(index) + 1);
+    ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.6f, 1.0f), "%d. ", static_cast<int>(position) + 1);
     ImGui::SameLine();
 
-    if (g_editingIndex == static_cast<int>(index)) {
+    if (g_editingSongId == id) {
         ImGui::SetKeyboardFocusHere();
         if (ImGui::InputText("##title", g_editingTitle, sizeof(g_editingTitle), ImGuiInputTextFlags_EnterReturnsTrue)) {
-            g_setlistManager.updateSongTitle(index, g_editingTitle);
-            g_editingIndex = -1;
+            g_setlistManager.updateSongTitle(id, g_editingTitle);
+            g_editingSongId = setlistgui::kInvalidSongId;
         }
         if (ImGui::IsItemDeactivated()) {
-            g_editingIndex = -1;
+            g_editingSongId = setlistgui::kInvalidSongId;
         }
     } else {
         ImGui::Text("%s", card.title.c_str());
         if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
-            g_editingIndex = static_cast<int>(index);
+            g_editingSongId = id;
             strncpy(g_editingTitle, card.title.c_str(), sizeof(g_editingTitle) - 1);
             g_editingTitle[sizeof(g_editingTitle) - 1] = '\0';
         }
@@ -116,29 +550,51 @@ void RenderSongCard(size_t index, const setlistgui::SongCard& card) {
         }
     }
 
+    // Source file changed on disk since import
+    if (card.sourceState == setlistgui::SourceState::Reloaded) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.4f, 0.8f, 1.0f, 1.0f), "(reloaded)");
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("The file changed on disk and was reloaded - title edits were kept");
+        }
+    } else if (card.sourceState == setlistgui::SourceState::ReloadFailed) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "(file changed)");
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("The file was changed or removed and could not be reloaded - the last good copy is kept");
+        }
+    }
+
     ImGui::PopFont();
 
-    // Duration
+    // Duration and when the song plays in the show
     showtimecalc::domain::Duration duration(card.durationSeconds);
     ImGui::TextColored(ImVec4(0.6f, 1.0f, 0.6f, 1.0f), "Duration: %s", duration.toString().c_str());
+    auto cue = g_setlistManager.getCue(position, g_paddingSeconds, g_introSeconds);
+    showtimecalc::domain::Duration cueStart(cue.startSeconds);
+    showtimecalc::domain::Duration cueEnd(cue.endSeconds);
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "   Cue: %s - %s",
+                       cueStart.toString().c_str(), cueEnd.toString().c_str());
 
     // Instruments
     ImGui::Text("Instruments: ");
     ImGui::SameLine();
+    const auto& instrumentNames = g_setlistManager.getInstruments();
     for (size_t i = 0; i < card.instruments.size(); ++i) {
-        ImGui::TextColored(ImVec4(0.8f, 0.8f, 1.0f, 1.0f), "%s", card.instruments[i].c_str());
+        ImGui::TextColored(ImVec4(0.8f, 0.8f, 1.0f, 1.0f), "%s", instrumentNames.name(card.instruments[i]).c_str());
         if (i < card.instruments.size() - 1) {
             ImGui::SameLine();
             ImGui::Text(",");
             ImGui::SameLine();
         }
     }
-    if (card.titleLines.size() > 1) {
+    if (card.partCount > 1) {
         ImGui::SameLine();
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.4f, 0.4f, 0.8f, 1.0f));
         ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.5f, 0.5f, 1.0f, 1.0f));
         if (ImGui::SmallButton("Edit Parts")) {
-            g_editingInstrumentsSongIndex = static_cast<int>(index);
+            g_editingPartsSongId = id;
         }
         ImGui::PopStyleColor(2);
     }
@@ -153,7 +609,7 @@ void RenderSongCard(size_t index, const setlistgui::SongCard& card) {
     ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.8f, 0.2f, 0.2f, 1.0f));
     ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
     if (ImGui::Button("Remove")) {
-        g_setlistManager.removeSong(index);
+        g_pendingRemoveId = id;
     }
     ImGui::PopStyleColor(2);
 
@@ -161,10 +617,11 @@ void RenderSongCard(size_t index, const setlistgui::SongCard& card) {
     ImGui::PopStyleColor();
 
     // Handle drop for reordering
-    if (g_draggedIndex >= 0 && g_draggedIndex != static_cast<int>(index) && ImGui::IsItemHovered()) {
+    if (g_draggedSongId != setlistgui::kInvalidSongId && g_draggedSongId != id && ImGui::IsItemHovered()) {
         if (ImGui::IsMouseReleased(0)) {
-            g_setlistManager.reorderSong(static_cast<size_t>(g_draggedIndex), index);
-            g_draggedIndex = -1;
+            g_pendingMoveId = g_draggedSongId;
+            g_pendingMovePosition = position;
+            g_draggedSongId = setlistgui::kInvalidSongId;
         }
     }
 
@@ -194,6 +651,37 @@ int main(int argc, char** argv) {
 
     // Setup drag and drop callback
     glfwSetDropCallback(window, drop_callback);
+    InstallWakeCallbacks(window);
+
+    // Parsed metadata from earlier sessions, so re-importing known files is cheap
+    auto metadataCache = std::make_shared<setlistgui::MetadataCache>(setlistgui::MetadataCache::defaultPath());
+    metadataCache->load();
+    g_setlistManager.setMetadataCache(metadataCache);
+
+    // The setlist as it was at the last exit
+    const std::string autoSessionPath = setlistgui::defaultSessionPath();
+    {
+        std::error_code ec;
+        std::string error;
+        if (std::filesystem::exists(autoSessionPath, ec) && !OpenSession(autoSessionPath, error)) {
+            g_importMessage = "Could not restore the last session: " + error;
+            g_importMessageTimer = 5.0f;
+        }
+    }
+
+    // Watch the songs' source files; the watcher thread wakes the loop
+    // once a burst of saves has settled
+    g_fileWatcher = std::make_unique<setlistgui::FileWatcher>();
+    g_fileWatcher->setOnChange(WakeMainLoop);
+
+    // Tune library: folders from the last session, indexed in the background
+    g_libraryWatcher = std::make_unique<setlistgui::FileWatcher>();
+    g_libraryWatcher->setOnChange(WakeMainLoop);
+    g_libraryFoldersPath = setlistgui::defaultLibraryFoldersPath();
+    g_libraryFolders = setlistgui::loadLibraryFolders(g_libraryFoldersPath);
+    if (!g_libraryFolders.empty()) {
+        StartLibraryScan();
+    }
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -208,23 +696,135 @@ int main(int argc, char** argv) {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
-    // Main loop
+    // Main loop. Rendering is on demand: when nothing is animating the loop
+    // sleeps until input (or a drop) arrives, draws a few frames and goes
+    // back to sleep. Imports, message timers, drags and text editing keep
+    // it drawing continuously until they finish.
+    setlistgui::FrameStats frameStats;
+    setlistgui::Profiler::setThreadName("main");
+    int framesToRender = kFramesAfterEvent;
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        // Process dropped files
-        if (!g_droppedFiles.empty()) {
-            for (const auto& file : g_droppedFiles) {
-                g_setlistManager.addSongFromFile(file);
+        // Probes only record while the overlay is open or a trace is running
+        bool profiling = g_showDebugOverlay || g_recordingTrace;
+        setlistgui::Profiler::setEnabled(profiling);
+
+        bool animating = g_importJob || g_reloadJob || g_libraryScan || g_setBuilder || g_sourceCheck ||
+                         g_exportMessageTimer > 0.0f || g_importMessageTimer > 0.0f ||
+                         g_draggedSongId != setlistgui::kInvalidSongId || io.WantTextInput ||
+                         g_renderContinuously;
+        std::int64_t frameStartUs = profiling ? setlistgui::Profiler::nowUs() : 0;
+        if (animating || framesToRender > 0) {
+            setlistgui::ProfileScope probe("pollEvents", setlistgui::ProfileCategory::Frame);
+            glfwPollEvents();
+        } else {
+            double waitStart = glfwGetTime();
+            std::uint64_t wakeEvents = g_wakeEvents.load();
+            {
+                setlistgui::ProfileScope probe("waitEvents", setlistgui::ProfileCategory::Frame);
+                glfwWaitEventsTimeout(kIdleWaitSeconds);
+            }
+            if (g_wakeEvents.load() == wakeEvents && glfwGetTime() - waitStart >= kIdleWaitSeconds) {
+                // Timed out without any event: nothing to redraw
+                frameStats.update(glfwGetTime(), false);
+                continue;
             }
+            framesToRender = kFramesAfterEvent;
+            frameStartUs = profiling ? setlistgui::Profiler::nowUs() : 0;  // Idle time isn't frame time
+        }
+
+        setlistgui::ProfileScope dropProbe("processDrops", setlistgui::ProfileCategory::Frame);
+
+        // Import dropped files in the background; drops made while an
+        // import is running wait for it and go in the next batch
+        if (!g_importJob && !g_droppedFiles.empty()) {
+            g_importJob = g_setlistManager.startImport(g_droppedFiles);
             g_droppedFiles.clear();
         }
 
+        // Merge a finished import back into the setlist
+        if (g_importJob && g_importJob->isDone()) {
+            g_lastImportReport = g_setlistManager.finishImport(*g_importJob);
+            g_importJob.reset();
+
+            const auto& report = g_lastImportReport;
+            g_importMessage = "Imported " + std::to_string(report.added) + " of " +
+                              std::to_string(report.requested) + " files";
+            if (!report.failures.empty()) {
+                g_importMessage += " (" + std::to_string(report.failures.size()) + " failed)";
+            }
+            if (!report.duplicates.empty()) {
+                g_importMessage += ", " + std::to_string(report.duplicates.size()) + " duplicate(s) skipped";
+            }
+            if (report.cancelled) {
+                g_importMessage += " - cancelled, " + std::to_string(report.skipped) + " skipped";
+            }
+            g_importMessageTimer = 4.0f;
+
+            metadataCache->save();
+        }
+
+        // Keep the watcher on the current set of source files
+        if (g_setlistManager.getSourceRevision() != g_watchedRevision) {
+            g_watchedRevision = g_setlistManager.getSourceRevision();
+            g_fileWatcher->setPaths(g_setlistManager.getSourcePaths());
+        }
+
+        // Reload files that changed on disk; changes arriving during a
+        // reload wait for the next one
+        for (auto& path : g_fileWatcher->takeChanged()) {
+            g_pendingReloads.push_back(std::move(path));
+        }
+        if (g_sourceCheck && g_sourceCheck->isDone()) {
+            for (auto& path : g_setlistManager.finishSourceCheck(*g_sourceCheck)) {
+                g_pendingReloads.push_back(std::move(path));
+            }
+            g_sourceCheck.reset();
+        }
+        if (!g_reloadJob && !g_pendingReloads.empty()) {
+            std::sort(g_pendingReloads.begin(), g_pendingReloads.end());
+            g_pendingReloads.erase(std::unique(g_pendingReloads.begin(), g_pendingReloads.end()),
+                                   g_pendingReloads.end());
+            g_reloadJob = g_setlistManager.startReload(std::move(g_pendingReloads));
+            g_pendingReloads.clear();
+        }
+        if (g_reloadJob && g_reloadJob->isDone()) {
+            auto report = g_setlistManager.finishReload(*g_reloadJob);
+            g_reloadJob.reset();
+            if (report.reloaded > 0 || !report.failures.empty()) {
+                g_importMessage = "Reloaded " + std::to_string(report.reloaded) + " changed song(s) from disk";
+                if (!report.failures.empty()) {
+                    g_importMessage += " (" + std::to_string(report.failures.size()) + " could not be read)";
+                }
+                g_importMessageTimer = 4.0f;
+            }
+            metadataCache->save();
+        }
+
+        UpdateLibrary();
+        UpdateSetBuilder();
+        dropProbe.stop();
+
         // Start the Dear ImGui frame
+        setlistgui::ProfileScope buildProbe("buildUi", setlistgui::ProfileCategory::Frame);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Debug overlay
+        if (ImGui::IsKeyPressed(ImGuiKey_F12, false)) {
+            g_showDebugOverlay = !g_showDebugOverlay;
+        }
+
+        // Undo/redo shortcuts (a focused text field keeps Ctrl+Z for itself)
+        if (io.KeyCtrl && !io.WantTextInput) {
+            if (ImGui::IsKeyPressed(ImGuiKey_Z, false) && !io.KeyShift) {
+                Undo();
+            } else if (ImGui::IsKeyPressed(ImGuiKey_Y, false) ||
+                       (ImGui::IsKeyPressed(ImGuiKey_Z, false) && io.KeyShift)) {
+                Redo();
+            }
+        }
+
         // Main window
         ImGui::SetNextWindowPos(ImVec2(0, 0));
         ImGui::SetNextWindowSize(io.DisplaySize);
@@ -240,7 +840,16 @@ int main(int argc, char** argv) {
         ImGui::Separator();
 
         // Control panel
-        ImGui::Text("Drag and drop .abc files onto this window to add songs");
+        ImGui::Text("Drag and drop .abc files or folders onto this window to add songs");
+        ImGui::SameLine();
+        bool splitTunebooks = g_setlistManager.splitTunebooks();
+        if (ImGui::Checkbox("Tunebook mode", &splitTunebooks)) {
+            g_setlistManager.setSplitTunebooks(splitTunebooks);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Add one song per X: tune of each dropped file (for tunebooks).\n"
+                              "Leave off for multi-part songs, which also use one X: per part.");
+        }
         ImGui::Spacing();
 
         ImGui::Columns(2, nullptr, false);
@@ -283,7 +892,7 @@ int main(int argc, char** argv) {
         ImGui::TextColored(ImVec4(0.6f, 1.0f, 0.6f, 1.0f), "%s", totalDuration.toString().c_str());
         ImGui::PopFont();
 
-        ImGui::Text("Songs: %zu", g_setlistManager.getSongs().size());
+        ImGui::Text("Songs: %zu", g_setlistManager.songCount());
 
         ImGui::EndChild();
 
@@ -305,16 +914,34 @@ int main(int argc, char** argv) {
         }
         ImGui::SameLine();
         ImGui::Checkbox("Add numbering (01_, 02_, etc.)", &g_addNumbering);
+        ImGui::SameLine();
+        ImGui::Checkbox("Sync (only changed files)", &g_syncExport);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Keeps unchanged files, renames renumbered ones and removes\n"
+                              "files from earlier syncs that are no longer in the setlist");
+        }
 
         if (ImGui::Button("Export to Folder")) {
             if (strlen(g_exportFolderPath) > 0) {
-                if (g_setlistManager.exportToFolder(g_exportFolderPath, g_addNumbering)) {
+                auto report = g_setlistManager.exportToFolder(g_exportFolderPath, g_addNumbering, g_syncExport);
+                if (report.success && g_syncExport) {
+                    char stats[160];
+                    snprintf(stats, sizeof(stats), "Synced %zu files: %zu written, %zu renamed, %zu unchanged, "
+                             "%zu removed (%.1f KB in %.0f ms)", report.files.size(), report.written,
+                             report.renamed, report.kept, report.removed, report.totalBytes / 1024.0,
+                             report.elapsedMs);
+                    g_exportMessage = stats;
+                    g_exportMessageTimer = 3.0f;
+                } else if (report.success) {
                     std::string numberingMsg = g_addNumbering ? " with numbering" : "";
-                    g_exportMessage = "Successfully exported " + std::to_string(g_setlistManager.getSongs().size()) +
-                                     " files to folder" + numberingMsg + "!";
+                    char stats[64];
+                    snprintf(stats, sizeof(stats), " (%.1f KB in %.0f ms)",
+                             report.totalBytes / 1024.0, report.elapsedMs);
+                    g_exportMessage = "Successfully exported " + std::to_string(report.files.size()) +
+                                     " files to folder" + numberingMsg + "!" + stats;
                     g_exportMessageTimer = 3.0f;  // Show for 3 seconds
                 } else {
-                    g_exportMessage = "ERROR: Failed to export files. Check folder path.";
+                    g_exportMessage = "ERROR: Export failed, folder left unchanged. " + report.error;
                     g_exportMessageTimer = 5.0f;
                 }
             } else {
@@ -327,6 +954,90 @@ int main(int argc, char** argv) {
         if (ImGui::Button("Clear All")) {
             g_setlistManager.clear();
         }
+        ImGui::SameLine();
+        if (ImGui::Button("Undo") && g_setlistManager.canUndo()) {
+            Undo();
+        }
+        if (ImGui::IsItemHovered()) {
+            const auto& history = g_setlistManager.getHistory();
+            ImGui::SetTooltip("Ctrl+Z - %zu step(s), %.1f KB of history",
+                              history.undoSteps(), history.bytes() / 1024.0);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Redo") && g_setlistManager.canRedo()) {
+            Redo();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Ctrl+Y - %zu step(s)", g_setlistManager.getHistory().redoSteps());
+        }
+
+        // Archive export: the same files, streamed into one .zip or .tar
+        ImGui::Text("Archive:      ");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(350);
+        ImGui::InputTextWithHint("##archive", "path/to/setlist.zip", g_archivePath, sizeof(g_archivePath));
+        ImGui::SameLine();
+        if (ImGui::Button("Export Archive")) {
+            if (strlen(g_archivePath) > 0) {
+                auto report = g_setlistManager.exportToArchive(g_archivePath, g_addNumbering);
+                if (report.success) {
+                    char stats[64];
+                    snprintf(stats, sizeof(stats), " (%.1f KB in %.0f ms)", report.totalBytes / 1024.0,
+                             report.elapsedMs);
+                    g_exportMessage = "Exported " + std::to_string(report.written) + " files to archive" + stats;
+                } else {
+                    g_exportMessage = "ERROR: Archive export failed. " + report.error;
+                }
+            } else {
+                g_exportMessage = "ERROR: Please enter an archive path first.";
+            }
+            g_exportMessageTimer = 3.0f;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Zip or tar by the file's extension; numbering and title edits\n"
+                              "apply as for a folder, and the same setlist gives the same bytes");
+        }
+
+        // Session: the whole setlist, its title edits and these settings
+        ImGui::Text("Session:");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(350);
+        ImGui::InputTextWithHint("##session", "path/to/setlist.abcs", g_sessionPath, sizeof(g_sessionPath));
+        ImGui::SameLine();
+        if (ImGui::Button("Save Session")) {
+            std::string error;
+            if (strlen(g_sessionPath) == 0) {
+                g_exportMessage = "ERROR: Please enter a session file path first.";
+            } else if (g_setlistManager.saveSession(g_sessionPath, CurrentSessionSettings(), g_embedSessionContent,
+                                                    error)) {
+                g_exportMessage = "Saved " + std::to_string(g_setlistManager.songCount()) + " songs to session";
+            } else {
+                g_exportMessage = "ERROR: Session not saved. " + error;
+            }
+            g_exportMessageTimer = 3.0f;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Open Session")) {
+            std::string error;
+            if (strlen(g_sessionPath) == 0) {
+                g_exportMessage = "ERROR: Please enter a session file path first.";
+            } else if (OpenSession(g_sessionPath, error)) {
+                g_exportMessage = "Opened session with " + std::to_string(g_setlistManager.songCount()) + " songs";
+            } else {
+                g_exportMessage = "ERROR: " + error;
+            }
+            g_exportMessageTimer = 3.0f;
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Embed song content", &g_embedSessionContent);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Store every song's bytes in the session, so it still exports\n"
+                              "when the source files are moved or deleted");
+        }
+        if (g_sourceCheck) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("Checking source files %zu / %zu", g_sourceCheck->completed(), g_sourceCheck->total());
+        }
 
         // Show export message if active
         if (g_exportMessageTimer > 0.0f) {
@@ -337,6 +1048,87 @@ int main(int argc, char** argv) {
             g_exportMessageTimer -= ImGui::GetIO().DeltaTime;
         }
 
+        // Import progress
+        if (g_importJob) {
+            char progressText[96];
+            if (g_importJob->isWalking()) {
+                snprintf(progressText, sizeof(progressText), "Importing %zu / %zu files (searching folders...)",
+                         g_importJob->completed(), g_importJob->total());
+            } else {
+                snprintf(progressText, sizeof(progressText), "Importing %zu / %zu files",
+                         g_importJob->completed(), g_importJob->total());
+            }
+            ImGui::ProgressBar(g_importJob->progress(), ImVec2(350, 0), progressText);
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel Import")) {
+                g_importJob->cancel();
+            }
+        } else if (g_importMessageTimer > 0.0f) {
+            ImVec4 color = g_lastImportReport.failures.empty() ?
+                          ImVec4(0.3f, 1.0f, 0.3f, 1.0f) :
+                          ImVec4(1.0f, 0.6f, 0.2f, 1.0f);
+            ImGui::TextColored(color, "%s", g_importMessage.c_str());
+            g_importMessageTimer -= ImGui::GetIO().DeltaTime;
+        }
+
+        // Metadata cache status
+        {
+            auto cacheStats = metadataCache->stats();
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "Metadata cache: %zu entries, %zu hits, %zu misses",
+                               cacheStats.entries, cacheStats.hits, cacheStats.misses);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Compact Cache")) {
+                metadataCache->compact();
+                metadataCache->save();
+            }
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Clear Cache")) {
+                metadataCache->clear();
+                metadataCache->save();
+            }
+        }
+
+        // Files that could not be imported (kept until dismissed)
+        if (!g_lastImportReport.failures.empty()) {
+            bool showFailures = ImGui::TreeNode("importfailures", "%zu file(s) could not be imported",
+                                                g_lastImportReport.failures.size());
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Dismiss")) {
+                g_lastImportReport.failures.clear();
+            }
+            if (showFailures) {
+                for (const auto& failure : g_lastImportReport.failures) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s: %s",
+                                       failure.path.c_str(), failure.reason.c_str());
+                }
+                ImGui::TreePop();
+            }
+        }
+
+        // Files left out because the setlist already had their content
+        if (!g_lastImportReport.duplicates.empty()) {
+            bool showDuplicates = ImGui::TreeNode("importduplicates", "%zu duplicate(s) not added",
+                                                  g_lastImportReport.duplicates.size());
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Dismiss##duplicates")) {
+                g_lastImportReport.duplicates.clear();
+            }
+            if (showDuplicates) {
+                for (const auto& duplicate : g_lastImportReport.duplicates) {
+                    if (duplicate.duplicateOf.empty()) {
+                        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s", duplicate.path.c_str());
+                    } else {
+                        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s (same as %s)",
+                                           duplicate.path.c_str(), duplicate.duplicateOf.c_str());
+                    }
+                }
+                ImGui::TreePop();
+            }
+        }
+
+        RenderLibraryPanel(window);
+        RenderSetBuilderPanel();
+
         ImGui::Separator();
         ImGui::Spacing();
 
@@ -344,20 +1136,56 @@ int main(int argc, char** argv) {
         ImGui::Text("Songs in Setlist (double-click title to edit, drag to reorder):");
         ImGui::BeginChild("songlist", ImVec2(0, 0), false);
 
-        const auto& songs = g_setlistManager.getSongs();
-        if (songs.empty()) {
+        const auto& order = g_setlistManager.getOrder();
+        if (order.empty()) {
             ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f),
                              "No songs yet. Drop .abc files here to get started!");
         } else {
-            for (size_t i = 0; i < songs.size(); ++i) {
-                RenderSongCard(i, songs[i]);
-                ImGui::Spacing();
+            // Only the cards in view are submitted; the clipper reserves the
+            // space of the rest, so frame time doesn't grow with the setlist
+            const float cardStride = kCardHeight + ImGui::GetStyle().ItemSpacing.y * 2.0f;
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(order.size()), cardStride);
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                    auto position = static_cast<size_t>(i);
+                    RenderSongCard(position, order[position], g_setlistManager.getSong(order[position]));
+                    ImGui::Spacing();
+                }
+            }
+            clipper.End();
+
+            // While dragging near the top or bottom edge, scroll so drop
+            // targets that are out of view can be reached
+            if (g_draggedSongId != setlistgui::kInvalidSongId && ImGui::IsMouseDown(0)) {
+                const float edge = 40.0f;
+                float mouseY = ImGui::GetMousePos().y;
+                float top = ImGui::GetWindowPos().y;
+                float bottom = top + ImGui::GetWindowHeight();
+                float step = 600.0f * io.DeltaTime;
+                if (mouseY < top + edge) {
+                    ImGui::SetScrollY(ImGui::GetScrollY() - step);
+                } else if (mouseY > bottom - edge) {
+                    ImGui::SetScrollY(ImGui::GetScrollY() + step);
+                }
             }
         }
 
         // Release drag on mouse up
         if (ImGui::IsMouseReleased(0)) {
-            g_draggedIndex = -1;
+            g_draggedSongId = setlistgui::kInvalidSongId;
+        }
+
+        // Apply removes and moves requested by the cards now that the list
+        // is no longer being walked; songs are addressed by id, so a list
+        // that changed during the drag can't send the wrong song
+        if (g_pendingRemoveId != setlistgui::kInvalidSongId) {
+            g_setlistManager.removeSong(g_pendingRemoveId);
+            g_pendingRemoveId = setlistgui::kInvalidSongId;
+        }
+        if (g_pendingMoveId != setlistgui::kInvalidSongId) {
+            g_setlistManager.moveSong(g_pendingMoveId, g_pendingMovePosition);
+            g_pendingMoveId = setlistgui::kInvalidSongId;
         }
 
         ImGui::EndChild();
@@ -365,13 +1193,14 @@ int main(int argc, char** argv) {
         ImGui::End();
 
         // Edit Instruments Modal
-        if (g_editingInstrumentsSongIndex >= 0 &&
-            g_editingInstrumentsSongIndex < static_cast<int>(g_setlistManager.getSongs().size())) {
+        if (g_setlistManager.contains(g_editingPartsSongId)) {
             ImGui::OpenPopup("Edit Instrument Parts");
         }
 
-        if (ImGui::BeginPopupModal("Edit Instrument Parts", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
-            const auto& song = g_setlistManager.getSongs()[g_editingInstrumentsSongIndex];
+        if (g_setlistManager.contains(g_editingPartsSongId) &&
+            ImGui::BeginPopupModal("Edit Instrument Parts", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+            const auto& song = g_setlistManager.getSong(g_editingPartsSongId);
+            const auto& details = g_setlistManager.getDetails(g_editingPartsSongId);
 
             ImGui::Text("Song: %s", song.title.c_str());
             ImGui::Separator();
@@ -381,8 +1210,9 @@ int main(int argc, char** argv) {
             ImGui::Spacing();
 
             // Display all title lines with full editing capability
-            for (size_t i = 0; i < song.titleLines.size(); ++i) {
-                const auto& titleLine = song.titleLines[i];
+            for (size_t i = 0; i < details.titleLines.size(); ++i) {
+                const auto& titleLine = details.titleLines[i];
+                std::string lineText(details.titleLineText(i));
 
                 ImGui::PushID(static_cast<int>(i));
                 ImGui::Text("Part %d:", static_cast<int>(i) + 1);
@@ -393,17 +1223,17 @@ int main(int argc, char** argv) {
                     ImGui::SetNextItemWidth(500.0f);  // Wider input for full titles
                     if (ImGui::InputText("##titleline", g_editingTitleLine, sizeof(g_editingTitleLine),
                                         ImGuiInputTextFlags_EnterReturnsTrue)) {
-                        g_setlistManager.updateTitleLine(g_editingInstrumentsSongIndex, i, g_editingTitleLine);
+                        g_setlistManager.updateTitleLine(g_editingPartsSongId, i, g_editingTitleLine);
                         g_editingTitleLineIndex = -1;
                     }
                     if (ImGui::IsItemDeactivated()) {
                         g_editingTitleLineIndex = -1;
                     }
                 } else {
-                    ImGui::Text("%s", titleLine.fullTitle.c_str());
+                    ImGui::Text("%s", lineText.c_str());
                     if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
                         g_editingTitleLineIndex = static_cast<int>(i);
-                        strncpy(g_editingTitleLine, titleLine.fullTitle.c_str(), sizeof(g_editingTitleLine) - 1);
+                        strncpy(g_editingTitleLine, lineText.c_str(), sizeof(g_editingTitleLine) - 1);
                         g_editingTitleLine[sizeof(g_editingTitleLine) - 1] = '\0';
                     }
                     if (titleLine.titleEdited) {
@@ -426,7 +1256,7 @@ int main(int argc, char** argv) {
 
             ImGui::Spacing();
             if (ImGui::Button("Done", ImVec2(120, 0))) {
-                g_editingInstrumentsSongIndex = -1;
+                g_editingPartsSongId = setlistgui::kInvalidSongId;
                 g_editingTitleLineIndex = -1;
                 ImGui::CloseCurrentPopup();
             }
@@ -434,19 +1264,98 @@ int main(int argc, char** argv) {
             ImGui::EndPopup();
         }
 
+        if (g_showDebugOverlay) {
+            ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 10.0f, io.DisplaySize.y - 10.0f), 0, ImVec2(1.0f, 1.0f));
+            ImGui::SetNextWindowBgAlpha(0.8f);
+            ImGui::Begin("Debug", &g_showDebugOverlay,
+                         ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                         ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoFocusOnAppearing);
+            ImGui::Text("Rendering: %s", animating ? "continuous" : "on demand");
+            ImGui::Text("Frames in last minute: %zu", frameStats.framesPerMinute());
+            ImGui::Text("CPU: %.1f%%", frameStats.cpuPercent());
+            auto contentStats = g_setlistManager.getContentStore().stats();
+            ImGui::Text("Content LRU: %zu songs, %.1f KB (%zu hits, %zu reads)", contentStats.entries,
+                        contentStats.residentBytes / 1024.0, contentStats.hits, contentStats.misses);
+            ImGui::Checkbox("Render continuously", &g_renderContinuously);
+
+            // Frame time graph
+            std::vector<float> frameTimes = setlistgui::Profiler::frameTimes();
+            float slowestFrame = *std::max_element(frameTimes.begin(), frameTimes.end());
+            char graphLabel[48];
+            snprintf(graphLabel, sizeof(graphLabel), "frame ms (max %.1f)", slowestFrame);
+            ImGui::PlotLines("##frametimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0,
+                             graphLabel, 0.0f, std::max(slowestFrame, 16.7f), ImVec2(300, 60));
+
+            // Slowest recent setlist operations
+            ImGui::Text("Slowest recent operations:");
+            for (const auto& event : setlistgui::Profiler::slowestRecent(8)) {
+                ImGui::Text("  %-16s %9.2f ms", event.name, event.durationUs / 1000.0);
+            }
+
+            // Chrome trace-event capture
+            if (!g_recordingTrace) {
+                if (ImGui::Button("Record Trace")) {
+                    setlistgui::Profiler::startTrace();
+                    g_recordingTrace = true;
+                    g_traceMessage.clear();
+                }
+            } else {
+                char stopLabel[64];
+                snprintf(stopLabel, sizeof(stopLabel), "Stop and Save Trace (%zu events)",
+                         setlistgui::Profiler::traceEventCount());
+                if (ImGui::Button(stopLabel)) {
+                    std::string tracePath = setlistgui::Profiler::defaultTracePath();
+                    std::string error;
+                    g_recordingTrace = false;
+                    g_traceMessage = setlistgui::Profiler::stopTrace(tracePath, error) ?
+                                     "Trace saved to " + tracePath : "ERROR: " + error;
+                }
+            }
+            if (!g_traceMessage.empty()) {
+                ImGui::TextWrapped("%s", g_traceMessage.c_str());
+            }
+            ImGui::End();
+        }
+        buildProbe.stop();
+
         // Rendering
-        ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            setlistgui::ProfileScope probe("render", setlistgui::ProfileCategory::Frame);
+            ImGui::Render();
+            int display_w, display_h;
+            glfwGetFramebufferSize(window, &display_w, &display_h);
+            glViewport(0, 0, display_w, display_h);
+            glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+
+        {
+            setlistgui::ProfileScope probe("swap", setlistgui::ProfileCategory::Frame);
+            glfwSwapBuffers(window);
+        }
 
-        glfwSwapBuffers(window);
+        if (profiling) {
+            setlistgui::Profiler::recordFrame((setlistgui::Profiler::nowUs() - frameStartUs) / 1000.0f);
+        }
+        frameStats.update(glfwGetTime(), true);
+        if (framesToRender > 0) {
+            --framesToRender;
+        }
     }
 
     // Cleanup
+    g_importJob.reset();  // Cancels and joins any running import
+    g_reloadJob.reset();
+    g_sourceCheck.reset();
+    g_fileWatcher.reset();
+    g_libraryScan.reset();
+    g_libraryWatcher.reset();
+    metadataCache->save();
+    {
+        std::string error;
+        g_setlistManager.saveSession(autoSessionPath, CurrentSessionSettings(), false, error);
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();